@@ -0,0 +1,215 @@
+// Микробенчмарки MemoryBlock: пропускная способность последовательного
+// чтения/записи, задержка случайного доступа (pointer chasing) и цена
+// мелких записей для разных размеров блока и путей доступа:
+//   copy  — копирующий API (readBlock/writeBlock),
+//   view  — zero-copy представления (viewBlock/mutableBlock),
+//   bytes — байтовая адресация (read/write/load/store).
+//
+// Вывод машиночитаемый: CSV (по умолчанию) или JSON (--json).
+// --quick уменьшает объём работы (для проверки сборки в CI).
+
+#include "Memory/MemoryBlock.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Result {
+    std::string benchmark;
+    std::string api;
+    size_t block_size;
+    size_t operations;
+    size_t bytes;
+    double seconds;
+};
+
+// Не даёт компилятору выбросить измеряемую работу.
+volatile uint64_t g_sink = 0;
+
+template <typename Fn>
+double measure(Fn&& fn) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+uint64_t checksum(const uint8_t* p, size_t n) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; i += 64) sum += p[i];
+    return sum;
+}
+
+// Последовательное чтение и запись всей памяти, rounds проходов.
+void benchSequential(size_t block_size, size_t blocks, size_t rounds, std::vector<Result>& out) {
+    MemoryBlock mem(blocks, block_size);
+    const size_t bytes = blocks * block_size * rounds;
+    std::vector<uint8_t> block(block_size, 0x5A);
+    std::vector<uint8_t> whole(blocks * block_size, 0x5A);
+
+    out.push_back({"seq_write", "copy", block_size, blocks * rounds, bytes, measure([&] {
+        for (size_t r = 0; r < rounds; ++r)
+            for (size_t i = 0; i < blocks; ++i) mem.writeBlock(i, block);
+    })});
+    out.push_back({"seq_write", "view", block_size, blocks * rounds, bytes, measure([&] {
+        for (size_t r = 0; r < rounds; ++r)
+            for (size_t i = 0; i < blocks; ++i) std::memcpy(mem.mutableBlock(i).data(), block.data(), block_size);
+    })});
+    out.push_back({"seq_write", "bytes", block_size, rounds, bytes, measure([&] {
+        for (size_t r = 0; r < rounds; ++r) mem.write(0, whole.data(), whole.size());
+    })});
+
+    out.push_back({"seq_read", "copy", block_size, blocks * rounds, bytes, measure([&] {
+        uint64_t sum = 0;
+        for (size_t r = 0; r < rounds; ++r)
+            for (size_t i = 0; i < blocks; ++i) {
+                std::vector<uint8_t> data = mem.readBlock(i);
+                sum += data[0];
+            }
+        g_sink = g_sink + sum;
+    })});
+    out.push_back({"seq_read", "view", block_size, blocks * rounds, bytes, measure([&] {
+        uint64_t sum = 0;
+        for (size_t r = 0; r < rounds; ++r)
+            for (size_t i = 0; i < blocks; ++i) {
+                BlockView view = mem.viewBlock(i);
+                std::memcpy(block.data(), view.data(), block_size);
+                sum += block[0];
+            }
+        g_sink = g_sink + sum;
+    })});
+    out.push_back({"seq_read", "bytes", block_size, rounds, bytes, measure([&] {
+        for (size_t r = 0; r < rounds; ++r) mem.read(0, whole.data(), whole.size());
+        g_sink = g_sink + checksum(whole.data(), whole.size());
+    })});
+}
+
+// Случайная перестановка блоков, замкнутая в один цикл: каждый блок
+// хранит номер следующего в первых 4 байтах. Следующий адрес известен
+// только после чтения — измеряется задержка, а не пропускная способность.
+void benchPointerChase(size_t block_size, size_t blocks, size_t hops, std::vector<Result>& out) {
+    MemoryBlock mem(blocks, block_size);
+    std::vector<uint32_t> order(blocks);
+    std::iota(order.begin(), order.end(), 0u);
+    std::shuffle(order.begin() + 1, order.end(), std::mt19937(42));
+    for (size_t i = 0; i < blocks; ++i) {
+        mem.store<uint32_t>(order[i] * block_size, order[(i + 1) % blocks]);
+    }
+
+    out.push_back({"pointer_chase", "copy", block_size, hops, hops * sizeof(uint32_t), measure([&] {
+        uint32_t cur = 0;
+        for (size_t i = 0; i < hops; ++i) {
+            std::vector<uint8_t> data = mem.readBlock(cur);
+            std::memcpy(&cur, data.data(), sizeof(cur));
+        }
+        g_sink = g_sink + cur;
+    })});
+    out.push_back({"pointer_chase", "view", block_size, hops, hops * sizeof(uint32_t), measure([&] {
+        uint32_t cur = 0;
+        for (size_t i = 0; i < hops; ++i) {
+            std::memcpy(&cur, mem.viewBlock(cur).data(), sizeof(cur));
+        }
+        g_sink = g_sink + cur;
+    })});
+    out.push_back({"pointer_chase", "bytes", block_size, hops, hops * sizeof(uint32_t), measure([&] {
+        uint32_t cur = 0;
+        for (size_t i = 0; i < hops; ++i) cur = mem.load<uint32_t>(size_t(cur) * block_size);
+        g_sink = g_sink + cur;
+    })});
+}
+
+// Мелкие (4-байтовые) записи по случайным адресам.
+void benchSmallWrites(size_t block_size, size_t blocks, size_t writes, std::vector<Result>& out) {
+    MemoryBlock mem(blocks, block_size);
+    std::vector<size_t> addrs(writes);
+    std::mt19937_64 rng(7);
+    for (size_t& a : addrs) a = rng() % (blocks * block_size / 4) * 4;
+
+    out.push_back({"small_write", "copy", block_size, writes, writes * 4, measure([&] {
+        for (size_t i = 0; i < writes; ++i) {
+            const size_t block_id = addrs[i] / block_size;
+            std::vector<uint8_t> data = mem.readBlock(block_id);  // read-modify-write
+            const uint32_t value = static_cast<uint32_t>(i);
+            std::memcpy(data.data() + addrs[i] % block_size, &value, sizeof(value));
+            mem.writeBlock(block_id, data);
+        }
+    })});
+    out.push_back({"small_write", "view", block_size, writes, writes * 4, measure([&] {
+        for (size_t i = 0; i < writes; ++i) {
+            const uint32_t value = static_cast<uint32_t>(i);
+            std::memcpy(mem.mutableBlock(addrs[i] / block_size).data() + addrs[i] % block_size,
+                        &value, sizeof(value));
+        }
+    })});
+    out.push_back({"small_write", "bytes", block_size, writes, writes * 4, measure([&] {
+        for (size_t i = 0; i < writes; ++i) mem.store<uint32_t>(addrs[i], static_cast<uint32_t>(i));
+    })});
+}
+
+void printCsv(const std::vector<Result>& results) {
+    std::cout << "benchmark,api,block_size,operations,bytes,seconds,ns_per_op,mb_per_s\n";
+    for (const Result& r : results) {
+        std::cout << r.benchmark << ',' << r.api << ',' << r.block_size << ',' << r.operations << ','
+                  << r.bytes << ',' << r.seconds << ',' << r.seconds * 1e9 / r.operations << ','
+                  << r.bytes / r.seconds / 1e6 << '\n';
+    }
+}
+
+void printJson(const std::vector<Result>& results) {
+    std::cout << "[\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::cout << "  {\"benchmark\": \"" << r.benchmark << "\", \"api\": \"" << r.api
+                  << "\", \"block_size\": " << r.block_size << ", \"operations\": " << r.operations
+                  << ", \"bytes\": " << r.bytes << ", \"seconds\": " << r.seconds
+                  << ", \"ns_per_op\": " << r.seconds * 1e9 / r.operations
+                  << ", \"mb_per_s\": " << r.bytes / r.seconds / 1e6 << "}"
+                  << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    std::cout << "]\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bool json = false;
+    bool quick = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--json") {
+            json = true;
+        } else if (arg == "--quick") {
+            quick = true;
+        } else {
+            std::cerr << "Usage: bench_memory [--json] [--quick]" << std::endl;
+            return 1;
+        }
+    }
+
+    const size_t memory_bytes = quick ? (1u << 20) : (64u << 20);
+    const size_t rounds = quick ? 1 : 8;
+    const size_t ops = quick ? 10000 : 2000000;
+
+    std::vector<Result> results;
+    for (size_t block_size : {64u, 512u, 4096u}) {
+        const size_t blocks = memory_bytes / block_size;
+        benchSequential(block_size, blocks, rounds, results);
+        benchPointerChase(block_size, blocks, ops, results);
+        benchSmallWrites(block_size, blocks, ops, results);
+    }
+
+    if (json) {
+        printJson(results);
+    } else {
+        printCsv(results);
+    }
+    return 0;
+}
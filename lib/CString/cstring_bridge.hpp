@@ -3,6 +3,7 @@
 
 #include <string>
 #include <cstdlib>
+#include <cstring>
 
 extern "C" {
 #include "CString/string_utils.h"
@@ -10,27 +11,47 @@ extern "C" {
 
 namespace cstring_bridge {
 
-inline std::string toStdString(const String* s) {
-    if (!s) return {};
+// Передать fn(char) байты строки в UTF-8 по порядку (без выделения памяти).
+template <typename Fn>
+inline void forEachByte(const String* s, Fn&& fn) {
+    if (!s) return;
     const size_t n = cstrlen(s);
-    if (n == static_cast<size_t>(-1)) return {};
+    if (n == static_cast<size_t>(-1)) return;
     const my_utf* utf = reinterpret_cast<const my_utf*>(s->data);
-    if (!utf) return {};
-    std::string out;
-    out.reserve(n);
+    if (!utf) return;
     for (size_t i = 0; i < n; ++i) {
         const uint8_t sz = utf[i].size;
         for (uint8_t j = 0; j < sz && j < 4; ++j) {
             const char c = static_cast<char>(utf[i].bytes[j]);
             if (c == '\0') break;
-            out.push_back(c);
+            fn(c);
         }
     }
+}
+
+inline std::string toStdString(const String* s) {
+    std::string out;
+    forEachByte(s, [&](char c) { out.push_back(c); });
     return out;
 }
 
+// Сравнение без промежуточной std::string.
+inline bool equals(const String* s, const char* str, size_t len) {
+    size_t pos = 0;
+    bool same = true;
+    forEachByte(s, [&](char c) {
+        same = same && pos < len && str[pos] == c;
+        ++pos;
+    });
+    return same && pos == len;
+}
+
+inline bool equals(const String* s, const std::string& str) {
+    return equals(s, str.data(), str.size());
+}
+
 inline bool equalsLit(const String* s, const char* lit) {
-    return toStdString(s) == (lit ? lit : "");
+    return lit ? equals(s, lit, std::strlen(lit)) : equals(s, "", 0);
 }
 
 inline String* makeString(const char* utf8) {
@@ -0,0 +1,144 @@
+#ifndef LZ_CODEC_HPP
+#define LZ_CODEC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * Быстрый LZ-кодек в стиле LZ4 (собственный формат, без внешних зависимостей).
+ *
+ * Поток — последовательность записей:
+ *   token: старшие 4 бита — длина литералов, младшие — длина совпадения - 4
+ *          (значение 15 означает продолжение байтами 255, ..., <255);
+ *   литералы;
+ *   смещение совпадения (2 байта, little-endian, 1..65535).
+ * Последняя запись содержит только литералы.
+ *
+ * Сжатие — один проход с хэш-таблицей по 4-байтовым префиксам.
+ */
+namespace lz {
+
+constexpr size_t kMinMatch = 4;
+constexpr size_t kMaxOffset = 65535;
+constexpr unsigned kHashBits = 12;
+
+inline uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t hash4(const uint8_t* p) {
+    return (read32(p) * 2654435761u) >> (32 - kHashBits);
+}
+
+inline void writeLength(std::vector<uint8_t>& out, size_t length) {
+    while (length >= 255) {
+        out.push_back(255);
+        length -= 255;
+    }
+    out.push_back(static_cast<uint8_t>(length));
+}
+
+inline void emitSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literal_len,
+                         size_t offset, size_t match_len) {
+    const size_t match_code = match_len ? match_len - kMinMatch : 0;
+    const uint8_t token = static_cast<uint8_t>((literal_len < 15 ? literal_len : 15) << 4 |
+                                               (match_code < 15 ? match_code : 15));
+    out.push_back(token);
+    if (literal_len >= 15) writeLength(out, literal_len - 15);
+    out.insert(out.end(), literals, literals + literal_len);
+    if (match_len == 0) return;
+    out.push_back(static_cast<uint8_t>(offset & 0xFF));
+    out.push_back(static_cast<uint8_t>(offset >> 8));
+    if (match_code >= 15) writeLength(out, match_code - 15);
+}
+
+inline std::vector<uint8_t> compress(const uint8_t* src, size_t len) {
+    std::vector<uint8_t> out;
+    out.reserve(len / 2 + 16);
+    uint32_t table[size_t(1) << kHashBits];
+    std::memset(table, 0xFF, sizeof(table));  // 0xFFFFFFFF — пустая ячейка
+
+    size_t anchor = 0;  // начало ещё не выведенных литералов
+    size_t pos = 0;
+    while (pos + kMinMatch <= len) {
+        const uint32_t h = hash4(src + pos);
+        const uint32_t candidate = table[h];
+        table[h] = static_cast<uint32_t>(pos);
+        if (candidate == 0xFFFFFFFFu || pos - candidate > kMaxOffset ||
+            read32(src + candidate) != read32(src + pos)) {
+            ++pos;
+            continue;
+        }
+        size_t match_len = kMinMatch;
+        while (pos + match_len < len && src[candidate + match_len] == src[pos + match_len]) {
+            ++match_len;
+        }
+        emitSequence(out, src + anchor, pos - anchor, pos - candidate, match_len);
+        pos += match_len;
+        anchor = pos;
+    }
+    emitSequence(out, src + anchor, len - anchor, 0, 0);
+    return out;
+}
+
+inline std::vector<uint8_t> compress(const std::vector<uint8_t>& data) {
+    return compress(data.data(), data.size());
+}
+
+// Распаковать ровно dst_len байт; повреждённый поток — std::runtime_error.
+inline void decompress(const uint8_t* src, size_t len, uint8_t* dst, size_t dst_len) {
+    auto corrupt = [] { throw std::runtime_error("LZ: corrupt compressed data"); };
+    auto readLength = [&](size_t& in, size_t base) {
+        size_t length = base;
+        if (base == 15) {
+            uint8_t b;
+            do {
+                if (in >= len) corrupt();
+                b = src[in++];
+                length += b;
+            } while (b == 255);
+        }
+        return length;
+    };
+
+    size_t in = 0;
+    size_t out = 0;
+    while (in < len) {
+        const uint8_t token = src[in++];
+        const size_t literal_len = readLength(in, token >> 4);
+        if (literal_len > len - in || literal_len > dst_len - out) corrupt();
+        if (literal_len) std::memcpy(dst + out, src + in, literal_len);
+        in += literal_len;
+        out += literal_len;
+        if (in == len) break;  // последняя запись — только литералы
+
+        if (len - in < 2) corrupt();
+        const size_t offset = src[in] | (static_cast<size_t>(src[in + 1]) << 8);
+        in += 2;
+        const size_t match_len = readLength(in, token & 0x0F) + kMinMatch;
+        if (offset == 0 || offset > out || match_len > dst_len - out) corrupt();
+        const uint8_t* from = dst + out - offset;
+        if (offset >= match_len) {
+            std::memcpy(dst + out, from, match_len);
+        } else {
+            for (size_t i = 0; i < match_len; ++i) dst[out + i] = from[i];  // перекрытие: повтор образца
+        }
+        out += match_len;
+    }
+    if (out != dst_len) corrupt();
+}
+
+inline std::vector<uint8_t> decompress(const std::vector<uint8_t>& data, size_t original_size) {
+    std::vector<uint8_t> out(original_size);
+    decompress(data.data(), data.size(), out.data(), out.size());
+    return out;
+}
+
+} // namespace lz
+
+#endif // LZ_CODEC_HPP
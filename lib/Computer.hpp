@@ -3,8 +3,10 @@
 
 #include "CPU/StackMachine.hpp"
 #include "Memory/MemoryBlock.hpp"
+#include "Memory/GuestAllocator.hpp"
 #include "BIOS/Bios.hpp"
 #include "Disk/HardDrive.hpp"
+#include "DMA/DmaController.hpp"
 #include "VirtualFS/virtual_file_system.h"
 #include "LazySequence/Sequence.h"
 #include "LazySequence/LazySequence.h"
@@ -21,12 +23,17 @@
 class Computer {
 private:
     std::unique_ptr<MemoryBlock> ram;
+    std::unique_ptr<GuestAllocator> ram_allocator;
     std::unique_ptr<HardDrive> hdd;
+    // Создаётся при первом обращении (getDMA): объявлен после RAM и диска,
+    // поэтому останавливается раньше них.
+    std::unique_ptr<DmaController> dma;
     Bios bios;
     std::unique_ptr<vfs::VirtualFileSystem> filesystem;
     std::unique_ptr<StackMachine> cpu;
     bool powered_on;
     bool os_loaded;
+    std::string disk_image_path;  // пусто — диск только в памяти
     
     // Программа загрузки (bootloader)
     std::shared_ptr<LazySequence<Command>> bootloader_stream;
@@ -94,7 +101,9 @@ private:
 public:
     Computer()
         : ram(nullptr),
+          ram_allocator(nullptr),
           hdd(nullptr),
+          dma(nullptr),
           bios(),
           filesystem(nullptr),
           cpu(nullptr),
@@ -112,7 +121,11 @@ public:
         // BIOS инициализирует системы после включения (в этой модели —
         // компоненты создаёт Computer, а BIOS переводит CPU в 16-bit и делает POST).
         ram = std::make_unique<MemoryBlock>(1024, 64);
-        hdd = std::make_unique<HardDrive>(4096, 512);
+        ram_allocator = std::make_unique<GuestAllocator>(*ram);
+        hdd = disk_image_path.empty()
+                  ? std::make_unique<HardDrive>(4096, 512)
+                  : std::make_unique<HardDrive>(disk_image_path, 4096, 512);
+        hdd->enableCache(256);  // 128 КБ горячих блоков диска
         filesystem = std::make_unique<vfs::VirtualFileSystem>();
         initializeSystemDirectories();
 
@@ -135,10 +148,17 @@ public:
         bios.reset();
         cpu.reset();
         filesystem.reset();
+        dma.reset();
         hdd.reset();
+        ram_allocator.reset();
         ram.reset();
     }
 
+    // Файл образа диска на хосте; применяется при следующем powerOn().
+    // Содержимое диска сохраняется между выключениями и запусками.
+    void setDiskImage(const std::string& path) { disk_image_path = path; }
+    const std::string& getDiskImage() const { return disk_image_path; }
+
     bool isPoweredOn() const {
         return powered_on;
     }
@@ -187,10 +207,27 @@ public:
         if (!powered_on || !ram) throw std::runtime_error("RAM is not initialized");
         return *ram;
     }
+    GuestAllocator& getAllocator() {
+        if (!powered_on || !ram_allocator) throw std::runtime_error("RAM allocator is not initialized");
+        return *ram_allocator;
+    }
     HardDrive& getHDD() {
         if (!powered_on || !hdd) throw std::runtime_error("HDD is not initialized");
         return *hdd;
     }
+    // Контроллер DMA запускается при первом обращении: он работает с RAM и
+    // диском из своего потока, поэтому их хранилища переводятся в
+    // потокобезопасный режим только тогда (без DMA байтовые операции RAM
+    // остаются одним memcpy).
+    DmaController& getDMA() {
+        if (!powered_on || !ram || !hdd) throw std::runtime_error("DMA controller is not initialized");
+        if (!dma) {
+            ram->enableThreadSafety();
+            hdd->getStorage().enableThreadSafety();
+            dma = std::make_unique<DmaController>(*ram, *hdd);
+        }
+        return *dma;
+    }
     vfs::VirtualFileSystem& getFileSystem() {
         if (!powered_on || !filesystem) throw std::runtime_error("FileSystem is not initialized");
         return *filesystem;
@@ -0,0 +1,273 @@
+#ifndef DMA_CONTROLLER_HPP
+#define DMA_CONTROLLER_HPP
+
+#include "Memory/MemoryBlock.hpp"
+#include "Disk/HardDrive.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+enum class DmaDirection {
+    DiskToRam,
+    RamToDisk
+};
+
+// Дескриптор: count блоков диска начиная с disk_block <-> байты RAM
+// [ram_addr, ram_addr + count * размер блока диска).
+struct DmaDescriptor {
+    DmaDirection direction = DmaDirection::DiskToRam;
+    size_t disk_block = 0;
+    size_t block_count = 0;
+    size_t ram_addr = 0;
+};
+
+enum class DmaStatus {
+    Completed,
+    Failed,
+    Cancelled
+};
+
+// Запись очереди завершений.
+struct DmaCompletion {
+    uint64_t id = 0;
+    DmaStatus status = DmaStatus::Completed;
+    size_t bytes = 0;
+    std::string error;
+};
+
+/**
+ * DmaController — асинхронные пересылки между RAM и HardDrive.
+ * submit() проверяет цепочку дескрипторов, ставит её в очередь и сразу
+ * возвращает номер; цепочки выполняются по порядку фоновым потоком.
+ * Данные копируются одним memcpy из кадра диска в кадр RAM (и обратно)
+ * без промежуточных буферов. О завершении сообщают очередь завершений
+ * (pollCompletion/waitCompletion) и необязательный обработчик прерывания,
+ * вызываемый в потоке контроллера.
+ *
+ * RAM и хранилище диска должны быть в потокобезопасном режиме
+ * (MemoryBlock::enableThreadSafety), если к ним одновременно обращается CPU.
+ */
+class DmaController {
+public:
+    using InterruptHandler = std::function<void(const DmaCompletion&)>;
+
+private:
+    struct Chain {
+        uint64_t id;
+        std::vector<DmaDescriptor> descriptors;
+    };
+
+    MemoryBlock& ram;
+    HardDrive& hdd;
+
+    std::mutex mutex;
+    std::condition_variable work_ready;
+    std::condition_variable completion_ready;
+    std::deque<Chain> pending;
+    std::deque<DmaCompletion> completions;
+    InterruptHandler interrupt_handler;
+    uint64_t next_id = 1;
+    bool busy = false;
+    bool stopping = false;
+    size_t completed_chains = 0;
+    size_t bytes_transferred = 0;
+    std::thread worker;
+
+    void checkDescriptor(const DmaDescriptor& d) const {
+        const size_t disk_blocks = hdd.getTotalBlocks();
+        if (d.disk_block > disk_blocks || d.block_count > disk_blocks - d.disk_block) {
+            throw std::out_of_range("DMA: disk range out of bounds: block " +
+                                    std::to_string(d.disk_block) + ", count " +
+                                    std::to_string(d.block_count));
+        }
+        const size_t bytes = d.block_count * hdd.getBlockSize();
+        const size_t capacity = ram.getCapacity();
+        if (d.ram_addr > capacity || bytes > capacity - d.ram_addr) {
+            throw std::out_of_range("DMA: RAM range out of bounds: address " +
+                                    std::to_string(d.ram_addr) + ", bytes " +
+                                    std::to_string(bytes));
+        }
+    }
+
+    // Блок за блоком под блокировкой блока диска: порядок захвата всегда
+    // «диск, затем RAM», поток контроллера один. Сумма блока проверяется
+    // (обновляется) под той же блокировкой.
+    size_t execute(const DmaDescriptor& d) {
+        const size_t block_size = hdd.getBlockSize();
+        if (d.direction == DmaDirection::DiskToRam) {
+            size_t done = 0;
+            const bool intact = hdd.readRawBlocks(d.disk_block, d.block_count, [&](size_t i, BlockView block) {
+                ram.write(d.ram_addr + i * block_size, block.data(), block.size());
+                ++done;
+            });
+            if (!intact) {
+                throw std::runtime_error("DMA: checksum mismatch in disk block " +
+                                         std::to_string(d.disk_block + done));
+            }
+        } else {
+            hdd.writeRawBlocks(d.disk_block, d.block_count, [&](size_t i, MutableBlockView block) {
+                ram.read(d.ram_addr + i * block_size, block.data(), block.size());
+            });
+        }
+        hdd.chargeAccess(d.direction == DmaDirection::RamToDisk, d.disk_block, d.block_count);
+        return d.block_count * block_size;
+    }
+
+    // Запись попадает в очередь завершений, затем вызывается прерывание;
+    // контроллер простаивает (waitIdle) только после его обработки.
+    void complete(DmaCompletion completion) {
+        InterruptHandler handler;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++completed_chains;
+            bytes_transferred += completion.bytes;
+            completions.push_back(completion);
+            handler = interrupt_handler;
+        }
+        completion_ready.notify_all();
+        if (handler) handler(completion);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy = false;
+        }
+        completion_ready.notify_all();
+    }
+
+    void run() {
+        for (;;) {
+            Chain chain;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                work_ready.wait(lock, [this] { return stopping || !pending.empty(); });
+                if (pending.empty()) return;
+                chain = std::move(pending.front());
+                pending.pop_front();
+                busy = true;
+            }
+            DmaCompletion completion;
+            completion.id = chain.id;
+            try {
+                for (const DmaDescriptor& d : chain.descriptors) {
+                    completion.bytes += execute(d);
+                }
+            } catch (const std::exception& e) {
+                completion.status = DmaStatus::Failed;
+                completion.error = e.what();
+            }
+            complete(std::move(completion));
+        }
+    }
+
+public:
+    DmaController(MemoryBlock& ram, HardDrive& hdd)
+        : ram(ram), hdd(hdd), worker(&DmaController::run, this) {}
+
+    DmaController(const DmaController&) = delete;
+    DmaController& operator=(const DmaController&) = delete;
+
+    ~DmaController() { stop(); }
+
+    // Обработчик прерывания о завершении; вызывается в потоке контроллера.
+    void setInterruptHandler(InterruptHandler handler) {
+        std::lock_guard<std::mutex> lock(mutex);
+        interrupt_handler = std::move(handler);
+    }
+
+    // Поставить цепочку в очередь. Дескрипторы проверяются сразу;
+    // некорректная цепочка не ставится (std::out_of_range).
+    uint64_t submit(const std::vector<DmaDescriptor>& descriptors) {
+        for (const DmaDescriptor& d : descriptors) checkDescriptor(d);
+        uint64_t id;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) throw std::runtime_error("DMA controller is stopped");
+            id = next_id++;
+            pending.push_back(Chain{id, descriptors});
+        }
+        work_ready.notify_one();
+        return id;
+    }
+
+    uint64_t submit(const DmaDescriptor& descriptor) {
+        return submit(std::vector<DmaDescriptor>{descriptor});
+    }
+
+    // Забрать первую запись из очереди завершений без ожидания.
+    bool pollCompletion(DmaCompletion& out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (completions.empty()) return false;
+        out = std::move(completions.front());
+        completions.pop_front();
+        return true;
+    }
+
+    // Дождаться завершения цепочки id и забрать её запись из очереди.
+    DmaCompletion waitCompletion(uint64_t id) {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            for (auto it = completions.begin(); it != completions.end(); ++it) {
+                if (it->id == id) {
+                    DmaCompletion result = std::move(*it);
+                    completions.erase(it);
+                    return result;
+                }
+            }
+            if (id >= next_id) {
+                throw std::invalid_argument("Unknown DMA transfer: " + std::to_string(id));
+            }
+            completion_ready.wait(lock);
+        }
+    }
+
+    // Дождаться, пока очередь опустеет и текущая цепочка завершится.
+    void waitIdle() {
+        std::unique_lock<std::mutex> lock(mutex);
+        completion_ready.wait(lock, [this] { return pending.empty() && !busy; });
+    }
+
+    // Остановить поток: текущая цепочка дорабатывает, ожидающие
+    // завершаются со статусом Cancelled.
+    void stop() {
+        std::deque<Chain> cancelled;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) return;
+            stopping = true;
+            cancelled.swap(pending);
+        }
+        work_ready.notify_all();
+        if (worker.joinable()) worker.join();
+        for (const Chain& chain : cancelled) {
+            DmaCompletion completion;
+            completion.id = chain.id;
+            completion.status = DmaStatus::Cancelled;
+            complete(std::move(completion));
+        }
+    }
+
+    size_t getPendingChains() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pending.size() + (busy ? 1 : 0);
+    }
+    size_t getCompletedChains() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return completed_chains;
+    }
+    size_t getBytesTransferred() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return bytes_transferred;
+    }
+
+    bool selfTest() const { return worker.joinable(); }
+};
+
+#endif // DMA_CONTROLLER_HPP
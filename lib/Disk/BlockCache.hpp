@@ -0,0 +1,465 @@
+#ifndef BLOCK_CACHE_HPP
+#define BLOCK_CACHE_HPP
+
+#include "Memory/MemoryBlock.hpp"
+#include "Disk/BlockChecksums.hpp"
+#include "Disk/DiskTiming.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+// Сквозная запись (сразу в хранилище) или отложенная (грязные блоки в кэше).
+enum class CacheMode { WriteThrough, WriteBack };
+
+struct BlockCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    size_t ghost_hits = 0;        // промахи по недавно вытесненным блокам (подстраивают ARC)
+    size_t coalesced_writes = 0;  // записи в уже грязный блок (поглощены без записи в хранилище)
+    size_t writebacks = 0;        // грязных блоков записано в хранилище
+    size_t writeback_runs = 0;    // непрерывных участков среди них (операций устройства)
+
+    double getHitRate() const {
+        const size_t total = hits + misses;
+        return total ? static_cast<double>(hits) / static_cast<double>(total) : 0.0;
+    }
+};
+
+/**
+ * BlockCache — кэш блоков диска с вытеснением ARC (Adaptive Replacement Cache).
+ *
+ * Резидентные блоки делятся на T1 (встречены один раз) и T2 (повторно);
+ * призрачные списки B1/B2 помнят номера недавно вытесненных блоков без
+ * данных. Промах по B1 увеличивает целевой размер T1 (выгодна давность),
+ * промах по B2 — уменьшает (выгодна частота). Однократный проход по
+ * большому файлу вытесняет только T1 и не вымывает горячие блоки из T2.
+ *
+ * Буферы выдаются привязанными (Pin): привязанный блок не вытесняется,
+ * поэтому представление остаётся действительным на всё время операции.
+ * Если все буферы привязаны, новый блок не помещается — std::runtime_error.
+ *
+ * При сквозной записи владелец пишет в хранилище и обновляет копию через
+ * updateIfResident(). При отложенной — modify() меняет только копию и
+ * помечает её грязной; в хранилище она попадает при вытеснении или
+ * writeBack(), который пишет грязные блоки по возрастанию номеров,
+ * непрерывными участками. Записи в хранилище в обход владельца (DMA)
+ * требуют invalidate(), чтения в обход — предварительного writeBack().
+ * Метаданные защищены мьютексом.
+ */
+class BlockCache {
+private:
+    enum ListId : size_t { T1 = 0, T2 = 1, B1 = 2, B2 = 3 };
+
+    struct Entry {
+        ListId list;
+        std::list<size_t>::iterator pos;
+        std::unique_ptr<uint8_t[]> data;  // только у резидентных (T1, T2)
+        size_t pins = 0;
+        bool stale = false;  // сброшен при привязке; удаляется после отвязки
+        bool dirty = false;  // копия новее хранилища
+    };
+
+    MemoryBlock& backing;
+    const size_t capacity;
+    const size_t block_size;
+    size_t target_t1 = 0;        // адаптивный целевой размер T1 (p в ARC)
+    std::list<size_t> lists[4];  // в начале — недавно использованные
+    std::unordered_map<size_t, Entry> entries;
+    std::vector<std::unique_ptr<uint8_t[]>> spare;  // буферы вытесненных блоков
+    size_t dirty_blocks = 0;
+    BlockCacheStats stats;
+    DiskTimingModel* timing = nullptr;  // учёт обращений к устройству, если задан
+    BlockChecksums* checksums = nullptr;  // суммы блоков хранилища, если заданы
+    mutable std::mutex mutex;
+
+    void chargeAccess(bool write, size_t block_id) {
+        if (timing) timing->access(write, block_id, 1);
+    }
+
+    size_t sizeOf(ListId id) const { return lists[id].size(); }
+    size_t residentCount() const { return sizeOf(T1) + sizeOf(T2); }
+
+    void moveTo(Entry& entry, size_t block_id, ListId to) {
+        lists[entry.list].erase(entry.pos);
+        lists[to].push_front(block_id);
+        entry.list = to;
+        entry.pos = lists[to].begin();
+    }
+
+    // Самый давний непривязанный блок списка; end(), если все привязаны.
+    std::list<size_t>::iterator victimIn(ListId id) {
+        for (auto it = lists[id].end(); it != lists[id].begin();) {
+            --it;
+            if (entries.at(*it).pins == 0) return it;
+        }
+        return lists[id].end();
+    }
+
+    [[noreturn]] static void allPinned() {
+        throw std::runtime_error("Block cache: all buffers are pinned");
+    }
+
+    // REPLACE из ARC: вытеснить блок из T1 или T2 в его призрачный список.
+    void replace(bool hit_in_b2) {
+        const size_t t1 = sizeOf(T1);
+        ListId from = t1 > 0 && (t1 > target_t1 || (hit_in_b2 && t1 == target_t1)) ? T1 : T2;
+        auto victim = victimIn(from);
+        if (victim == lists[from].end()) {
+            from = from == T1 ? T2 : T1;
+            victim = victimIn(from);
+            if (victim == lists[from].end()) allPinned();
+        }
+        const size_t block_id = *victim;
+        Entry& entry = entries.at(block_id);
+        if (entry.dirty) {
+            writeBackEntry(block_id, entry);
+            ++stats.writeback_runs;
+        }
+        spare.push_back(std::move(entry.data));
+        moveTo(entry, block_id, from == T1 ? B1 : B2);
+        ++stats.evictions;
+    }
+
+    void dropLru(ListId id) {
+        entries.erase(lists[id].back());
+        lists[id].pop_back();
+    }
+
+    void writeBackEntry(size_t block_id, Entry& entry) {
+        if (!entry.dirty) return;
+        backing.withBlockWrite(block_id, [&](MutableBlockView block) {
+            std::memcpy(block.data(), entry.data.get(), block_size);
+            if (checksums) checksums->update(block_id, block.data());
+        });
+        chargeAccess(true, block_id);
+        entry.dirty = false;
+        --dirty_blocks;
+        ++stats.writebacks;
+    }
+
+    // Удалить запись; грязная копия отбрасывается (вызывающий решает, нужна ли она).
+    void erase(size_t block_id, Entry& entry) {
+        if (entry.dirty) {
+            entry.dirty = false;
+            --dirty_blocks;
+        }
+        if (entry.data) spare.push_back(std::move(entry.data));
+        lists[entry.list].erase(entry.pos);
+        entries.erase(block_id);
+    }
+
+    // Выделить буфер; fill == false — содержимое будет целиком перезаписано.
+    void load(Entry& entry, size_t block_id, bool fill) {
+        if (!spare.empty()) {
+            entry.data = std::move(spare.back());
+            spare.pop_back();
+        } else {
+            entry.data.reset(new uint8_t[block_size]);
+        }
+        if (!fill) return;
+        // Сумма сверяется под блокировкой блока: запись в обход кэша
+        // обновляет данные и сумму под той же блокировкой.
+        const bool intact = backing.withBlockRead(block_id, [&](BlockView block) {
+            std::memcpy(entry.data.get(), block.data(), block_size);
+            return !checksums || checksums->verify(block_id, block.data());
+        });
+        chargeAccess(false, block_id);
+        if (!intact) {
+            // Повреждённый блок не остаётся в кэше
+            erase(block_id, entry);
+            throw std::runtime_error("Checksum mismatch in block " + std::to_string(block_id));
+        }
+    }
+
+    // Найти или загрузить блок и привязать его.
+    uint8_t* acquire(size_t block_id, bool fill = true) {
+        auto it = entries.find(block_id);
+        if (it != entries.end() && (it->second.list == T1 || it->second.list == T2)) {
+            Entry& entry = it->second;
+            if (!entry.stale) {
+                ++stats.hits;
+                moveTo(entry, block_id, T2);
+                ++entry.pins;
+                return entry.data.get();
+            }
+            // Устаревший привязанный буфер: новый читатель получает свежую копию
+            // после отвязки старого, а пока — читает хранилище в обход кэша.
+            return nullptr;
+        }
+
+        ++stats.misses;
+        const bool full = residentCount() >= capacity;
+        if (it != entries.end()) {
+            // Призрачный промах: подстроить баланс T1/T2
+            Entry& entry = it->second;
+            ++stats.ghost_hits;
+            const bool in_b2 = entry.list == B2;
+            if (!in_b2) {
+                target_t1 = std::min(capacity, target_t1 + std::max<size_t>(sizeOf(B2) / sizeOf(B1), 1));
+            } else {
+                target_t1 -= std::min(target_t1, std::max<size_t>(sizeOf(B1) / sizeOf(B2), 1));
+            }
+            if (full) replace(in_b2);
+            moveTo(entry, block_id, T2);
+            load(entry, block_id, fill);
+            ++entry.pins;
+            return entry.data.get();
+        }
+
+        if (sizeOf(T1) + sizeOf(B1) >= capacity) {
+            if (sizeOf(T1) < capacity) {
+                dropLru(B1);
+                if (full) replace(false);
+            } else {
+                // T1 занимает весь кэш: вытесняем без призрака
+                auto victim = victimIn(T1);
+                if (victim == lists[T1].end()) allPinned();
+                Entry& evicted = entries.at(*victim);
+                if (evicted.dirty) {
+                    writeBackEntry(*victim, evicted);
+                    ++stats.writeback_runs;
+                }
+                erase(*victim, evicted);
+                ++stats.evictions;
+            }
+        } else {
+            const size_t total = residentCount() + sizeOf(B1) + sizeOf(B2);
+            if (total >= capacity) {
+                if (total >= 2 * capacity) dropLru(B2);
+                if (full) replace(false);
+            }
+        }
+        lists[T1].push_front(block_id);
+        Entry& entry = entries[block_id];
+        entry.list = T1;
+        entry.pos = lists[T1].begin();
+        load(entry, block_id, fill);
+        ++entry.pins;
+        return entry.data.get();
+    }
+
+    void unpin(size_t block_id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(block_id);
+        if (it == entries.end()) return;
+        Entry& entry = it->second;
+        if (--entry.pins == 0 && entry.stale) erase(block_id, entry);
+    }
+
+public:
+    /**
+     * Pin — привязанный буфер блока; отвязывается в деструкторе.
+     * Пустой Pin (operator bool == false) не ссылается на кэш.
+     */
+    class Pin {
+    private:
+        BlockCache* cache = nullptr;
+        size_t block_id = 0;
+        uint8_t* frame = nullptr;
+
+    public:
+        Pin() = default;
+        Pin(BlockCache* cache, size_t block_id, uint8_t* frame)
+            : cache(cache), block_id(block_id), frame(frame) {}
+
+        Pin(const Pin&) = delete;
+        Pin& operator=(const Pin&) = delete;
+
+        Pin(Pin&& other) noexcept
+            : cache(other.cache), block_id(other.block_id), frame(other.frame) {
+            other.cache = nullptr;
+        }
+
+        Pin& operator=(Pin&& other) noexcept {
+            if (this != &other) {
+                release();
+                cache = other.cache;
+                block_id = other.block_id;
+                frame = other.frame;
+                other.cache = nullptr;
+            }
+            return *this;
+        }
+
+        ~Pin() { release(); }
+
+        void release() {
+            if (cache) cache->unpin(block_id);
+            cache = nullptr;
+        }
+
+        explicit operator bool() const { return cache != nullptr; }
+        size_t getBlockId() const { return block_id; }
+        BlockView view() const { return BlockView(frame, cache ? cache->block_size : 0); }
+    };
+
+    BlockCache(MemoryBlock& backing, size_t capacity_blocks)
+        : backing(backing), capacity(capacity_blocks), block_size(backing.getBlockSize()) {
+        if (capacity_blocks == 0) {
+            throw std::invalid_argument("Block cache capacity must be positive");
+        }
+    }
+
+    BlockCache(const BlockCache&) = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+
+    // Привязать блок (загрузив при промахе). Пустой Pin — блок устарел
+    // и ещё привязан; такой блок читается из хранилища напрямую.
+    Pin pin(size_t block_id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint8_t* frame = acquire(block_id);
+        return frame ? Pin(this, block_id, frame) : Pin();
+    }
+
+    // Вызвать fn(BlockView) для блока; попадание обслуживается без копирования.
+    template <typename Fn>
+    void read(size_t block_id, Fn&& fn) {
+        Pin p = pin(block_id);
+        if (p) {
+            fn(p.view());
+        } else {
+            backing.withBlockRead(block_id, [&](BlockView block) {
+                if (checksums) checksums->require(block_id, block.data());
+                fn(block);
+            });
+            std::lock_guard<std::mutex> lock(mutex);
+            chargeAccess(false, block_id);
+        }
+    }
+
+    // Применить ту же модификацию к копии блока, если он в кэше.
+    template <typename Fn>
+    void updateIfResident(size_t block_id, Fn&& fn) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(block_id);
+        if (it == entries.end() || !it->second.data || it->second.stale) return;
+        fn(MutableBlockView(it->second.data.get(), block_size));
+    }
+
+    // Отложенная запись: изменить копию блока (загрузив её при промахе) и
+    // пометить грязной. overwrite — fn перезаписывает блок целиком, и при
+    // промахе он не читается из хранилища.
+    template <typename Fn>
+    void modify(size_t block_id, Fn&& fn, bool overwrite = false) {
+        std::unique_lock<std::mutex> lock(mutex);
+        uint8_t* frame = acquire(block_id, !overwrite);
+        if (!frame) {
+            // Устаревший привязанный буфер будет удалён — пишем в хранилище
+            chargeAccess(true, block_id);
+            lock.unlock();
+            backing.withBlockWrite(block_id, [&](MutableBlockView block) {
+                fn(block);
+                if (checksums) checksums->update(block_id, block.data());
+            });
+            return;
+        }
+        Entry& entry = entries.at(block_id);
+        --entry.pins;
+        fn(MutableBlockView(frame, block_size));
+        if (entry.dirty) {
+            ++stats.coalesced_writes;
+        } else {
+            entry.dirty = true;
+            ++dirty_blocks;
+        }
+    }
+
+    // Записать грязные блоки из [start, start + count) в хранилище по
+    // возрастанию номеров. Возвращает число записанных блоков.
+    size_t writeBack(size_t start, size_t count) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (dirty_blocks == 0) return 0;
+        std::vector<size_t> dirty;
+        if (count <= entries.size()) {
+            for (size_t block_id = start; block_id < start + count; ++block_id) {
+                auto it = entries.find(block_id);
+                if (it != entries.end() && it->second.dirty) dirty.push_back(block_id);
+            }
+        } else {
+            for (const auto& e : entries) {
+                if (e.second.dirty && e.first >= start && e.first - start < count) dirty.push_back(e.first);
+            }
+            std::sort(dirty.begin(), dirty.end());
+        }
+        for (size_t i = 0; i < dirty.size(); ++i) {
+            if (i == 0 || dirty[i] != dirty[i - 1] + 1) ++stats.writeback_runs;
+            writeBackEntry(dirty[i], entries.at(dirty[i]));
+        }
+        return dirty.size();
+    }
+
+    size_t writeBackAll() { return writeBack(0, std::numeric_limits<size_t>::max()); }
+
+    // Забыть копии блоков [start, start + count) (они изменены в обход кэша;
+    // грязные копии отбрасываются). Привязанные блоки удаляются после отвязки.
+    void invalidate(size_t start, size_t count) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t block_id = start; block_id < start + count; ++block_id) {
+            auto it = entries.find(block_id);
+            if (it == entries.end()) continue;
+            if (it->second.pins > 0) {
+                it->second.stale = true;
+                if (it->second.dirty) {
+                    it->second.dirty = false;
+                    --dirty_blocks;
+                }
+            } else {
+                erase(block_id, it->second);
+            }
+        }
+    }
+
+    bool contains(size_t block_id) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(block_id);
+        return it != entries.end() && it->second.data && !it->second.stale;
+    }
+
+    // Учитывать промахи и записи в хранилище в модели времени (nullptr — нет).
+    void setTimingModel(DiskTimingModel* model) {
+        std::lock_guard<std::mutex> lock(mutex);
+        timing = model;
+    }
+
+    // Проверять загружаемые блоки и обновлять суммы при записи в хранилище.
+    void setChecksums(BlockChecksums* table) {
+        std::lock_guard<std::mutex> lock(mutex);
+        checksums = table;
+    }
+
+    size_t getCapacity() const { return capacity; }
+    size_t getDirtyBlocks() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return dirty_blocks;
+    }
+    size_t getResidentBlocks() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return residentCount();
+    }
+    // Текущий целевой размер «недавнего» списка T1 (адаптируется ARC).
+    size_t getRecencyTarget() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return target_t1;
+    }
+
+    BlockCacheStats getStats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+    void resetStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats = BlockCacheStats();
+    }
+};
+
+#endif // BLOCK_CACHE_HPP
@@ -0,0 +1,123 @@
+#ifndef BLOCK_CHECKSUMS_HPP
+#define BLOCK_CHECKSUMS_HPP
+
+#include "Disk/Crc32c.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct ChecksumStats {
+    size_t updates = 0;
+    size_t verified = 0;
+    size_t errors = 0;
+};
+
+/**
+ * BlockChecksums — таблица CRC32C блоков диска (по 4 байта на блок).
+ *
+ * Хранится CRC блока, сложенная (xor) с CRC нулевого блока: нулевая
+ * запись означает нулевой блок, поэтому таблица нового диска — просто
+ * нули (и в разреженном файле образа не занимает места).
+ *
+ * Таблица либо своя, либо внешняя область (в образе — отображённый
+ * участок перед данными). Записи читаются и пишутся атомарно, так что
+ * проверка из фонового потока не мешает записи. Найденные расхождения
+ * запоминаются до перезаписи блока.
+ */
+class BlockChecksums {
+private:
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+                  "checksum table entries are stored in place");
+
+    size_t total_blocks;
+    size_t block_size;
+    std::unique_ptr<std::atomic<uint32_t>[]> owned;
+    std::atomic<uint32_t>* table;
+    uint32_t empty_crc;  // CRC блока из нулей
+
+    // Учёт проверок меняется и при чтении (const-методы владельца).
+    std::atomic<size_t> updates{0};
+    mutable std::atomic<size_t> verified{0};
+    mutable std::atomic<size_t> errors{0};
+    mutable std::mutex bad_mutex;
+    mutable std::set<size_t> bad_blocks;
+
+    uint32_t stored(const uint8_t* data) const { return crc32c::compute(data, block_size) ^ empty_crc; }
+
+public:
+    // region — внешняя таблица из total_blocks записей (nullptr — своя, нулевая).
+    BlockChecksums(size_t total_blocks, size_t block_size, uint32_t* region = nullptr)
+        : total_blocks(total_blocks), block_size(block_size) {
+        if (region) {
+            table = reinterpret_cast<std::atomic<uint32_t>*>(region);
+        } else {
+            owned.reset(new std::atomic<uint32_t>[total_blocks]);
+            for (size_t i = 0; i < total_blocks; ++i) owned[i].store(0, std::memory_order_relaxed);
+            table = owned.get();
+        }
+        const std::vector<uint8_t> zero(block_size, 0);
+        empty_crc = crc32c::compute(zero.data(), block_size);
+    }
+
+    BlockChecksums(const BlockChecksums&) = delete;
+    BlockChecksums& operator=(const BlockChecksums&) = delete;
+
+    // Блок записан: запомнить его сумму (прежнее расхождение снимается).
+    void update(size_t block_id, const uint8_t* data) {
+        table[block_id].store(stored(data), std::memory_order_relaxed);
+        updates.fetch_add(1, std::memory_order_relaxed);
+        if (errors.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(bad_mutex);
+            bad_blocks.erase(block_id);
+        }
+    }
+
+    // Совпадает ли содержимое с суммой в таблице (без учёта в статистике).
+    bool matches(size_t block_id, const uint8_t* data) const {
+        return table[block_id].load(std::memory_order_relaxed) == stored(data);
+    }
+
+    void reportBad(size_t block_id) const {
+        errors.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(bad_mutex);
+        bad_blocks.insert(block_id);
+    }
+
+    // Проверить прочитанный блок; расхождение запоминается.
+    bool verify(size_t block_id, const uint8_t* data) const {
+        verified.fetch_add(1, std::memory_order_relaxed);
+        if (matches(block_id, data)) return true;
+        reportBad(block_id);
+        return false;
+    }
+
+    // Как verify, но расхождение — исключение.
+    void require(size_t block_id, const uint8_t* data) const {
+        if (!verify(block_id, data)) {
+            throw std::runtime_error("Checksum mismatch in block " + std::to_string(block_id));
+        }
+    }
+
+    std::vector<size_t> getBadBlocks() const {
+        std::lock_guard<std::mutex> lock(bad_mutex);
+        return std::vector<size_t>(bad_blocks.begin(), bad_blocks.end());
+    }
+
+    ChecksumStats getStats() const {
+        ChecksumStats result;
+        result.updates = updates.load(std::memory_order_relaxed);
+        result.verified = verified.load(std::memory_order_relaxed);
+        result.errors = errors.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    size_t getTotalBlocks() const { return total_blocks; }
+};
+
+#endif // BLOCK_CHECKSUMS_HPP
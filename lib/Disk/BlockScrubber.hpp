@@ -0,0 +1,130 @@
+#ifndef BLOCK_SCRUBBER_HPP
+#define BLOCK_SCRUBBER_HPP
+
+#include "Disk/HardDrive.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+struct ScrubStats {
+    size_t passes = 0;          // полных обходов диска
+    size_t scanned_blocks = 0;  // проверено занятых блоков
+    size_t errors = 0;          // блоков с расхождением суммы
+};
+
+/**
+ * BlockScrubber — фоновая проверка блоков диска по таблице CRC32C.
+ * Обходит занятые блоки по кругу и сверяет содержимое хранилища с суммой
+ * (HardDrive::scrubBlock); найденные повреждения попадают в
+ * HardDrive::getChecksumErrors().
+ *
+ * Свободные блоки пропускаются по битовой карте FreeSpaceManager
+ * (HardDrive::findNextUsedBlock) — таблица файлов не потокобезопасна,
+ * а карта читается пословно атомарно.
+ *
+ * Работа ограничена бюджетом ввода-вывода: фоновый режим (start) читает
+ * не больше blocks_per_slice блоков раз в interval и не мешает основной
+ * нагрузке больше, чем на эту долю пропускной способности.
+ */
+class BlockScrubber {
+private:
+    HardDrive& hdd;
+    size_t cursor = 0;
+    ScrubStats stats;
+
+    std::mutex mutex;  // stats, cursor; потоки — через running/wake
+    std::condition_variable wake;
+    bool running = false;
+    std::thread worker;
+
+    // Проверить следующий занятый блок; false — занятых блоков до конца
+    // диска нет, обход завершён и курсор вернулся в начало.
+    bool step() {
+        const size_t block = hdd.findNextUsedBlock(cursor);
+        if (block >= hdd.getTotalBlocks()) {
+            cursor = 0;
+            ++stats.passes;
+            return false;
+        }
+        ++stats.scanned_blocks;
+        if (!hdd.scrubBlock(block)) ++stats.errors;
+        cursor = block + 1;
+        return true;
+    }
+
+public:
+    explicit BlockScrubber(HardDrive& hdd) : hdd(hdd) {}
+
+    BlockScrubber(const BlockScrubber&) = delete;
+    BlockScrubber& operator=(const BlockScrubber&) = delete;
+
+    ~BlockScrubber() { stop(); }
+
+    // Проверить не больше max_blocks занятых блоков (детерминированный
+    // шаг). Обход продолжается с начала диска, но пустой диск не крутится.
+    size_t runBlocks(size_t max_blocks) {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t scanned = 0;
+        while (scanned < max_blocks) {
+            const bool from_start = cursor == 0;
+            if (step()) {
+                ++scanned;
+            } else if (from_start) {
+                break;
+            }
+        }
+        return scanned;
+    }
+
+    // Обход занятых блоков от текущей позиции до конца диска.
+    void runPass() {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (step()) {}
+    }
+
+    // Фоновая проверка: blocks_per_slice блоков раз в interval. Хранилище
+    // должно быть потокобезопасным — с ним одновременно работает CPU.
+    void start(std::chrono::milliseconds interval, size_t blocks_per_slice) {
+        if (!hdd.getStorage().isThreadSafe()) {
+            throw std::runtime_error("Background scrubbing requires thread-safe disk storage");
+        }
+        if (blocks_per_slice == 0) throw std::invalid_argument("Scrub budget must be positive");
+        std::lock_guard<std::mutex> lock(mutex);
+        if (running) return;
+        running = true;
+        worker = std::thread([this, interval, blocks_per_slice] {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (running) {
+                lock.unlock();
+                runBlocks(blocks_per_slice);
+                lock.lock();
+                wake.wait_for(lock, interval, [this] { return !running; });
+            }
+        });
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        wake.notify_all();
+        if (worker.joinable()) worker.join();
+    }
+
+    bool isRunning() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return running;
+    }
+
+    ScrubStats getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+};
+
+#endif // BLOCK_SCRUBBER_HPP
@@ -0,0 +1,101 @@
+#ifndef CRC32C_HPP
+#define CRC32C_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define SIMPLEVM_CRC32C_SSE42 1
+#include <nmmintrin.h>
+#else
+#define SIMPLEVM_CRC32C_SSE42 0
+#endif
+
+// CRC32C (полином Кастаньоли 0x1EDC6F41, как в iSCSI/ext4/Btrfs).
+// На x86-64 с SSE4.2 считается инструкцией crc32 (выбор при первом вызове
+// по cpuid), иначе — таблично, по 8 байт за шаг (slicing-by-8).
+namespace crc32c {
+
+namespace detail {
+
+struct Tables {
+    uint32_t t[8][256];
+
+    Tables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int k = 0; k < 8; ++k) crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+            t[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int s = 1; s < 8; ++s) t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+        }
+    }
+};
+
+inline const Tables& tables() {
+    static const Tables instance;
+    return instance;
+}
+
+// crc — внутреннее (инвертированное) состояние.
+inline uint32_t software(uint32_t crc, const uint8_t* p, size_t n) {
+    const Tables& tb = tables();
+    while (n >= 8) {
+        uint32_t lo, hi;
+        std::memcpy(&lo, p, 4);
+        std::memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = tb.t[7][lo & 0xFF] ^ tb.t[6][(lo >> 8) & 0xFF] ^ tb.t[5][(lo >> 16) & 0xFF] ^
+              tb.t[4][lo >> 24] ^ tb.t[3][hi & 0xFF] ^ tb.t[2][(hi >> 8) & 0xFF] ^
+              tb.t[1][(hi >> 16) & 0xFF] ^ tb.t[0][hi >> 24];
+        p += 8;
+        n -= 8;
+    }
+    while (n--) crc = (crc >> 8) ^ tb.t[0][(crc ^ *p++) & 0xFF];
+    return crc;
+}
+
+#if SIMPLEVM_CRC32C_SSE42
+__attribute__((target("sse4.2")))
+inline uint32_t hardware(uint32_t crc, const uint8_t* p, size_t n) {
+    uint64_t c = crc;
+    while (n >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        c = _mm_crc32_u64(c, word);
+        p += 8;
+        n -= 8;
+    }
+    uint32_t c32 = static_cast<uint32_t>(c);
+    while (n--) c32 = _mm_crc32_u8(c32, *p++);
+    return c32;
+}
+
+inline bool hasHardware() {
+    static const bool supported = __builtin_cpu_supports("sse4.2");
+    return supported;
+}
+#else
+inline bool hasHardware() { return false; }
+#endif
+
+} // namespace detail
+
+// Продолжить CRC32C значения crc (0 — начало) байтами [p, p + n).
+inline uint32_t extend(uint32_t crc, const void* data, size_t n) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+#if SIMPLEVM_CRC32C_SSE42
+    if (detail::hasHardware()) return ~detail::hardware(~crc, p, n);
+#endif
+    return ~detail::software(~crc, p, n);
+}
+
+inline uint32_t compute(const void* data, size_t n) { return extend(0, data, n); }
+
+inline bool isHardwareAccelerated() { return detail::hasHardware(); }
+
+} // namespace crc32c
+
+#endif // CRC32C_HPP
@@ -0,0 +1,398 @@
+#ifndef DISK_IMAGE_HPP
+#define DISK_IMAGE_HPP
+
+#include "Memory/FrameStore.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if SIMPLEVM_HAS_MMAP
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+/**
+ * DiskImage — файл образа диска на хосте, отображённый в память через
+ * mmap(MAP_SHARED): блоки читаются и пишутся прямо в отображении, без
+ * копирования, и переживают перезапуск. Открытие образа не читает данные —
+ * страницы подгружаются ядром при первом обращении.
+ *
+ * Раскладка файла:
+ *   [заголовок, kHeaderSize байт][два слота метаданных]
+ *   [журнал, journal_capacity байт][суммы блоков, по 4 байта на блок]
+ *   [блоки данных]
+ * Заголовок хранит геометрию, номер действующего слота метаданных и его
+ * порядковый номер, точку контрольной записи журнала (начало и номер
+ * первой транзакции) и контрольную сумму самого заголовка. Слот начинается
+ * со своего заголовка: порядковый номер, размер и сумма метаданных.
+ * Метаданные, журнал и суммы блоков — непрозрачные байты владельца
+ * (HardDrive хранит в них таблицу файлов, журнал её изменений и CRC32C
+ * блоков, см. MetadataJournal и BlockChecksums). В новом образе все они
+ * нулевые.
+ *
+ * writeCheckpoint() пишет метаданные в свободный слот и переключает на него
+ * заголовок только после msync слота: сбой посреди записи оставляет
+ * действующим прежний слот. Заголовок занимает первые 136 байт файла и
+ * перезаписывается в пределах одного сектора. Размер таблицы файлов заранее
+ * не ограничен (с дедупликацией на блок может ссылаться сколько угодно
+ * файлов), поэтому слот, в который метаданные не помещаются, переносится в
+ * конец файла и растёт хотя бы вдвое; заголовок хранит смещение и размер
+ * каждого слота.
+ *
+ * flush() синхронно сбрасывает всё отображение (msync), flushBlocks() —
+ * блоки данных диапазона и их суммы, flushJournal() — область журнала.
+ */
+class DiskImage {
+public:
+    static constexpr size_t kHeaderSize = 4096;
+    static constexpr uint32_t kVersion = 5;
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t header_size;
+        uint64_t block_size;
+        uint64_t total_blocks;
+        uint64_t metadata_offset[2];
+        uint64_t metadata_capacity[2];  // размер слота вместе с его заголовком
+        uint64_t metadata_slot;      // действующий слот
+        uint64_t metadata_seq;       // его порядковый номер
+        uint64_t journal_offset;
+        uint64_t journal_capacity;
+        uint64_t journal_start;  // смещение первой живой транзакции в кольце
+        uint64_t journal_seq;    // её номер
+        uint64_t checksums_offset;
+        uint64_t data_offset;
+        uint64_t checksum;  // по всем предыдущим полям
+    };
+
+    // Заголовок слота метаданных; данные следуют сразу за ним.
+    struct MetadataSlot {
+        uint64_t seq;            // растёт с каждой контрольной записью
+        uint64_t size;
+        uint64_t data_checksum;
+        uint64_t checksum;       // по предыдущим полям
+    };
+
+    static constexpr char kMagic[8] = {'S', 'V', 'M', 'D', 'I', 'S', 'K', '\0'};
+
+    std::string path;
+    int fd = -1;
+    uint8_t* base = nullptr;
+    size_t mapped_bytes = 0;
+    Header* header = nullptr;
+    size_t file_bytes = 0;
+    // Раскладка слотов; у свободного слота она может опережать заголовок
+    // (слот уже перенесён, но ещё не стал действующим).
+    uint64_t slot_offset[2] = {0, 0};
+    uint64_t slot_capacity[2] = {0, 0};
+    // Отображение всего файла после его роста: перенесённые слоты лежат за
+    // пределами base. nullptr — файл не рос.
+    uint8_t* grown = nullptr;
+    size_t grown_bytes = 0;
+
+    // FNV-1a, 64 бита.
+    static uint64_t checksum(const uint8_t* p, size_t n) {
+        uint64_t h = 0xCBF29CE484222325ull;
+        for (size_t i = 0; i < n; ++i) h = (h ^ p[i]) * 0x100000001B3ull;
+        return h;
+    }
+
+    static uint64_t headerChecksum(const Header& h) {
+        return checksum(reinterpret_cast<const uint8_t*>(&h), offsetof(Header, checksum));
+    }
+
+    static uint64_t slotChecksum(const MetadataSlot& s) {
+        return checksum(reinterpret_cast<const uint8_t*>(&s), offsetof(MetadataSlot, checksum));
+    }
+
+    uint8_t* slotMap() const { return grown ? grown : base; }
+    size_t slotMapBytes() const { return grown ? grown_bytes : mapped_bytes; }
+    uint8_t* slotAt(uint64_t slot) const { return slotMap() + slot_offset[slot]; }
+
+    // Записать слот целиком: данные, затем заголовок слота.
+    void fillSlot(uint64_t slot, uint64_t seq, const std::vector<uint8_t>& metadata) {
+        uint8_t* p = slotAt(slot);
+        if (!metadata.empty()) std::memcpy(p + sizeof(MetadataSlot), metadata.data(), metadata.size());
+        MetadataSlot s{seq, metadata.size(), checksum(metadata.data(), metadata.size()), 0};
+        s.checksum = slotChecksum(s);
+        std::memcpy(p, &s, sizeof(s));
+    }
+
+    // Цел ли слот с порядковым номером seq (заголовок и данные).
+    bool slotIntact(uint64_t slot, uint64_t seq) const {
+        MetadataSlot s;
+        std::memcpy(&s, slotAt(slot), sizeof(s));
+        return s.checksum == slotChecksum(s) && s.seq == seq &&
+               s.size <= slot_capacity[slot] - sizeof(MetadataSlot) &&
+               checksum(slotAt(slot) + sizeof(MetadataSlot), s.size) == s.data_checksum;
+    }
+
+    // Синхронно сбросить байты [offset, offset + length) отображения map
+    // длиной map_bytes (границы расширяются до страниц).
+    void syncRange(uint8_t* map, size_t map_bytes, size_t offset, size_t length) {
+#if SIMPLEVM_HAS_MMAP
+        if (length == 0) return;
+        const size_t page = pageSize();
+        const size_t from = offset / page * page;
+        const size_t to = std::min(map_bytes, roundUp(offset + length, page));
+        if (msync(map + from, to - from, MS_SYNC) != 0) {
+            fail(std::string("msync failed: ") + std::strerror(errno));
+        }
+#else
+        (void)map;
+        (void)map_bytes;
+        (void)offset;
+        (void)length;
+#endif
+    }
+
+    // Перенести свободный слот в конец файла так, чтобы в него поместились
+    // bytes байт метаданных; прежнее место слота больше не используется.
+    void growSlot(uint64_t slot, size_t bytes) {
+#if SIMPLEVM_HAS_MMAP
+        const size_t page = pageSize();
+        const size_t offset = roundUp(file_bytes, page);
+        const size_t capacity =
+            roundUp(std::max(2 * (sizeof(MetadataSlot) + bytes), 2 * slot_capacity[slot]), page);
+        if (ftruncate(fd, static_cast<off_t>(offset + capacity)) != 0) {
+            fail(std::string("cannot resize: ") + std::strerror(errno));
+        }
+        void* p = mmap(nullptr, offset + capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) fail(std::string("mmap failed: ") + std::strerror(errno));
+        if (grown) munmap(grown, grown_bytes);
+        grown = static_cast<uint8_t*>(p);
+        grown_bytes = file_bytes = offset + capacity;
+        slot_offset[slot] = offset;
+        slot_capacity[slot] = capacity;
+#else
+        (void)slot;
+        (void)bytes;
+#endif
+    }
+
+    static size_t pageSize() {
+#if SIMPLEVM_HAS_MMAP
+        const long size = sysconf(_SC_PAGESIZE);
+        if (size > 0) return static_cast<size_t>(size);
+#endif
+        return kHeaderSize;
+    }
+
+    static size_t roundUp(size_t value, size_t align) {
+        return (value + align - 1) / align * align;
+    }
+
+    [[noreturn]] void fail(const std::string& what) const {
+        throw std::runtime_error("Disk image " + path + ": " + what);
+    }
+
+    explicit DiskImage(std::string path) : path(std::move(path)) {}
+
+#if SIMPLEVM_HAS_MMAP
+    void mapFile(size_t bytes) {
+        void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) fail(std::string("mmap failed: ") + std::strerror(errno));
+        base = static_cast<uint8_t*>(p);
+        mapped_bytes = file_bytes = bytes;
+        header = reinterpret_cast<Header*>(base);
+    }
+
+    void loadSlots() {
+        for (uint64_t s = 0; s < 2; ++s) {
+            slot_offset[s] = header->metadata_offset[s];
+            slot_capacity[s] = header->metadata_capacity[s];
+        }
+    }
+#endif
+
+public:
+    DiskImage(const DiskImage&) = delete;
+    DiskImage& operator=(const DiskImage&) = delete;
+
+    ~DiskImage() {
+#if SIMPLEVM_HAS_MMAP
+        if (grown) munmap(grown, grown_bytes);
+        if (base) munmap(base, mapped_bytes);
+        if (fd >= 0) close(fd);
+#endif
+    }
+
+    // Создать новый образ (существующий файл перезаписывается).
+    // Данные — разреженный файл из нулей; место на хосте занимается по мере записи.
+    static std::unique_ptr<DiskImage> create(const std::string& path, size_t total_blocks,
+                                             size_t block_size) {
+        if (total_blocks == 0 || block_size == 0) {
+            throw std::invalid_argument("Disk image geometry must be non-zero");
+        }
+        std::unique_ptr<DiskImage> image(new DiskImage(path));
+#if SIMPLEVM_HAS_MMAP
+        // Таблица файлов: заголовок, имена и списки блоков. Это начальный
+        // размер слота; большая таблица переносит слот в конец файла.
+        const size_t metadata_capacity = roundUp(64 * 1024 + total_blocks * 16, kHeaderSize);
+        // Журнал: несколько групп изменений между контрольными записями таблицы.
+        const size_t journal_offset = kHeaderSize + 2 * metadata_capacity;
+        const size_t journal_capacity = roundUp(64 * 1024 + total_blocks * 8, kHeaderSize);
+        const size_t checksums_offset = journal_offset + journal_capacity;
+        const size_t data_offset = checksums_offset + roundUp(total_blocks * 4, kHeaderSize);
+        const size_t bytes = data_offset + roundUp(total_blocks * block_size, kHeaderSize);
+
+        image->fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (image->fd < 0) image->fail(std::string("cannot create: ") + std::strerror(errno));
+        if (ftruncate(image->fd, static_cast<off_t>(bytes)) != 0) {
+            image->fail(std::string("cannot resize: ") + std::strerror(errno));
+        }
+        image->mapFile(bytes);
+
+        Header h{};
+        std::memcpy(h.magic, kMagic, sizeof(kMagic));
+        h.version = kVersion;
+        h.header_size = static_cast<uint32_t>(kHeaderSize);
+        h.block_size = block_size;
+        h.total_blocks = total_blocks;
+        for (uint64_t s = 0; s < 2; ++s) {
+            h.metadata_offset[s] = kHeaderSize + s * metadata_capacity;
+            h.metadata_capacity[s] = metadata_capacity;
+        }
+        h.metadata_slot = 0;
+        h.metadata_seq = 1;
+        h.journal_offset = journal_offset;
+        h.journal_capacity = journal_capacity;
+        h.journal_start = 0;
+        h.journal_seq = 1;
+        h.checksums_offset = checksums_offset;
+        h.data_offset = data_offset;
+        h.checksum = headerChecksum(h);
+        *image->header = h;
+        image->loadSlots();
+        image->fillSlot(0, h.metadata_seq, {});
+        image->flush();
+#else
+        (void)total_blocks;
+        (void)block_size;
+        image->fail("disk images require mmap support");
+#endif
+        return image;
+    }
+
+    // Открыть существующий образ; заголовок и метаданные проверяются.
+    static std::unique_ptr<DiskImage> open(const std::string& path) {
+        std::unique_ptr<DiskImage> image(new DiskImage(path));
+#if SIMPLEVM_HAS_MMAP
+        image->fd = ::open(path.c_str(), O_RDWR);
+        if (image->fd < 0) image->fail(std::string("cannot open: ") + std::strerror(errno));
+        struct stat st;
+        if (fstat(image->fd, &st) != 0) image->fail(std::string("cannot stat: ") + std::strerror(errno));
+        const size_t bytes = static_cast<size_t>(st.st_size);
+        if (bytes < kHeaderSize) image->fail("file is too small");
+        image->mapFile(bytes);
+
+        const Header& h = *image->header;
+        if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) image->fail("bad magic");
+        if (h.version != kVersion) image->fail("unsupported version " + std::to_string(h.version));
+        if (h.checksum != headerChecksum(h)) image->fail("header checksum mismatch");
+        bool slots_fit = true;
+        for (uint64_t s = 0; s < 2; ++s) {
+            slots_fit = slots_fit && h.metadata_offset[s] >= kHeaderSize && h.metadata_offset[s] <= bytes &&
+                        h.metadata_capacity[s] >= sizeof(MetadataSlot) &&
+                        h.metadata_capacity[s] <= bytes - h.metadata_offset[s];
+        }
+        if (h.block_size == 0 || !slots_fit || h.metadata_slot > 1 || h.journal_offset < kHeaderSize ||
+            h.journal_start >= h.journal_capacity ||
+            h.checksums_offset < h.journal_offset + h.journal_capacity ||
+            h.checksums_offset % 4 != 0 ||
+            h.data_offset < h.checksums_offset + h.total_blocks * 4 ||
+            h.total_blocks > (bytes - h.data_offset) / h.block_size) {
+            image->fail("inconsistent geometry");
+        }
+        image->loadSlots();
+        if (!image->slotIntact(h.metadata_slot, h.metadata_seq)) image->fail("metadata checksum mismatch");
+#else
+        image->fail("disk images require mmap support");
+#endif
+        return image;
+    }
+
+    static bool exists(const std::string& path) {
+#if SIMPLEVM_HAS_MMAP
+        struct stat st;
+        return ::stat(path.c_str(), &st) == 0;
+#else
+        (void)path;
+        return false;
+#endif
+    }
+
+    // Начало области блоков (выровнено по kHeaderSize).
+    uint8_t* data() const { return base + header->data_offset; }
+    size_t getTotalBlocks() const { return header->total_blocks; }
+    size_t getBlockSize() const { return header->block_size; }
+    const std::string& getPath() const { return path; }
+
+    uint8_t* journalRegion() const { return base + header->journal_offset; }
+    size_t getJournalCapacity() const { return header->journal_capacity; }
+    size_t getJournalStart() const { return header->journal_start; }
+    uint64_t getJournalSeq() const { return header->journal_seq; }
+
+    // Таблица сумм блоков: total_blocks записей по 4 байта.
+    uint32_t* checksumTable() const { return reinterpret_cast<uint32_t*>(base + header->checksums_offset); }
+
+    // Метаданные действующего слота.
+    std::vector<uint8_t> readMetadata() const {
+        MetadataSlot s;
+        std::memcpy(&s, slotAt(header->metadata_slot), sizeof(s));
+        const uint8_t* p = slotAt(header->metadata_slot) + sizeof(MetadataSlot);
+        return std::vector<uint8_t>(p, p + s.size);
+    }
+
+    // Контрольная запись: метаданные — в свободный слот (при нехватке места
+    // он переносится и растёт) и на диск, затем
+    // заголовок переключается на этот слот вместе с новой точкой журнала
+    // (транзакции до journal_seq уже отражены в метаданных и при открытии
+    // не воспроизводятся) и тоже сбрасывается на диск.
+    void writeCheckpoint(const std::vector<uint8_t>& metadata, size_t journal_start, uint64_t journal_seq) {
+        const uint64_t slot = 1 - header->metadata_slot;
+        if (sizeof(MetadataSlot) + metadata.size() > slot_capacity[slot]) growSlot(slot, metadata.size());
+        const uint64_t seq = header->metadata_seq + 1;
+        fillSlot(slot, seq, metadata);
+        syncRange(slotMap(), slotMapBytes(), slot_offset[slot], sizeof(MetadataSlot) + metadata.size());
+        header->metadata_offset[slot] = slot_offset[slot];
+        header->metadata_capacity[slot] = slot_capacity[slot];
+        header->metadata_slot = slot;
+        header->metadata_seq = seq;
+        header->journal_start = journal_start;
+        header->journal_seq = journal_seq;
+        header->checksum = headerChecksum(*header);
+        syncRange(base, mapped_bytes, 0, sizeof(Header));
+    }
+
+    // Синхронно сбросить весь файл (данные, метаданные, заголовок); после
+    // роста файла он целиком покрыт отображением grown.
+    void flush() {
+#if SIMPLEVM_HAS_MMAP
+        if (msync(slotMap(), slotMapBytes(), MS_SYNC) != 0) {
+            fail(std::string("msync failed: ") + std::strerror(errno));
+        }
+#endif
+    }
+
+    // Синхронно сбросить блоки данных [first_block, first_block + count)
+    // и их суммы.
+    void flushBlocks(size_t first_block, size_t count) {
+        syncRange(base, mapped_bytes, header->data_offset + first_block * header->block_size,
+                  count * header->block_size);
+        syncRange(base, mapped_bytes, header->checksums_offset + first_block * 4, count * 4);
+    }
+
+    // Синхронно сбросить только область журнала.
+    void flushJournal() { syncRange(base, mapped_bytes, header->journal_offset, header->journal_capacity); }
+};
+
+#endif // DISK_IMAGE_HPP
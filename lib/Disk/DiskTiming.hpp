@@ -0,0 +1,165 @@
+#ifndef DISK_TIMING_HPP
+#define DISK_TIMING_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+enum class DiskKind { Hdd, Ssd };
+
+// Параметры устройства; время — в микросекундах, скорость — в МБ/с
+// (1 МБ/с = 1 байт/мкс).
+struct DiskTimingParams {
+    DiskKind kind = DiskKind::Hdd;
+    double min_seek_us = 500;       // HDD: переход на соседнюю дорожку
+    double max_seek_us = 12000;     // HDD: через весь диск
+    double rpm = 7200;              // HDD: скорость вращения
+    double read_latency_us = 80;    // SSD: фиксированная задержка чтения
+    double write_latency_us = 20;   // SSD: фиксированная задержка записи
+    size_t channels = 1;            // запросов, обслуживаемых параллельно
+    double bandwidth_mb_s = 150;    // скорость передачи
+
+    static DiskTimingParams hdd(double rpm = 7200) {
+        DiskTimingParams p;
+        p.rpm = rpm;
+        return p;
+    }
+
+    static DiskTimingParams ssd(size_t channels = 8) {
+        DiskTimingParams p;
+        p.kind = DiskKind::Ssd;
+        p.channels = channels;
+        p.bandwidth_mb_s = 500;
+        return p;
+    }
+};
+
+struct DiskTimingStats {
+    size_t requests = 0;
+    size_t seeks = 0;            // HDD: непоследовательных обращений
+    size_t bytes = 0;
+    double seek_us = 0;
+    double rotation_us = 0;
+    double transfer_us = 0;
+    double service_us = 0;       // суммарное время обслуживания
+    double latency_us = 0;       // суммарно от выдачи до завершения (с ожиданием)
+    double virtual_time_us = 0;  // заполняется getStats()
+
+    double getAverageLatency() const { return requests ? latency_us / requests : 0.0; }
+
+    // Смоделированная пропускная способность, МБ/с.
+    double getThroughput() const { return virtual_time_us > 0 ? bytes / virtual_time_us : 0.0; }
+};
+
+/**
+ * DiskTimingModel — модель времени обслуживания обращений к устройству
+ * в виртуальном времени (реальное выполнение не замедляется).
+ *
+ * HDD: поиск дорожки растёт как корень из расстояния в блоках (от
+ * min_seek_us до max_seek_us), плюс в среднем пол-оборота диска;
+ * обращение, продолжающее предыдущее, платит только за передачу.
+ * SSD: фиксированная задержка плюс передача; channels запросов
+ * обслуживаются параллельно.
+ *
+ * Синхронное обращение (wait) сдвигает часы до своего завершения.
+ * Асинхронные обращения выдаются в текущий момент и встают в очередь
+ * к наименее занятому каналу — так моделируется глубина очереди;
+ * drain() ждёт завершения всех. Потокобезопасна.
+ */
+class DiskTimingModel {
+private:
+    DiskTimingParams params;
+    size_t total_blocks;
+    size_t block_size;
+    mutable std::mutex mutex;
+    double now = 0;                   // момент выдачи следующего обращения
+    std::vector<double> channel_free; // когда освобождается канал
+    size_t head = 0;                  // блок за последним обслуженным (HDD)
+    DiskTimingStats stats;
+
+    double horizon() const {
+        return std::max(now, *std::max_element(channel_free.begin(), channel_free.end()));
+    }
+
+public:
+    DiskTimingModel(const DiskTimingParams& params, size_t total_blocks, size_t block_size)
+        : params(params), total_blocks(total_blocks), block_size(block_size),
+          channel_free(params.kind == DiskKind::Hdd ? 1 : std::max<size_t>(params.channels, 1), 0.0) {
+        if (params.bandwidth_mb_s <= 0 || (params.kind == DiskKind::Hdd && params.rpm <= 0)) {
+            throw std::invalid_argument("Disk timing parameters must be positive");
+        }
+    }
+
+    // Обращение к блокам [block, block + count); возвращает задержку
+    // от выдачи до завершения в мкс.
+    double access(bool write, size_t block, size_t count, bool wait = true) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const size_t bytes = count * block_size;
+        double seek = 0;
+        double rotation = 0;
+        double fixed = 0;
+        if (params.kind == DiskKind::Hdd) {
+            if (block != head) {
+                const size_t distance = block > head ? block - head : head - block;
+                const double fraction = static_cast<double>(distance) / static_cast<double>(total_blocks);
+                seek = params.min_seek_us + (params.max_seek_us - params.min_seek_us) * std::sqrt(fraction);
+                rotation = 30e6 / params.rpm;
+                ++stats.seeks;
+            }
+            head = block + count;
+        } else {
+            fixed = write ? params.write_latency_us : params.read_latency_us;
+        }
+        const double transfer = static_cast<double>(bytes) / params.bandwidth_mb_s;
+        const double service = seek + rotation + fixed + transfer;
+
+        const double issued = now;
+        auto channel = std::min_element(channel_free.begin(), channel_free.end());
+        const double start = std::max(issued, *channel);
+        const double end = start + service;
+        *channel = end;
+        if (wait) now = end;
+
+        ++stats.requests;
+        stats.bytes += bytes;
+        stats.seek_us += seek;
+        stats.rotation_us += rotation;
+        stats.transfer_us += transfer;
+        stats.service_us += service;
+        stats.latency_us += end - issued;
+        return end - issued;
+    }
+
+    // Дождаться завершения всех выданных обращений.
+    void drain() {
+        std::lock_guard<std::mutex> lock(mutex);
+        now = horizon();
+    }
+
+    double getVirtualTime() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return horizon();
+    }
+
+    DiskTimingStats getStats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        DiskTimingStats result = stats;
+        result.virtual_time_us = horizon();
+        return result;
+    }
+
+    const DiskTimingParams& getParams() const { return params; }
+
+    // Сбросить часы и статистику (головка остаётся на месте).
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex);
+        now = 0;
+        std::fill(channel_free.begin(), channel_free.end(), 0.0);
+        stats = DiskTimingStats{};
+    }
+};
+
+#endif // DISK_TIMING_HPP
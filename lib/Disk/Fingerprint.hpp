@@ -0,0 +1,100 @@
+#ifndef FINGERPRINT_HPP
+#define FINGERPRINT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// 128-битный отпечаток содержимого блока (MurmurHash3 x64/128).
+// Не криптографический: совпадение отпечатков — повод сравнить байты.
+struct Fingerprint {
+    uint64_t lo = 0;
+    uint64_t hi = 0;
+
+    bool operator==(const Fingerprint& other) const { return lo == other.lo && hi == other.hi; }
+    bool operator!=(const Fingerprint& other) const { return !(*this == other); }
+};
+
+struct FingerprintHash {
+    size_t operator()(const Fingerprint& f) const { return static_cast<size_t>(f.lo ^ (f.hi >> 7)); }
+};
+
+namespace fingerprint {
+
+namespace detail {
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t fmix(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xFF51AFD7ED558CCDull;
+    k ^= k >> 33;
+    k *= 0xC4CEB9FE1A85EC53ull;
+    k ^= k >> 33;
+    return k;
+}
+
+} // namespace detail
+
+inline Fingerprint compute(const void* data, size_t n, uint64_t seed = 0) {
+    using detail::rotl;
+    constexpr uint64_t c1 = 0x87C37B91114253D5ull;
+    constexpr uint64_t c2 = 0x4CF5AD432745937Full;
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint64_t h1 = seed;
+    uint64_t h2 = seed;
+
+    const size_t blocks = n / 16;
+    for (size_t i = 0; i < blocks; ++i) {
+        uint64_t k1, k2;
+        std::memcpy(&k1, p + i * 16, 8);
+        std::memcpy(&k2, p + i * 16 + 8, 8);
+        k1 *= c1; k1 = rotl(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = rotl(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52DCE729;
+        k2 *= c2; k2 = rotl(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = rotl(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495AB5;
+    }
+
+    const uint8_t* tail = p + blocks * 16;
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+    switch (n & 15) {
+    case 15: k2 ^= uint64_t(tail[14]) << 48; [[fallthrough]];
+    case 14: k2 ^= uint64_t(tail[13]) << 40; [[fallthrough]];
+    case 13: k2 ^= uint64_t(tail[12]) << 32; [[fallthrough]];
+    case 12: k2 ^= uint64_t(tail[11]) << 24; [[fallthrough]];
+    case 11: k2 ^= uint64_t(tail[10]) << 16; [[fallthrough]];
+    case 10: k2 ^= uint64_t(tail[9]) << 8; [[fallthrough]];
+    case 9:
+        k2 ^= uint64_t(tail[8]);
+        k2 *= c2; k2 = rotl(k2, 33); k2 *= c1; h2 ^= k2;
+        [[fallthrough]];
+    case 8: k1 ^= uint64_t(tail[7]) << 56; [[fallthrough]];
+    case 7: k1 ^= uint64_t(tail[6]) << 48; [[fallthrough]];
+    case 6: k1 ^= uint64_t(tail[5]) << 40; [[fallthrough]];
+    case 5: k1 ^= uint64_t(tail[4]) << 32; [[fallthrough]];
+    case 4: k1 ^= uint64_t(tail[3]) << 24; [[fallthrough]];
+    case 3: k1 ^= uint64_t(tail[2]) << 16; [[fallthrough]];
+    case 2: k1 ^= uint64_t(tail[1]) << 8; [[fallthrough]];
+    case 1:
+        k1 ^= uint64_t(tail[0]);
+        k1 *= c1; k1 = rotl(k1, 31); k1 *= c2; h1 ^= k1;
+        break;
+    default:
+        break;
+    }
+
+    h1 ^= n;
+    h2 ^= n;
+    h1 += h2;
+    h2 += h1;
+    h1 = detail::fmix(h1);
+    h2 = detail::fmix(h2);
+    h1 += h2;
+    h2 += h1;
+    return Fingerprint{h1, h2};
+}
+
+} // namespace fingerprint
+
+#endif // FINGERPRINT_HPP
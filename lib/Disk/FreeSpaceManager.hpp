@@ -0,0 +1,254 @@
+#ifndef FREE_SPACE_MANAGER_HPP
+#define FREE_SPACE_MANAGER_HPP
+
+#include "Memory/BitOps.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Непрерывный участок блоков [start, start + length).
+struct Extent {
+    size_t start = 0;
+    size_t length = 0;
+};
+
+/**
+ * FreeSpaceManager — учёт свободных блоков диска.
+ * Битовая карта (1 — блок занят) даёт O(1) проверку блока и пословные
+ * сканы; дерево свободных участков (по началу и по длине) — выделение
+ * непрерывного участка наилучшего размера за O(log n) и слияние соседей
+ * при освобождении.
+ *
+ * Меняется одним потоком. Слова битовой карты атомарны, поэтому isFree()
+ * и findNextUsed() можно вызывать из другого потока (фоновая проверка
+ * диска): они видят карту на какой-то момент, без разрывов внутри слова.
+ */
+class FreeSpaceManager {
+private:
+    static constexpr size_t kWordBits = 64;
+
+    size_t total_blocks;
+    size_t free_blocks;
+    std::vector<std::atomic<uint64_t>> used;          // битовая карта занятых блоков
+    std::map<size_t, size_t> extents_by_start;        // start -> length
+    std::set<std::pair<size_t, size_t>> extents_by_size;  // (length, start)
+
+    void checkRange(size_t start, size_t count) const {
+        if (start > total_blocks || count > total_blocks - start) {
+            throw std::out_of_range("Block range out of bounds: " + std::to_string(start) +
+                                    " + " + std::to_string(count));
+        }
+    }
+
+    uint64_t word(size_t w) const { return used[w].load(std::memory_order_relaxed); }
+
+    void markRange(size_t start, size_t count, bool value) {
+        size_t i = start;
+        const size_t end = start + count;
+        while (i < end) {
+            const unsigned from = static_cast<unsigned>(i % kWordBits);
+            const unsigned to = static_cast<unsigned>(std::min<size_t>(kWordBits, from + (end - i)));
+            const uint64_t mask = bitops::rangeMask(from, to);
+            const uint64_t bits = word(i / kWordBits);
+            used[i / kWordBits].store(value ? bits | mask : bits & ~mask, std::memory_order_relaxed);
+            i += to - from;
+        }
+    }
+
+    size_t findNext(size_t from, bool free) const {
+        for (size_t w = from / kWordBits; w < used.size(); ++w) {
+            uint64_t bits = free ? ~word(w) : word(w);
+            if (w == from / kWordBits) bits &= ~uint64_t(0) << (from % kWordBits);
+            if (bits) {
+                const size_t block = w * kWordBits + bitops::countTrailingZeros(bits);
+                return block < total_blocks ? block : total_blocks;
+            }
+        }
+        return total_blocks;
+    }
+
+    // Все ли блоки диапазона в состоянии value (пословная проверка).
+    bool rangeIs(size_t start, size_t count, bool value) const {
+        size_t i = start;
+        const size_t end = start + count;
+        while (i < end) {
+            const unsigned from = static_cast<unsigned>(i % kWordBits);
+            const unsigned to = static_cast<unsigned>(std::min<size_t>(kWordBits, from + (end - i)));
+            const uint64_t mask = bitops::rangeMask(from, to);
+            const uint64_t bits = word(i / kWordBits) & mask;
+            if (value ? bits != mask : bits != 0) return false;
+            i += to - from;
+        }
+        return true;
+    }
+
+    void insertExtent(size_t start, size_t length) {
+        extents_by_start.emplace(start, length);
+        extents_by_size.emplace(length, start);
+    }
+
+    void eraseExtent(std::map<size_t, size_t>::iterator it) {
+        extents_by_size.erase({it->second, it->first});
+        extents_by_start.erase(it);
+    }
+
+    // Выделить count блоков с начала свободного участка it.
+    Extent takeFrom(std::map<size_t, size_t>::iterator it, size_t count) {
+        const size_t start = it->first;
+        const size_t length = it->second;
+        eraseExtent(it);
+        if (length > count) insertExtent(start + count, length - count);
+        markRange(start, count, true);
+        free_blocks -= count;
+        return Extent{start, count};
+    }
+
+public:
+    explicit FreeSpaceManager(size_t total_blocks)
+        : total_blocks(total_blocks), free_blocks(total_blocks),
+          used((total_blocks + kWordBits - 1) / kWordBits) {
+        for (std::atomic<uint64_t>& w : used) w.store(0, std::memory_order_relaxed);
+        if (total_blocks > 0) insertExtent(0, total_blocks);
+    }
+
+    // Выделить count блоков: один непрерывный участок наименьшего
+    // подходящего размера, а если такого нет — наименьшее число участков,
+    // начиная с самых длинных. При нехватке места ничего не выделяется.
+    std::vector<Extent> allocate(size_t count) {
+        if (count > free_blocks) {
+            throw std::runtime_error("Disk is full: requested " + std::to_string(count) +
+                                     " blocks, free " + std::to_string(free_blocks));
+        }
+        std::vector<Extent> result;
+        if (count == 0) return result;
+        auto fit = extents_by_size.lower_bound({count, 0});
+        if (fit != extents_by_size.end()) {
+            result.push_back(takeFrom(extents_by_start.find(fit->second), count));
+            return result;
+        }
+        size_t remaining = count;
+        while (remaining > 0) {
+            auto largest = std::prev(extents_by_size.end());
+            const size_t n = std::min(largest->first, remaining);
+            result.push_back(takeFrom(extents_by_start.find(largest->second), n));
+            remaining -= n;
+        }
+        return result;
+    }
+
+    // Освободить участок; соседние свободные участки сливаются.
+    void free(size_t start, size_t count) {
+        checkRange(start, count);
+        if (count == 0) return;
+        if (!rangeIs(start, count, true)) {
+            throw std::invalid_argument("Freeing blocks that are not allocated: " +
+                                        std::to_string(start) + " + " + std::to_string(count));
+        }
+        markRange(start, count, false);
+        free_blocks += count;
+
+        size_t new_start = start;
+        size_t new_length = count;
+        auto next = extents_by_start.lower_bound(start);
+        if (next != extents_by_start.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == start) {
+                new_start = prev->first;
+                new_length += prev->second;
+                eraseExtent(prev);
+            }
+        }
+        if (next != extents_by_start.end() && next->first == start + count) {
+            new_length += next->second;
+            eraseExtent(next);
+        }
+        insertExtent(new_start, new_length);
+    }
+
+    void free(const Extent& extent) { free(extent.start, extent.length); }
+
+    // Пометить заданный участок занятым (блоки, выбранные вызывающим).
+    void reserve(size_t start, size_t count) {
+        checkRange(start, count);
+        if (count == 0) return;
+        if (!rangeIs(start, count, false)) {
+            throw std::runtime_error("Blocks are already in use: " + std::to_string(start) +
+                                     " + " + std::to_string(count));
+        }
+        auto it = std::prev(extents_by_start.upper_bound(start));
+        const size_t ext_start = it->first;
+        const size_t ext_length = it->second;
+        eraseExtent(it);
+        if (start > ext_start) insertExtent(ext_start, start - ext_start);
+        const size_t tail = ext_start + ext_length - (start + count);
+        if (tail > 0) insertExtent(start + count, tail);
+        markRange(start, count, true);
+        free_blocks -= count;
+    }
+
+    bool isFree(size_t block) const {
+        checkRange(block, 1);
+        return ((word(block / kWordBits) >> (block % kWordBits)) & 1) == 0;
+    }
+
+    bool isRangeFree(size_t start, size_t count) const {
+        checkRange(start, count);
+        return rangeIs(start, count, false);
+    }
+
+    // Первый свободный блок с номером >= from (скан по словам); total, если нет.
+    size_t findNextFree(size_t from) const { return findNext(from, true); }
+
+    // Первый занятый блок с номером >= from; total, если нет.
+    size_t findNextUsed(size_t from) const { return findNext(from, false); }
+
+    size_t getTotalBlocks() const { return total_blocks; }
+    size_t getFreeBlocks() const { return free_blocks; }
+    size_t getUsedBlocks() const { return total_blocks - free_blocks; }
+    size_t getFreeExtentCount() const { return extents_by_start.size(); }
+    size_t getLargestFreeExtent() const {
+        return extents_by_size.empty() ? 0 : extents_by_size.rbegin()->first;
+    }
+
+    std::vector<Extent> getFreeExtents() const {
+        std::vector<Extent> result;
+        result.reserve(extents_by_start.size());
+        for (const auto& e : extents_by_start) result.push_back(Extent{e.first, e.second});
+        return result;
+    }
+
+    // Внешняя фрагментация: 1 - (наибольший свободный участок / всё свободное).
+    // 0 — всё свободное место непрерывно.
+    double getFragmentation() const {
+        if (free_blocks == 0) return 0.0;
+        return 1.0 - static_cast<double>(getLargestFreeExtent()) / static_cast<double>(free_blocks);
+    }
+
+    // Согласованность битовой карты и дерева участков (для тестов/fsck).
+    bool verify() const {
+        size_t counted = 0;
+        for (size_t w = 0; w < used.size(); ++w) counted += bitops::popCount(word(w));
+        if (counted != total_blocks - free_blocks) return false;
+        size_t in_extents = 0;
+        size_t prev_end = 0;
+        bool first = true;
+        for (const auto& e : extents_by_start) {
+            if (!first && e.first <= prev_end) return false;  // пересечение или несмежные соседи
+            if (!rangeIs(e.first, e.second, false)) return false;
+            in_extents += e.second;
+            prev_end = e.first + e.second;
+            first = false;
+        }
+        return in_extents == free_blocks && extents_by_size.size() == extents_by_start.size();
+    }
+};
+
+#endif // FREE_SPACE_MANAGER_HPP
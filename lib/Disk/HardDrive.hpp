@@ -2,6 +2,15 @@
 #define HARD_DRIVE_HPP
 
 #include "Memory/MemoryBlock.hpp"
+#include "Memory/AtomicBitmap.hpp"
+#include "Disk/DiskImage.hpp"
+#include "Disk/FreeSpaceManager.hpp"
+#include "Disk/BlockCache.hpp"
+#include "Disk/BlockChecksums.hpp"
+#include "Disk/DiskTiming.hpp"
+#include "Disk/Fingerprint.hpp"
+#include "Disk/MetadataJournal.hpp"
+#include "Compression/LzCodec.hpp"
 #include "LazySequence/Sequence.h"
 #include "LazySequence/LazySequence.h"
 #include "CString/cstring_bridge.hpp"
@@ -9,95 +18,1766 @@
 #include <unordered_map>
 #include <vector>
 #include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+// Участок сжатого файла: blocks блоков списка начиная с first_block;
+// stored — длина сжатых данных в них (0 — участок хранится без сжатия).
+struct FileChunk {
+    size_t first_block = 0;
+    size_t blocks = 0;
+    size_t stored = 0;
+};
+
+// Метаданные файла: точная длина в байтах и блоки в порядке следования данных.
+// Байты последнего блока за концом файла всегда нулевые. Сжатый файл
+// хранится участками (по HardDrive::kChunkBlocks блоков данных), каждый —
+// в своей серии блоков; chunks — индекс участков для произвольного доступа.
+struct Inode {
+    size_t size = 0;
+    std::vector<size_t> blocks;
+    std::vector<FileChunk> chunks;
+    std::string name;
+    uint32_t generation = 0;  // увеличивается при освобождении inode
+    bool in_use = false;
+    bool compressed = false;
+};
+
+// Дескриптор открытого файла: номер inode и его поколение. Действителен,
+// пока файл не удалён (перезапись и дозапись его не меняют); номера
+// inode не сохраняются в образе и назначаются заново при монтировании.
+struct FileHandle {
+    size_t inode = std::numeric_limits<size_t>::max();
+    uint32_t generation = 0;
+};
+
+struct JournalStats {
+    size_t commits = 0;      // групповых фиксаций (транзакций в журнале)
+    size_t records = 0;      // изменений таблицы файлов в них
+    size_t checkpoints = 0;  // полных записей таблицы (журнал очищен)
+    size_t replayed = 0;     // транзакций, воспроизведённых при монтировании
+    size_t synced_blocks = 0;  // блоков данных, сброшенных на диск фиксациями
+};
+
+struct DedupStats {
+    size_t logical_blocks = 0;   // блоков в списках блоков файлов
+    size_t physical_blocks = 0;  // занятых блоков диска
+    size_t shared_blocks = 0;    // блоков, на которые больше одной ссылки
+    size_t indexed_blocks = 0;   // блоков в индексе отпечатков
+    size_t hits = 0;             // записанных блоков, найденных на диске
+    size_t cow_copies = 0;       // копий общих блоков перед изменением
+
+    // Во сколько раз данные файлов больше занятого ими места (1 — без экономии).
+    double getRatio() const {
+        return physical_blocks == 0 ? 1.0 : static_cast<double>(logical_blocks) / physical_blocks;
+    }
+};
+
+struct CompressionStats {
+    size_t files = 0;          // сжатых файлов
+    size_t chunks = 0;
+    size_t raw_chunks = 0;     // участков, хранящихся без сжатия (не сжались)
+    size_t logical_bytes = 0;  // длина сжатых файлов
+    size_t stored_blocks = 0;  // занятые ими блоки
+    size_t stored_bytes = 0;   // то же в байтах
+
+    // Во сколько раз данные сжатых файлов больше занятого места.
+    double getRatio() const {
+        return stored_bytes == 0 ? 1.0 : static_cast<double>(logical_bytes) / stored_bytes;
+    }
+};
 
 // имитация жесткого диска
 class HardDrive {
+public:
+    // Участок сжатого файла — столько блоков данных (сжимаются независимо).
+    static constexpr size_t kChunkBlocks = 16;
+
 private:
+    // Метка таблицы файлов в метаданных образа: "SVFT" и версия формата.
+    static constexpr uint64_t kMetadataFormat = 0x0000'0003'5446'5653ull;
+    static constexpr uint64_t kFileCompressed = 1;
+    static constexpr size_t kNoInode = std::numeric_limits<size_t>::max();
+    static constexpr size_t kNoBlock = std::numeric_limits<size_t>::max();
+    static constexpr uint64_t kHashSeed = 0xCBF29CE484222325ull;
+    // Автоматическая групповая фиксация после стольких изменений таблицы файлов.
+    static constexpr size_t kGroupCommitRecords = 64;
+
+    // Записи журнала таблицы файлов (повтор идемпотентен).
+    enum JournalOp : uint64_t {
+        kOpPut = 1,     // имя, длина, число блоков, блоки — файл целиком
+        kOpGrow = 2,    // имя, длина, число новых блоков, новые блоки — дозапись
+        kOpDelete = 3,  // имя
+        kOpPutCompressed = 4,  // как kOpPut, затем число участков и (блоки, сжатая длина) каждого
+    };
+
+    std::unique_ptr<DiskImage> image;  // образ на хосте; nullptr — диск только в памяти
     MemoryBlock storage;
-    // структура мапа имени файла на список блоков, которые он занимает
-    std::unordered_map<std::string, std::vector<size_t>> file_blocks;
+    // CRC32C каждого блока хранилища (в образе — на диске рядом с данными):
+    // обновляются при каждой записи в хранилище, проверяются при чтении.
+    BlockChecksums checksums;
+    std::unique_ptr<DiskTimingModel> timing;  // nullptr — время устройства не моделируется
+    std::unique_ptr<BlockCache> cache;  // nullptr — чтение прямо из хранилища
+    CacheMode cache_mode = CacheMode::WriteThrough;
+    // Таблица inode (индекс — номер inode) и каталог: хэш имени -> номер inode.
+    // По хэшу находятся кандидаты, имя сверяется с inode; это позволяет искать
+    // по String* без построения std::string.
+    std::vector<Inode> inodes;
+    std::vector<size_t> free_inodes;
+    std::unordered_multimap<uint64_t, size_t> directory;
+    // учёт свободных блоков: блоки файлов заняты, остальные свободны
+    FreeSpaceManager free_space;
+    // Число ссылок на каждый блок из списков блоков файлов: при дедупликации
+    // блок может принадлежать нескольким файлам (или повторяться в одном).
+    // Блок занят, пока на него есть ссылки; общий блок перед изменением
+    // копируется (copy-on-write).
+    std::vector<uint32_t> block_refs;
+    // Блоки, закрытые для записи в обход таблицы файлов (writeRawBlocks):
+    // общие (больше одной ссылки) и блоки сжатых файлов. Карта атомарна —
+    // её читают потоки IoRing и DMA.
+    AtomicBitmap raw_locked;
+    // Дедупликация: отпечаток содержимого -> блок и обратная таблица для
+    // блоков в индексе. Индекс — только подсказка: найденный блок сверяется
+    // побайтно (его могли изменить в обход HardDrive).
+    bool dedup = false;
+    std::unordered_map<Fingerprint, size_t, FingerprintHash> dedup_index;
+    std::unordered_map<size_t, Fingerprint> dedup_prints;
+    size_t dedup_hits = 0;
+    size_t cow_copies = 0;
+    // Журнал изменений таблицы файлов (только для диска на образе) и
+    // изменения, ожидающие групповой фиксации.
+    std::unique_ptr<MetadataJournal> journal;
+    std::vector<uint8_t> pending_records;
+    size_t pending_count = 0;
+    // Блоки без ссылок, освобождённые ещё не зафиксированными изменениями:
+    // до фиксации они остаются занятыми, иначе новые данные легли бы в
+    // блоки, на которые после сбоя сошлётся воспроизведённый журнал.
+    std::vector<size_t> deferred_free;
+    JournalStats journal_stats;
+    bool compress_new_files = false;  // новые файлы создаются сжатыми
+
+    size_t blocksFor(size_t bytes) const {
+        const size_t block_size = storage.getBlockSize();
+        return (bytes + block_size - 1) / block_size;
+    }
+
+    // Чтение блока: через кэш, если он включён.
+    template <typename Fn>
+    void readBlock(size_t block_id, Fn&& fn) const {
+        if (cache) {
+            cache->read(block_id, fn);
+        } else {
+            storage.withBlockRead(block_id, [&](BlockView block) {
+                checksums.require(block_id, block.data());
+                fn(block);
+            });
+            if (timing) timing->access(false, block_id, 1);
+        }
+    }
+
+    // Запись блока: при отложенной записи — только в кэш, иначе в хранилище
+    // и в копию в кэше. whole_block — fn перезаписывает блок целиком.
+    template <typename Fn>
+    void modifyBlock(size_t block_id, Fn&& fn, bool whole_block = false) {
+        if (cache && cache_mode == CacheMode::WriteBack) {
+            cache->modify(block_id, fn, whole_block);
+            return;
+        }
+        storage.withBlockWrite(block_id, [&](MutableBlockView block) {
+            fn(block);
+            checksums.update(block_id, block.data());
+        });
+        if (timing) timing->access(true, block_id, 1);
+        if (cache) cache->updateIfResident(block_id, fn);
+    }
+
+    // FNV-1a по байтам имени в UTF-8.
+    static uint64_t hashByte(uint64_t h, char c) {
+        return (h ^ static_cast<uint8_t>(c)) * 0x100000001B3ull;
+    }
+
+    static uint64_t nameHash(const std::string& name) {
+        uint64_t h = kHashSeed;
+        for (char c : name) h = hashByte(h, c);
+        return h;
+    }
+
+    static uint64_t nameHash(const String* name) {
+        uint64_t h = kHashSeed;
+        cstring_bridge::forEachByte(name, [&](char c) { h = hashByte(h, c); });
+        return h;
+    }
+
+    static bool sameName(const std::string& stored, const std::string& name) { return stored == name; }
+    static bool sameName(const std::string& stored, const String* name) {
+        return cstring_bridge::equals(name, stored);
+    }
+
+    static std::string ownedName(const std::string& name) { return name; }
+    static std::string ownedName(const String* name) { return cstring_bridge::toStdString(name); }
+
+    // Номер inode файла или kNoInode.
+    template <typename Name>
+    size_t findInode(const Name& name) const {
+        auto range = directory.equal_range(nameHash(name));
+        for (auto it = range.first; it != range.second; ++it) {
+            if (sameName(inodes[it->second].name, name)) return it->second;
+        }
+        return kNoInode;
+    }
+
+    template <typename Name>
+    size_t requireInode(const Name& name) const {
+        const size_t ino = findInode(name);
+        if (ino == kNoInode) {
+            throw std::runtime_error("File not found: " + ownedName(name));
+        }
+        return ino;
+    }
+
+    // Завести пустой файл (номера освобождённых inode используются повторно).
+    size_t allocInode(std::string name) {
+        size_t ino;
+        if (!free_inodes.empty()) {
+            ino = free_inodes.back();
+            free_inodes.pop_back();
+        } else {
+            ino = inodes.size();
+            inodes.emplace_back();
+        }
+        Inode& inode = inodes[ino];
+        directory.emplace(nameHash(name), ino);
+        inode.name = std::move(name);
+        inode.size = 0;
+        inode.blocks.clear();
+        inode.chunks.clear();
+        inode.compressed = compress_new_files;
+        inode.in_use = true;
+        return ino;
+    }
+
+    // Удалить файл: блоки освобождаются, дескрипторы становятся недействительными.
+    void freeInode(size_t ino) {
+        Inode& inode = inodes[ino];
+        auto range = directory.equal_range(nameHash(inode.name));
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == ino) {
+                directory.erase(it);
+                break;
+            }
+        }
+        releaseFileBlocks(inode);
+        inode.name.clear();
+        inode.size = 0;
+        inode.in_use = false;
+        ++inode.generation;
+        free_inodes.push_back(ino);
+    }
+
+    void checkHandle(FileHandle handle) const {
+        if (handle.inode >= inodes.size() || !inodes[handle.inode].in_use ||
+            inodes[handle.inode].generation != handle.generation) {
+            throw std::runtime_error("Stale file handle");
+        }
+    }
+
+    const Inode& inodeAt(FileHandle handle) const {
+        checkHandle(handle);
+        return inodes[handle.inode];
+    }
+
+    Inode& inodeAt(FileHandle handle) {
+        checkHandle(handle);
+        return inodes[handle.inode];
+    }
+
+    FileHandle handleOf(size_t ino) const { return FileHandle{ino, inodes[ino].generation}; }
+
+    // Выполнить fn(ino) над файлом, создав его при отсутствии; если fn
+    // бросает исключение, только что созданный файл удаляется.
+    template <typename Name, typename Fn>
+    void modifyFile(const Name& name, Fn&& fn) {
+        size_t ino = findInode(name);
+        const bool created = ino == kNoInode;
+        if (created) ino = allocInode(ownedName(name));
+        try {
+            fn(ino);
+        } catch (...) {
+            if (created) freeInode(ino);
+            throw;
+        }
+    }
+
+    // Записать bytes байт в блоки blocks[0..blocksFor(bytes)) (хвост
+    // последнего блока обнуляется).
+    void writeBlocks(const size_t* blocks, const uint8_t* src, size_t bytes) {
+        const size_t block_size = storage.getBlockSize();
+        for (size_t i = 0; i < blocksFor(bytes); ++i) {
+            const size_t offset = i * block_size;
+            const size_t bytes_to_write = std::min(block_size, bytes - offset);
+            modifyBlock(blocks[i], [&](MutableBlockView block) {
+                std::memcpy(block.data(), src + offset, bytes_to_write);
+                std::memset(block.data() + bytes_to_write, 0, block_size - bytes_to_write);
+            }, true);
+        }
+    }
+
+    // Записать данные в блоки и закрепить их за файлом.
+    void storeFile(Inode& inode, const std::vector<uint8_t>& data, std::vector<size_t> blocks) {
+        writeBlocks(blocks.data(), data.data(), data.size());
+        inode.size = data.size();
+        inode.blocks = std::move(blocks);
+    }
+
+    size_t chunkBytes() const { return kChunkBlocks * storage.getBlockSize(); }
+
+    // Длина данных участка c сжатого файла.
+    size_t chunkLength(const Inode& inode, size_t c) const {
+        return std::min(chunkBytes(), inode.size - c * chunkBytes());
+    }
+
+    // Сжать участок; пустой результат — сжатие не экономит ни блока,
+    // участок хранится как есть.
+    std::vector<uint8_t> packChunk(const uint8_t* raw, size_t length) const {
+        std::vector<uint8_t> packed = lz::compress(raw, length);
+        if (blocksFor(packed.size()) >= blocksFor(length)) packed.clear();
+        return packed;
+    }
+
+    // Прочитать участок c сжатого файла в dst (chunkLength байт).
+    void loadChunk(const Inode& inode, size_t c, uint8_t* dst) const {
+        const FileChunk& chunk = inode.chunks[c];
+        const size_t block_size = storage.getBlockSize();
+        const size_t length = chunkLength(inode, c);
+        if (chunk.stored == 0) {
+            for (size_t i = 0; i < chunk.blocks; ++i) {
+                const size_t n = std::min(block_size, length - i * block_size);
+                readBlock(inode.blocks[chunk.first_block + i], [&](BlockView block) {
+                    std::memcpy(dst + i * block_size, block.data(), n);
+                });
+            }
+            return;
+        }
+        std::vector<uint8_t> packed(chunk.blocks * block_size);
+        for (size_t i = 0; i < chunk.blocks; ++i) {
+            readBlock(inode.blocks[chunk.first_block + i], [&](BlockView block) {
+                std::memcpy(packed.data() + i * block_size, block.data(), block_size);
+            });
+        }
+        lz::decompress(packed.data(), chunk.stored, dst, length);
+    }
+
+    // Записать участок c сжатого файла в новую серию блоков вместо прежней;
+    // c — существующий участок или следующий за последним. bytes — сжатые
+    // данные (stored > 0) или участок как есть. Прежняя серия освобождается
+    // до выделения новой; место под новую проверяет вызывающий.
+    void storeChunk(Inode& inode, size_t c, const std::vector<uint8_t>& bytes, size_t stored) {
+        const size_t need = blocksFor(bytes.size());
+        const bool existing = c < inode.chunks.size();
+        const size_t have = existing ? inode.chunks[c].blocks : 0;
+        const size_t at = existing ? inode.chunks[c].first_block : inode.blocks.size();
+        if (existing) {
+            std::vector<size_t> old(inode.blocks.begin() + at, inode.blocks.begin() + at + have);
+            std::sort(old.begin(), old.end());
+            releaseBlocks(old);
+            inode.blocks.erase(inode.blocks.begin() + at, inode.blocks.begin() + at + have);
+        } else {
+            inode.chunks.push_back(FileChunk{at, 0, 0});
+        }
+        const std::vector<size_t> run = allocateBlocks(need);
+        for (size_t block : run) raw_locked.set(block);
+        writeBlocks(run.data(), bytes.data(), bytes.size());
+        inode.blocks.insert(inode.blocks.begin() + at, run.begin(), run.end());
+        inode.chunks[c].blocks = need;
+        inode.chunks[c].stored = stored;
+        for (size_t k = c + 1; k < inode.chunks.size(); ++k) {
+            inode.chunks[k].first_block = inode.chunks[k].first_block - have + need;
+        }
+    }
+
+    // Перезаписать сжатый файл: участки сжимаются заранее, и все серии
+    // выделяются одним запросом (по возможности подряд).
+    void rewriteCompressed(size_t ino, const std::vector<uint8_t>& data) {
+        Inode& inode = inodes[ino];
+        const size_t count = (data.size() + chunkBytes() - 1) / chunkBytes();
+        std::vector<std::vector<uint8_t>> packed(count);
+        std::vector<FileChunk> chunks(count);
+        size_t total = 0;
+        for (size_t c = 0; c < count; ++c) {
+            const size_t length = std::min(chunkBytes(), data.size() - c * chunkBytes());
+            packed[c] = packChunk(data.data() + c * chunkBytes(), length);
+            chunks[c].first_block = total;
+            chunks[c].blocks = blocksFor(packed[c].empty() ? length : packed[c].size());
+            chunks[c].stored = packed[c].size();
+            total += chunks[c].blocks;
+        }
+        makeRoom(total);
+        if (total > free_space.getFreeBlocks() + reclaimableBlocks(inode)) {
+            throw std::runtime_error("Not enough free space for file: " + inode.name);
+        }
+        releaseFileBlocks(inode);
+        makeRoom(total, &inode);
+
+        std::vector<size_t> blocks = allocateBlocks(total);
+        for (size_t block : blocks) raw_locked.set(block);
+        for (size_t c = 0; c < count; ++c) {
+            const size_t* run = blocks.data() + chunks[c].first_block;
+            if (packed[c].empty()) {
+                const size_t length = std::min(chunkBytes(), data.size() - c * chunkBytes());
+                writeBlocks(run, data.data() + c * chunkBytes(), length);
+            } else {
+                writeBlocks(run, packed[c].data(), packed[c].size());
+            }
+        }
+        inode.size = data.size();
+        inode.blocks = std::move(blocks);
+        inode.chunks = std::move(chunks);
+        logPut(inode);
+    }
+
+    // Запись в сжатый файл: затронутые участки распаковываются, изменяются
+    // и сжимаются заранее (промежуток за концом файла — нули). Место под все
+    // новые серии проверяется до записи: на полном диске файл не меняется.
+    // На диске с журналом заменяемые серии освобождаются только после
+    // фиксации, поэтому новые серии под них не засчитываются. Без журнала
+    // сначала сохраняются участки, которые не растут: освобождённое ими
+    // место покрывает рост остальных, и ни одно выделение не превышает
+    // проверенного остатка.
+    void writeCompressed(Inode& inode, size_t offset, const uint8_t* data, size_t length) {
+        if (length == 0) return;
+        const size_t end = offset + length;
+        const size_t new_size = std::max(inode.size, end);
+        const size_t cb = chunkBytes();
+        const size_t first = std::min(offset, inode.size) / cb;
+        const size_t count = (end - 1) / cb + 1 - first;
+        std::vector<std::vector<uint8_t>> bytes(count);
+        std::vector<size_t> stored(count);
+        size_t need = 0;
+        size_t have = 0;
+        for (size_t k = 0; k < count; ++k) {
+            const size_t c = first + k;
+            const size_t start = c * cb;
+            std::vector<uint8_t> buffer(std::min(cb, new_size - start), 0);
+            if (c < inode.chunks.size()) loadChunk(inode, c, buffer.data());
+            const size_t from = std::max(start, offset);
+            const size_t to = std::min(start + buffer.size(), end);
+            if (from < to) std::memcpy(buffer.data() + (from - start), data + (from - offset), to - from);
+            std::vector<uint8_t> packed = packChunk(buffer.data(), buffer.size());
+            stored[k] = packed.size();
+            bytes[k] = packed.empty() ? std::move(buffer) : std::move(packed);
+            need += blocksFor(bytes[k].size());
+            if (c < inode.chunks.size()) have += inode.chunks[c].blocks;
+        }
+        makeRoom(need);
+        if (need > free_space.getFreeBlocks() + (journal ? 0 : have)) {
+            throw std::runtime_error("Not enough free space for file: " + inode.name);
+        }
+        auto shrinks = [&](size_t k) {
+            const size_t c = first + k;
+            return c < inode.chunks.size() && blocksFor(bytes[k].size()) <= inode.chunks[c].blocks;
+        };
+        std::vector<size_t> order;
+        order.reserve(count);
+        for (size_t k = 0; k < count; ++k) {
+            if (shrinks(k)) order.push_back(k);
+        }
+        for (size_t k = 0; k < count; ++k) {
+            if (!shrinks(k)) order.push_back(k);
+        }
+        for (size_t k : order) {
+            const size_t c = first + k;
+            const size_t chunk_length = std::min(cb, new_size - c * cb);
+            storeChunk(inode, c, bytes[k], stored[k]);
+            inode.size = std::max(inode.size, c * cb + chunk_length);
+        }
+        logPut(inode);
+    }
+
+    size_t readCompressed(const Inode& inode, size_t offset, uint8_t* dst, size_t length) const {
+        if (length == 0) return 0;
+        const size_t cb = chunkBytes();
+        std::vector<uint8_t> buffer(cb);
+        for (size_t c = offset / cb; c <= (offset + length - 1) / cb; ++c) {
+            const size_t start = c * cb;
+            loadChunk(inode, c, buffer.data());
+            const size_t from = std::max(start, offset);
+            const size_t to = std::min(start + chunkLength(inode, c), offset + length);
+            std::memcpy(dst + (from - offset), buffer.data() + (from - start), to - from);
+        }
+        return length;
+    }
+
+    // Перезаписать файл в предварительно выделенные блоки.
+    void rewriteFile(size_t ino, const std::vector<uint8_t>& data,
+                     const std::vector<size_t>& allocated_blocks) {
+        Inode& inode = inodes[ino];
+        size_t needed_blocks = blocksFor(data.size());
+
+        if (allocated_blocks.size() < needed_blocks) {
+            throw std::runtime_error("Not enough allocated blocks for file: " + inode.name);
+        }
+
+        std::vector<size_t> used_blocks(allocated_blocks.begin(),
+                                        allocated_blocks.begin() + needed_blocks);
+        std::vector<size_t> own = inode.blocks;
+        std::sort(own.begin(), own.end());
+        std::vector<size_t> sorted = used_blocks;
+        std::sort(sorted.begin(), sorted.end());
+        for (size_t i = 0; i < sorted.size(); ++i) {
+            if (sorted[i] >= storage.getTotalBlocks()) {
+                throw std::out_of_range("Invalid block_id: " + std::to_string(sorted[i]));
+            }
+            if (i > 0 && sorted[i] == sorted[i - 1]) {
+                throw std::invalid_argument("Block listed twice for file: " + inode.name);
+            }
+            // Чужой блок должен быть свободен: блок без ссылок, ещё не
+            // освобождённый фиксацией, принадлежит файлу на диске.
+            const auto mine = std::equal_range(own.begin(), own.end(), sorted[i]);
+            const size_t mine_count = static_cast<size_t>(mine.second - mine.first);
+            if (block_refs[sorted[i]] > mine_count || (mine_count == 0 && !free_space.isFree(sorted[i]))) {
+                throw std::runtime_error("Block " + std::to_string(sorted[i]) +
+                                         " is already in use by another file");
+            }
+        }
+
+        // Освобождаем старые блоки файла
+        releaseFileBlocks(inode);
+        for (size_t block : sorted) refBlock(block);
+        inode.compressed = false;
+
+        // Записываем данные прямо в блоки хранилища (без промежуточных буферов)
+        storeFile(inode, data, std::move(used_blocks));
+        logPut(inode);
+    }
+
+    // Перезаписать файл, выделив блоки по возможности одним участком.
+    void rewriteFile(size_t ino, const std::vector<uint8_t>& data) {
+        if (inodes[ino].compressed) {
+            rewriteCompressed(ino, data);
+            return;
+        }
+        if (dedup) {
+            rewriteDeduplicated(ino, data);
+            return;
+        }
+        Inode& inode = inodes[ino];
+        const size_t needed_blocks = blocksFor(data.size());
+        makeRoom(needed_blocks);
+        if (needed_blocks > free_space.getFreeBlocks() + reclaimableBlocks(inode)) {
+            throw std::runtime_error("Not enough free space for file: " + inode.name);
+        }
+        releaseFileBlocks(inode);
+        makeRoom(needed_blocks, &inode);
+        storeFile(inode, data, allocateBlocks(needed_blocks));
+        logPut(inode);
+    }
+
+    // Перезаписать файл с дедупликацией: блок данных, который уже есть на
+    // диске (в индексе или раньше в этой же записи), не пишется повторно,
+    // а получает ещё одну ссылку. Остальные блоки выделяются одним запросом
+    // и попадают в индекс.
+    void rewriteDeduplicated(size_t ino, const std::vector<uint8_t>& data) {
+        Inode& inode = inodes[ino];
+        const size_t block_size = storage.getBlockSize();
+        const size_t count = blocksFor(data.size());
+        // Последний неполный блок данных дополняется нулями, как на диске.
+        std::vector<uint8_t> tail(block_size, 0);
+        const size_t tail_bytes = data.size() % block_size;
+        if (tail_bytes > 0) std::memcpy(tail.data(), data.data() + (count - 1) * block_size, tail_bytes);
+        auto chunk = [&](size_t i) -> const uint8_t* {
+            return i + 1 == count && tail_bytes > 0 ? tail.data() : data.data() + i * block_size;
+        };
+
+        makeRoom(count);
+        std::vector<size_t> blocks(count, kNoBlock);
+        std::vector<Fingerprint> prints(count);
+        std::vector<size_t> fresh;                   // блоки данных, которым нужен новый блок
+        std::vector<size_t> same_as(count, kNoBlock);  // повтор более раннего блока данных
+        std::unordered_map<Fingerprint, size_t, FingerprintHash> first;
+        for (size_t i = 0; i < count; ++i) {
+            prints[i] = fingerprint::compute(chunk(i), block_size);
+            const size_t found = findDuplicate(prints[i], chunk(i));
+            if (found != kNoBlock) {
+                addRef(found);
+                blocks[i] = found;
+                continue;
+            }
+            auto it = first.find(prints[i]);
+            if (it != first.end() && std::memcmp(chunk(it->second), chunk(i), block_size) == 0) {
+                same_as[i] = it->second;
+                continue;
+            }
+            first.emplace(prints[i], i);
+            fresh.push_back(i);
+        }
+
+        if (fresh.size() > free_space.getFreeBlocks() + reclaimableBlocks(inode)) {
+            for (size_t block : blocks) {
+                if (block != kNoBlock) dropRef(block);
+            }
+            throw std::runtime_error("Not enough free space for file: " + inode.name);
+        }
+        releaseFileBlocks(inode);
+        makeRoom(fresh.size(), &inode);
+
+        const std::vector<size_t> allocated = allocateBlocks(fresh.size());
+        for (size_t k = 0; k < fresh.size(); ++k) {
+            const uint8_t* src = chunk(fresh[k]);
+            modifyBlock(allocated[k], [&](MutableBlockView block) {
+                std::memcpy(block.data(), src, block_size);
+            }, true);
+            blocks[fresh[k]] = allocated[k];
+            indexBlock(allocated[k], prints[fresh[k]]);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (same_as[i] == kNoBlock) continue;
+            blocks[i] = blocks[same_as[i]];
+            addRef(blocks[i]);
+        }
+        dedup_hits += count - fresh.size();
+        inode.size = data.size();
+        inode.blocks = std::move(blocks);
+        logPut(inode);
+    }
+
+    // Блок с тем же содержимым из индекса или kNoBlock. Блок, изменённый
+    // после индексации (или не прошедший проверку суммы), из индекса убирается.
+    // Блок закрывается для записи в обход таблицы файлов до сравнения:
+    // запись, начатая раньше, успеет до чтения, начатая позже — отклонится.
+    size_t findDuplicate(const Fingerprint& print, const uint8_t* data) {
+        auto it = dedup_index.find(print);
+        if (it == dedup_index.end()) return kNoBlock;
+        const size_t block = it->second;
+        raw_locked.set(block);
+        bool same = false;
+        try {
+            readBlock(block, [&](BlockView view) {
+                same = std::memcmp(view.data(), data, view.size()) == 0;
+            });
+        } catch (const std::runtime_error&) {
+            // повреждённый блок не делится; ошибка уже учтена в суммах блоков
+        }
+        if (same) return block;
+        if (block_refs[block] <= 1) raw_locked.reset(block);
+        unindexBlock(block);
+        return kNoBlock;
+    }
+
+    void indexBlock(size_t block, const Fingerprint& print) {
+        if (dedup_index.emplace(print, block).second) dedup_prints[block] = print;
+    }
+
+    void unindexBlock(size_t block) {
+        if (dedup_prints.empty()) return;
+        auto it = dedup_prints.find(block);
+        if (it == dedup_prints.end()) return;
+        dedup_index.erase(it->second);
+        dedup_prints.erase(it);
+    }
+
+    // Подготовить к изменению блок номер index файла: общий блок заменяется
+    // копией (copy-on-write), собственный убирается из индекса отпечатков.
+    // true — список блоков файла изменился.
+    bool makePrivate(Inode& inode, size_t index) {
+        const size_t block = inode.blocks[index];
+        if (block_refs[block] <= 1) {
+            unindexBlock(block);
+            return false;
+        }
+        std::vector<uint8_t> content(storage.getBlockSize());
+        readBlock(block, [&](BlockView view) { std::memcpy(content.data(), view.data(), view.size()); });
+        const size_t copy = allocateBlocks(1)[0];
+        modifyBlock(copy, [&](MutableBlockView view) {
+            std::memcpy(view.data(), content.data(), view.size());
+        }, true);
+        dropRef(block);
+        inode.blocks[index] = copy;
+        ++cow_copies;
+        return true;
+    }
+
+    // Сколько копий сделает makePrivate для блоков [first, last) файла:
+    // блок, повторённый в диапазоне, копируется, пока он остаётся общим.
+    size_t copiesNeeded(const Inode& inode, size_t first, size_t last) const {
+        std::unordered_map<size_t, uint32_t> refs;
+        size_t copies = 0;
+        for (size_t i = first; i < last; ++i) {
+            uint32_t& left = refs.emplace(inode.blocks[i], block_refs[inode.blocks[i]]).first->second;
+            if (left > 1) {
+                --left;
+                ++copies;
+            }
+        }
+        return copies;
+    }
+
+    // Выделить count блоков (по возможности одним участком) с одной ссылкой.
+    std::vector<size_t> allocateBlocks(size_t count) {
+        std::vector<size_t> blocks;
+        blocks.reserve(count);
+        for (const Extent& extent : free_space.allocate(count)) {
+            for (size_t i = 0; i < extent.length; ++i) {
+                block_refs[extent.start + i] = 1;
+                blocks.push_back(extent.start + i);
+            }
+        }
+        return blocks;
+    }
+
+    // Сколько блоков освободится, если файл отпустит свои блоки
+    // (общие с другими файлами остаются занятыми).
+    size_t reclaimableBlocks(const Inode& inode) const {
+        std::vector<size_t> own = inode.blocks;
+        std::sort(own.begin(), own.end());
+        size_t result = 0;
+        for (size_t i = 0; i < own.size();) {
+            size_t j = i + 1;
+            while (j < own.size() && own[j] == own[i]) ++j;
+            if (block_refs[own[i]] == j - i) ++result;
+            i = j;
+        }
+        return result;
+    }
+
+    // Ещё одна ссылка на занятый блок: общий блок закрывается для записи
+    // в обход таблицы файлов.
+    void addRef(size_t block) {
+        if (++block_refs[block] > 1) raw_locked.set(block);
+    }
+
+    // Снять ссылку; блок, оставшийся у одного файла (или свободный),
+    // снова открыт. Возвращает оставшееся число ссылок.
+    uint32_t dropRef(size_t block) {
+        const uint32_t left = --block_refs[block];
+        if (left <= 1) raw_locked.reset(block);
+        return left;
+    }
+
+    // Ссылка на блок из загружаемой таблицы файлов; первая занимает блок
+    // (блок, ожидающий освобождения фиксацией, уже занят).
+    void refBlock(size_t block) {
+        if (block >= block_refs.size()) {
+            throw std::out_of_range("Invalid block_id: " + std::to_string(block));
+        }
+        if (block_refs[block] == 0 && free_space.isFree(block)) free_space.reserve(block, 1);
+        addRef(block);
+    }
+
+    // Для диска с журналом: блоки, освобождённые незафиксированными
+    // изменениями, занимаются только после фиксации. Если свободных блоков
+    // меньше need, ожидающая группа фиксируется досрочно. emptied — файл,
+    // уже отпустивший свои блоки: он попадает в группу пустым, и его
+    // прежние блоки тоже освобождаются (после сбоя файл окажется пустым,
+    // но не сошлётся на перезаписанные блоки).
+    void makeRoom(size_t need, const Inode* emptied = nullptr) {
+        if (!journal || need <= free_space.getFreeBlocks() || deferred_free.empty()) return;
+        if (emptied) logPut(*emptied);
+        commit();
+    }
+
+    void requireRawWritable(size_t block_id) const {
+        if (raw_locked.test(block_id)) {
+            throw std::runtime_error("Raw write to a shared or compressed disk block: " +
+                                     std::to_string(block_id));
+        }
+    }
+
+    // Закрыть блоки сжатого файла для записи в обход таблицы файлов.
+    void lockCompressed(const Inode& inode) {
+        if (!inode.compressed) return;
+        for (size_t block : inode.blocks) raw_locked.set(block);
+    }
+
+    // Добавить файлу блоки, чтобы вместить new_size байт. Новые блоки
+    // обнуляются; по возможности они продолжают последний участок файла.
+    void growFile(Inode& inode, size_t new_size) {
+        const size_t have = inode.blocks.size();
+        const size_t needed = blocksFor(new_size);
+        if (needed <= have) return;
+        const size_t extra = needed - have;
+        if (extra > free_space.getFreeBlocks()) {
+            throw std::runtime_error("Not enough free space for file: " + inode.name);
+        }
+
+        std::vector<Extent> extents;
+        const size_t next = have > 0 ? inode.blocks.back() + 1 : 0;
+        if (have > 0 && next <= storage.getTotalBlocks() - extra &&
+            free_space.isRangeFree(next, extra)) {
+            free_space.reserve(next, extra);
+            extents.push_back(Extent{next, extra});
+        } else {
+            extents = free_space.allocate(extra);
+        }
+        inode.blocks.reserve(needed);
+        for (const Extent& extent : extents) {
+            for (size_t i = 0; i < extent.length; ++i) {
+                const size_t block_id = extent.start + i;
+                block_refs[block_id] = 1;
+                modifyBlock(block_id, [](MutableBlockView block) {
+                    std::memset(block.data(), 0, block.size());
+                }, true);
+                inode.blocks.push_back(block_id);
+            }
+        }
+    }
+
+    size_t readRange(const Inode& inode, size_t offset, uint8_t* dst, size_t length) const {
+        if (offset >= inode.size) return 0;
+        length = std::min(length, inode.size - offset);
+        if (inode.compressed) return readCompressed(inode, offset, dst, length);
+        const size_t block_size = storage.getBlockSize();
+        size_t done = 0;
+        while (done < length) {
+            const size_t pos = offset + done;
+            const size_t in_block = pos % block_size;
+            const size_t n = std::min(block_size - in_block, length - done);
+            readBlock(inode.blocks[pos / block_size], [&](BlockView block) {
+                std::memcpy(dst + done, block.data() + in_block, n);
+            });
+            done += n;
+        }
+        return length;
+    }
+
+    void writeRange(Inode& inode, size_t offset, const uint8_t* data, size_t length) {
+        if (offset > std::numeric_limits<size_t>::max() - length) {
+            throw std::out_of_range("File offset overflow: " + inode.name);
+        }
+        if (inode.compressed) {
+            writeCompressed(inode, offset, data, length);
+            return;
+        }
+        if (length == 0) return;
+        const size_t end = offset + length;
+        const size_t old_blocks = inode.blocks.size();
+        const size_t block_size = storage.getBlockSize();
+
+        // Место под копии общих блоков и под рост файла проверяется заранее,
+        // копии делаются до записи данных: на полном диске файл не меняется.
+        const size_t first = offset / block_size;
+        const size_t last = std::min(old_blocks, blocksFor(end));
+        const size_t extra = blocksFor(end) > old_blocks ? blocksFor(end) - old_blocks : 0;
+        const size_t copies = first < last ? copiesNeeded(inode, first, last) : 0;
+        makeRoom(copies + extra);
+        if (copies + extra > free_space.getFreeBlocks()) {
+            throw std::runtime_error("Not enough free space for file: " + inode.name);
+        }
+        bool remapped = false;
+        try {
+            for (size_t i = first; i < last; ++i) remapped = makePrivate(inode, i) || remapped;
+        } catch (...) {
+            if (remapped) logPut(inode);  // уже сделанные копии хранят то же содержимое
+            throw;
+        }
+        if (end > inode.size) growFile(inode, end);
+
+        size_t done = 0;
+        while (done < length) {
+            const size_t pos = offset + done;
+            const size_t in_block = pos % block_size;
+            const size_t n = std::min(block_size - in_block, length - done);
+            modifyBlock(inode.blocks[pos / block_size], [&](MutableBlockView block) {
+                std::memcpy(block.data() + in_block, data + done, n);
+            });
+            done += n;
+        }
+        const bool grew = end > inode.size;
+        if (grew) inode.size = end;
+        if (remapped) {
+            logPut(inode);  // общие блоки заменены копиями: список блоков целиком
+        } else if (grew) {
+            logGrow(inode, old_blocks);
+        }
+    }
+
+    template <typename Fn>
+    void forEachChunkOf(const Inode& inode, Fn&& fn) const {
+        if (inode.compressed) {
+            std::vector<uint8_t> buffer(chunkBytes());
+            for (size_t c = 0; c < inode.chunks.size(); ++c) {
+                loadChunk(inode, c, buffer.data());
+                fn(BlockView(buffer.data(), chunkLength(inode, c)));
+            }
+            return;
+        }
+        const size_t block_size = storage.getBlockSize();
+        for (size_t i = 0; i < inode.blocks.size(); ++i) {
+            const size_t length = std::min(block_size, inode.size - i * block_size);
+            readBlock(inode.blocks[i], [&](BlockView block) {
+                fn(block.subspan(0, length));
+            });
+        }
+    }
+
+    std::vector<uint8_t> readWhole(const Inode& inode) const {
+        std::vector<uint8_t> result;
+        result.reserve(inode.size);
+        forEachChunkOf(inode, [&](BlockView chunk) {
+            result.insert(result.end(), chunk.begin(), chunk.end());
+        });
+        return result;
+    }
+
+    std::vector<uint8_t> readRange(const Inode& inode, size_t offset, size_t length) const {
+        std::vector<uint8_t> result(offset < inode.size ? std::min(length, inode.size - offset) : 0);
+        readRange(inode, offset, result.data(), result.size());
+        return result;
+    }
+
+    void releaseFileBlocks(Inode& inode) {
+        std::vector<size_t> blocks = std::move(inode.blocks);
+        inode.blocks.clear();
+        inode.chunks.clear();
+        inode.size = 0;
+        std::sort(blocks.begin(), blocks.end());
+        releaseBlocks(blocks);
+    }
+
+    // Снять ссылки на блоки (номера отсортированы); блоки без ссылок
+    // освобождаются, на диске с журналом — при следующей фиксации.
+    void releaseBlocks(const std::vector<size_t>& blocks) {
+        std::vector<size_t> unused;
+        for (size_t block : blocks) {
+            if (dropRef(block) > 0) continue;
+            unindexBlock(block);
+            unused.push_back(block);
+        }
+        if (journal) {
+            deferred_free.insert(deferred_free.end(), unused.begin(), unused.end());
+            return;
+        }
+        freeRuns(unused);
+    }
+
+    // Освободить блоки (номера отсортированы): соседние — одним участком.
+    void freeRuns(const std::vector<size_t>& blocks) {
+        size_t i = 0;
+        while (i < blocks.size()) {
+            size_t run = 1;
+            while (i + run < blocks.size() && blocks[i + run] == blocks[i] + run) ++run;
+            free_space.free(blocks[i], run);
+            i += run;
+        }
+    }
+
+    // Изменения, освободившие отложенные блоки, зафиксированы. Блок, снова
+    // получивший ссылку (файл перезаписан в свои же блоки), остаётся занятым.
+    void releaseDeferred() {
+        std::vector<size_t> blocks;
+        blocks.reserve(deferred_free.size());
+        for (size_t block : deferred_free) {
+            if (block_refs[block] == 0) blocks.push_back(block);
+        }
+        deferred_free.clear();
+        std::sort(blocks.begin(), blocks.end());
+        blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+        freeRuns(blocks);
+    }
+
+    // Сбросить на диск блоки (и их суммы), изменённые с прошлого сброса;
+    // соседние блоки — одним msync. Несброшенные при ошибке остаются
+    // отмеченными.
+    void syncDirtyBlocks() {
+        std::vector<size_t> blocks;
+        storage.drainDirtyBlocks([&](size_t block) { blocks.push_back(block); });
+        size_t i = 0;
+        try {
+            while (i < blocks.size()) {
+                size_t run = 1;
+                while (i + run < blocks.size() && blocks[i + run] == blocks[i] + run) ++run;
+                image->flushBlocks(blocks[i], run);
+                journal_stats.synced_blocks += run;
+                i += run;
+            }
+        } catch (...) {
+            for (; i < blocks.size(); ++i) storage.markDirty(blocks[i], 1);
+            throw;
+        }
+    }
+
+    static void putName(std::vector<uint8_t>& out, const std::string& name) {
+        putU64(out, name.size());
+        out.insert(out.end(), name.begin(), name.end());
+    }
+
+    static std::string getName(const std::vector<uint8_t>& in, size_t& pos) {
+        const uint64_t length = getU64(in, pos);
+        if (in.size() - pos < length) throw std::runtime_error("Disk metadata is truncated");
+        std::string name(in.begin() + pos, in.begin() + pos + length);
+        pos += length;
+        return name;
+    }
+
+    // Добавить запись к ожидающей фиксации группе; полная группа фиксируется.
+    void logRecord(const std::vector<uint8_t>& record) {
+        if (!journal) return;
+        pending_records.insert(pending_records.end(), record.begin(), record.end());
+        if (++pending_count >= kGroupCommitRecords ||
+            pending_records.size() >= journal->getCapacity() / 4) {
+            commit();
+        }
+    }
+
+    void logPut(const Inode& inode) {
+        if (!journal) return;
+        std::vector<uint8_t> record;
+        putU64(record, inode.compressed ? kOpPutCompressed : kOpPut);
+        putName(record, inode.name);
+        putU64(record, inode.size);
+        putU64(record, inode.blocks.size());
+        for (size_t block : inode.blocks) putU64(record, block);
+        if (inode.compressed) putChunks(record, inode);
+        logRecord(record);
+    }
+
+    // Файл дорос до inode.size; блоки с номера first_new — новые.
+    void logGrow(const Inode& inode, size_t first_new) {
+        if (!journal) return;
+        std::vector<uint8_t> record;
+        putU64(record, kOpGrow);
+        putName(record, inode.name);
+        putU64(record, inode.size);
+        putU64(record, inode.blocks.size() - first_new);
+        for (size_t i = first_new; i < inode.blocks.size(); ++i) putU64(record, inode.blocks[i]);
+        logRecord(record);
+    }
+
+    void logDelete(const std::string& name) {
+        if (!journal) return;
+        std::vector<uint8_t> record;
+        putU64(record, kOpDelete);
+        putName(record, name);
+        logRecord(record);
+    }
+
+    // Повторить транзакцию журнала поверх таблицы файлов из метаданных.
+    void applyTransaction(const std::vector<uint8_t>& txn) {
+        size_t pos = 0;
+        while (pos < txn.size()) {
+            const uint64_t op = getU64(txn, pos);
+            std::string name = getName(txn, pos);
+            size_t ino = findInode(name);
+            if (op == kOpDelete) {
+                if (ino != kNoInode) freeInode(ino);
+                continue;
+            }
+            if (op != kOpPut && op != kOpGrow && op != kOpPutCompressed) {
+                throw std::runtime_error("Disk journal is corrupt");
+            }
+            if (ino == kNoInode) ino = allocInode(std::move(name));
+            Inode& inode = inodes[ino];
+            const uint64_t size = getU64(txn, pos);
+            const uint64_t count = getU64(txn, pos);
+            if (op != kOpGrow) {
+                releaseFileBlocks(inode);
+                inode.compressed = op == kOpPutCompressed;
+            }
+            for (uint64_t i = 0; i < count; ++i) {
+                const size_t block = getU64(txn, pos);
+                refBlock(block);
+                inode.blocks.push_back(block);
+            }
+            inode.size = size;
+            if (op == kOpPutCompressed) getChunks(txn, pos, inode);
+            lockCompressed(inode);
+            if (!validLayout(inode)) {
+                throw std::runtime_error("Disk journal is inconsistent for file: " + inode.name);
+            }
+        }
+    }
+
+    // Контрольная запись: изменённые блоки на диск, затем полная таблица
+    // файлов в свободный слот метаданных; журнал пуст.
+    void checkpoint() {
+        syncDirtyBlocks();
+        image->writeCheckpoint(serializeFiles(), journal->getHead(), journal->getNextSeq());
+        journal->checkpoint();
+        releaseDeferred();
+        pending_records.clear();
+        pending_count = 0;
+        ++journal_stats.checkpoints;
+    }
+
+    static std::unique_ptr<DiskImage> openImage(const std::string& path, size_t total_blocks,
+                                                size_t block_size) {
+        if (!DiskImage::exists(path)) return DiskImage::create(path, total_blocks, block_size);
+        std::unique_ptr<DiskImage> existing = DiskImage::open(path);
+        if (existing->getTotalBlocks() != total_blocks || existing->getBlockSize() != block_size) {
+            throw std::runtime_error("Disk image geometry mismatch: " + path);
+        }
+        return existing;
+    }
+
+    static void putU64(std::vector<uint8_t>& out, uint64_t value) {
+        for (int i = 0; i < 8; ++i) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    static uint64_t getU64(const std::vector<uint8_t>& in, size_t& pos) {
+        if (in.size() - pos < 8) throw std::runtime_error("Disk metadata is truncated");
+        uint64_t value = 0;
+        for (int i = 0; i < 8; ++i) value |= static_cast<uint64_t>(in[pos + i]) << (8 * i);
+        pos += 8;
+        return value;
+    }
+
+    // Индекс участков сжатого файла: число участков, затем для каждого
+    // число блоков и длина сжатых данных.
+    static void putChunks(std::vector<uint8_t>& out, const Inode& inode) {
+        putU64(out, inode.chunks.size());
+        for (const FileChunk& chunk : inode.chunks) {
+            putU64(out, chunk.blocks);
+            putU64(out, chunk.stored);
+        }
+    }
+
+    // Начала участков в списке блоков не хранятся — они следуют подряд.
+    static void getChunks(const std::vector<uint8_t>& in, size_t& pos, Inode& inode) {
+        const uint64_t count = getU64(in, pos);
+        if (count > (in.size() - pos) / 16) throw std::runtime_error("Disk metadata is truncated");
+        inode.chunks.resize(count);
+        size_t first = 0;
+        for (FileChunk& chunk : inode.chunks) {
+            chunk.first_block = first;
+            chunk.blocks = getU64(in, pos);
+            chunk.stored = getU64(in, pos);
+            first += chunk.blocks;
+        }
+    }
+
+    // Согласованы ли длина файла, его блоки и (у сжатого файла) участки.
+    bool validLayout(const Inode& inode) const {
+        if (!inode.compressed) return blocksFor(inode.size) == inode.blocks.size();
+        if (inode.chunks.size() != (inode.size + chunkBytes() - 1) / chunkBytes()) return false;
+        size_t total = 0;
+        for (size_t c = 0; c < inode.chunks.size(); ++c) {
+            const FileChunk& chunk = inode.chunks[c];
+            const size_t bytes = chunk.stored == 0 ? chunkLength(inode, c) : chunk.stored;
+            if (chunk.first_block != total || chunk.blocks != blocksFor(bytes) ||
+                chunk.blocks > blocksFor(chunkLength(inode, c))) {
+                return false;
+            }
+            total += chunk.blocks;
+        }
+        return total == inode.blocks.size();
+    }
+
+    // Таблица файлов в образе: метка формата, число файлов, затем для
+    // каждого длина имени, имя, длина файла в байтах, флаги (сжатие),
+    // число блоков, номера блоков и у сжатого файла — индекс участков
+    // (little-endian u64).
+    std::vector<uint8_t> serializeFiles() const {
+        std::vector<uint8_t> out;
+        putU64(out, kMetadataFormat);
+        putU64(out, getFileCount());
+        for (const Inode& inode : inodes) {
+            if (!inode.in_use) continue;
+            putName(out, inode.name);
+            putU64(out, inode.size);
+            putU64(out, inode.compressed ? kFileCompressed : 0);
+            putU64(out, inode.blocks.size());
+            for (size_t block : inode.blocks) putU64(out, block);
+            if (inode.compressed) putChunks(out, inode);
+        }
+        return out;
+    }
+
+    void loadFiles(const std::vector<uint8_t>& metadata) {
+        if (metadata.empty()) return;
+        size_t pos = 0;
+        if (getU64(metadata, pos) != kMetadataFormat) {
+            throw std::runtime_error("Unsupported disk metadata format");
+        }
+        const uint64_t count = getU64(metadata, pos);
+        for (uint64_t f = 0; f < count; ++f) {
+            Inode& inode = inodes[allocInode(getName(metadata, pos))];
+            inode.size = getU64(metadata, pos);
+            inode.compressed = (getU64(metadata, pos) & kFileCompressed) != 0;
+            inode.blocks.resize(getU64(metadata, pos));
+            for (size_t& block : inode.blocks) {
+                block = getU64(metadata, pos);
+                refBlock(block);
+            }
+            if (inode.compressed) getChunks(metadata, pos, inode);
+            lockCompressed(inode);
+            if (!validLayout(inode)) {
+                throw std::runtime_error("Disk metadata is inconsistent for file: " + inode.name);
+            }
+        }
+    }
 
 public:
     HardDrive(size_t total_blocks, size_t block_size)
-        : storage(total_blocks, block_size) {}
+        : storage(total_blocks, block_size), checksums(total_blocks, block_size),
+          free_space(total_blocks), block_refs(total_blocks, 0), raw_locked(total_blocks) {}
+
+    // Диск на файле образа: существующий образ открывается (геометрия должна
+    // совпадать), иначе создаётся новый. Данные не загружаются при открытии —
+    // блоки читаются из отображения по мере обращения. Таблица файлов
+    // восстанавливается из последней контрольной записи и журнала.
+    HardDrive(const std::string& image_path, size_t total_blocks, size_t block_size)
+        : image(openImage(image_path, total_blocks, block_size)),
+          storage(total_blocks, block_size, image->data()),
+          checksums(total_blocks, block_size, image->checksumTable()),
+          free_space(total_blocks), block_refs(total_blocks, 0), raw_locked(total_blocks) {
+        loadFiles(image->readMetadata());
+        journal = std::make_unique<MetadataJournal>(image->journalRegion(), image->getJournalCapacity(),
+                                                    image->getJournalStart(), image->getJournalSeq());
+        journal_stats.replayed = journal->replay([this](const std::vector<uint8_t>& txn) {
+            applyTransaction(txn);
+        });
+        releaseDeferred();  // воспроизведённые транзакции уже на диске
+    }
+
+    HardDrive(const HardDrive&) = delete;
+    HardDrive& operator=(const HardDrive&) = delete;
+
+    ~HardDrive() {
+        try {
+            flush();
+        } catch (...) {
+            // деструктор не бросает; явный flush() сообщает об ошибке
+        }
+    }
+
+    // Записать грязные блоки кэша, полную таблицу файлов в образ (журнал
+    // очищается) и синхронно сбросить образ на диск.
+    void flush() {
+        if (cache) cache->writeBackAll();
+        if (!image) return;
+        checkpoint();
+    }
+
+    // Групповая фиксация: грязные блоки кэша записываются, на диск
+    // сбрасываются только блоки, изменённые с прошлого сброса (и их суммы),
+    // затем одной транзакцией журнала — все накопленные изменения таблицы
+    // файлов. Данные сбрасываются раньше журнала, поэтому транзакция не
+    // ссылается на несохранённые блоки; блоки, освобождённые этими
+    // изменениями, становятся свободными только после записи транзакции.
+    // После возврата сделанные изменения переживают сбой. Вызывается и
+    // автоматически, когда накопилось kGroupCommitRecords изменений.
+    void commit() {
+        if (cache) cache->writeBackAll();
+        if (!image) return;
+        syncDirtyBlocks();
+        if (pending_count == 0) return;
+        if (!journal->append(pending_records)) {
+            checkpoint();  // журнал заполнен: таблица целиком уже включает изменения
+            return;
+        }
+        image->flushJournal();
+        releaseDeferred();
+        ++journal_stats.commits;
+        journal_stats.records += pending_count;
+        pending_records.clear();
+        pending_count = 0;
+    }
+
+    // Сбросить только данные (грязные блоки кэша и образ), не трогая
+    // таблицу файлов и журнал; можно вызывать из потоков асинхронного
+    // ввода-вывода, работающих с блоками в обход таблицы. В модели времени
+    // это ожидание завершения всех выданных обращений.
+    void syncData() {
+        if (cache) cache->writeBackAll();
+        if (image) image->flush();
+        if (timing) timing->drain();
+    }
+
+    JournalStats getJournalStats() const { return journal_stats; }
+
+    bool isPersistent() const { return image != nullptr; }
+
+    // Перегрузки для String* ищут файл без преобразования имени в
+    // std::string; строка строится только при создании файла.
 
-        
     void writeFile(const String* filename,
                    const std::vector<uint8_t>& data,
                    const std::vector<size_t>& allocated_blocks) {
-        writeFile(cstring_bridge::toStdString(filename), data, allocated_blocks);
+        modifyFile(filename, [&](size_t ino) { rewriteFile(ino, data, allocated_blocks); });
     }
 
-    // Записать данные в файл, используя предварительно выделенные блоки
-    void writeFile(const std::string& filename, 
+    // Записать данные в файл, используя предварительно выделенные блоки.
+    // Используются первые ceil(size / block_size) блоков списка; они должны
+    // быть свободны или уже принадлежать этому файлу.
+    void writeFile(const std::string& filename,
                    const std::vector<uint8_t>& data,
                    const std::vector<size_t>& allocated_blocks) {
-        size_t block_size = storage.getBlockSize();
-        size_t needed_blocks = (data.size() + block_size - 1) / block_size;
+        modifyFile(filename, [&](size_t ino) { rewriteFile(ino, data, allocated_blocks); });
+    }
 
-        if (allocated_blocks.size() < needed_blocks) {
-            throw std::runtime_error("Not enough allocated blocks for file: " + filename);
-        }
+    void writeFile(const String* filename, const std::vector<uint8_t>& data) {
+        modifyFile(filename, [&](size_t ino) { rewriteFile(ino, data); });
+    }
+
+    // Записать файл, выделив блоки самостоятельно: по возможности одним
+    // непрерывным участком. Блоки прежней версии файла освобождаются.
+    void writeFile(const std::string& filename, const std::vector<uint8_t>& data) {
+        modifyFile(filename, [&](size_t ino) { rewriteFile(ino, data); });
+    }
+
+    std::vector<uint8_t> readFile(const String* filename) {
+        return readWhole(inodes[requireInode(filename)]);
+    }
+
+    // Содержимое файла ровно в getFileSize() байт (без добивки до блока).
+    std::vector<uint8_t> readFile(const std::string& filename) {
+        return readWhole(inodes[requireInode(filename)]);
+    }
+
+    // Прочитать до length байт с позиции offset (как pread). Затрагиваются
+    // только блоки, покрывающие диапазон. Возвращает число прочитанных байт:
+    // меньше length у конца файла, 0 — если offset за концом файла.
+    size_t readAt(const std::string& filename, size_t offset, uint8_t* dst, size_t length) {
+        return readRange(inodes[requireInode(filename)], offset, dst, length);
+    }
+
+    std::vector<uint8_t> readAt(const String* filename, size_t offset, size_t length) {
+        return readRange(inodes[requireInode(filename)], offset, length);
+    }
+
+    std::vector<uint8_t> readAt(const std::string& filename, size_t offset, size_t length) {
+        return readRange(inodes[requireInode(filename)], offset, length);
+    }
+
+    // Записать length байт с позиции offset (как pwrite). Переписываются
+    // только затронутые блоки; запись за концом файла расширяет его новыми
+    // блоками (промежуток заполняется нулями). Несуществующий файл создаётся.
+    void writeAt(const std::string& filename, size_t offset, const uint8_t* data, size_t length) {
+        modifyFile(filename, [&](size_t ino) { writeRange(inodes[ino], offset, data, length); });
+    }
+
+    void writeAt(const String* filename, size_t offset, const std::vector<uint8_t>& data) {
+        modifyFile(filename, [&](size_t ino) {
+            writeRange(inodes[ino], offset, data.data(), data.size());
+        });
+    }
 
-        // Освобождаем старые блоки, если файл существует
-        if (file_blocks.find(filename) != file_blocks.end()) {
-            file_blocks.erase(filename);
+    void writeAt(const std::string& filename, size_t offset, const std::vector<uint8_t>& data) {
+        writeAt(filename, offset, data.data(), data.size());
+    }
+
+    // Дописать данные в конец файла (файл создаётся при необходимости).
+    // Возвращает смещение, с которого записаны данные. Стоимость зависит
+    // только от размера данных, а не от длины файла.
+    size_t append(const std::string& filename, const uint8_t* data, size_t length) {
+        size_t offset = 0;
+        modifyFile(filename, [&](size_t ino) {
+            offset = inodes[ino].size;
+            writeRange(inodes[ino], offset, data, length);
+        });
+        return offset;
+    }
+
+    size_t append(const String* filename, const std::vector<uint8_t>& data) {
+        size_t offset = 0;
+        modifyFile(filename, [&](size_t ino) {
+            offset = inodes[ino].size;
+            writeRange(inodes[ino], offset, data.data(), data.size());
+        });
+        return offset;
+    }
+
+    size_t append(const std::string& filename, const std::vector<uint8_t>& data) {
+        return append(filename, data.data(), data.size());
+    }
+
+    void deleteFile(const String* filename) {
+        const size_t ino = findInode(filename);
+        if (ino == kNoInode) return;
+        logDelete(inodes[ino].name);
+        freeInode(ino);
+    }
+
+    void deleteFile(const std::string& filename) {
+        const size_t ino = findInode(filename);
+        if (ino == kNoInode) return;
+        logDelete(filename);
+        freeInode(ino);
+    }
+
+    bool fileExists(const String* filename) const { return findInode(filename) != kNoInode; }
+    bool fileExists(const std::string& filename) const {
+        return findInode(filename) != kNoInode;
+    }
+
+    // Ссылки на Inode действительны до создания следующего файла.
+    const Inode& getInode(const std::string& filename) const {
+        return inodes[requireInode(filename)];
+    }
+
+    // Длина файла в байтах.
+    size_t getFileSize(const std::string& filename) const { return getInode(filename).size; }
+
+    // --- Быстрый путь по дескриптору: без поиска по имени и без строк ---
+
+    FileHandle openFile(const String* filename) const { return handleOf(requireInode(filename)); }
+    FileHandle openFile(const std::string& filename) const { return handleOf(requireInode(filename)); }
+
+    // Открыть файл, создав пустой при отсутствии.
+    FileHandle createFile(const std::string& filename) {
+        size_t ino = findInode(filename);
+        if (ino == kNoInode) {
+            ino = allocInode(filename);
+            logPut(inodes[ino]);
         }
+        return handleOf(ino);
+    }
+
+    const Inode& getInode(FileHandle file) const { return inodeAt(file); }
+    size_t getFileSize(FileHandle file) const { return inodeAt(file).size; }
+
+    std::vector<uint8_t> readFile(FileHandle file) const { return readWhole(inodeAt(file)); }
+
+    size_t readAt(FileHandle file, size_t offset, uint8_t* dst, size_t length) const {
+        return readRange(inodeAt(file), offset, dst, length);
+    }
+
+    std::vector<uint8_t> readAt(FileHandle file, size_t offset, size_t length) const {
+        return readRange(inodeAt(file), offset, length);
+    }
+
+    void writeAt(FileHandle file, size_t offset, const uint8_t* data, size_t length) {
+        writeRange(inodeAt(file), offset, data, length);
+    }
+
+    void writeAt(FileHandle file, size_t offset, const std::vector<uint8_t>& data) {
+        writeAt(file, offset, data.data(), data.size());
+    }
+
+    size_t append(FileHandle file, const uint8_t* data, size_t length) {
+        Inode& inode = inodeAt(file);
+        const size_t offset = inode.size;
+        writeRange(inode, offset, data, length);
+        return offset;
+    }
+
+    size_t append(FileHandle file, const std::vector<uint8_t>& data) {
+        return append(file, data.data(), data.size());
+    }
+
+    /**
+     * ChunkReader — последовательное чтение файла по блокам без копирования.
+     * next() возвращает представление очередного блока хранилища, обрезанное
+     * по длине файла (пустое — конец файла). Представление действительно до
+     * следующего next() и до изменения файла; при включённом кэше текущий
+     * блок привязан в нём. Блокировки хранилища не берутся — при одновременном
+     * доступе из других потоков используйте forEachChunk(). У сжатого файла
+     * фрагменты — части участка, распакованного в буфер читателя.
+     */
+    class ChunkReader {
+    private:
+        static constexpr size_t kNoChunk = std::numeric_limits<size_t>::max();
+
+        const HardDrive* drive;
+        FileHandle file;
+        size_t index = 0;
+        BlockCache::Pin current;
+        std::vector<uint8_t> unpacked;  // распакованный участок сжатого файла
+        size_t unpacked_chunk = kNoChunk;
 
-        // Записываем данные в выделенные блоки
-        for (size_t i = 0; i < allocated_blocks.size(); ++i) {
-            size_t offset = i * block_size;
-            if (offset >= data.size()) {
-                break;  // Все данные записаны
+    public:
+        ChunkReader(const HardDrive& drive, FileHandle file) : drive(&drive), file(file) {}
+
+        BlockView next() {
+            if (done()) return BlockView();
+            const Inode& inode = drive->inodeAt(file);
+            const size_t block_size = drive->storage.getBlockSize();
+            const size_t offset = index * block_size;
+            if (inode.compressed) {
+                const size_t c = index++ / kChunkBlocks;
+                if (c != unpacked_chunk) {
+                    unpacked.resize(drive->chunkBytes());
+                    drive->loadChunk(inode, c, unpacked.data());
+                    unpacked_chunk = c;
+                }
+                return BlockView(unpacked.data() + (offset - c * drive->chunkBytes()),
+                                 std::min(block_size, inode.size - offset));
             }
-            
-            size_t bytes_to_write = std::min(block_size, data.size() - offset);
-            std::vector<uint8_t> block_data(block_size, 0);
-            for (size_t j = 0; j < bytes_to_write; ++j) {
-                block_data[j] = data[offset + j];
+            const size_t block_id = inode.blocks[index++];
+            current.release();
+            if (drive->cache) current = drive->cache->pin(block_id);
+            BlockView block = current ? current.view() : drive->storage.viewBlock(block_id);
+            if (!current) {
+                drive->checksums.require(block_id, block.data());
+                if (drive->timing) drive->timing->access(false, block_id, 1);
             }
-            storage.writeBlock(allocated_blocks[i], block_data);
+            return block.subspan(0, std::min(block_size, inode.size - offset));
+        }
+
+        bool done() const {
+            return index * drive->storage.getBlockSize() >= drive->inodeAt(file).size;
         }
 
-        // Сохраняем только те блоки, которые реально использованы
-        size_t actual_used_blocks = (data.size() + block_size - 1) / block_size;
-        std::vector<size_t> used_blocks(allocated_blocks.begin(), 
-                                        allocated_blocks.begin() + actual_used_blocks);
-        file_blocks[filename] = used_blocks;
+        // Смещение в файле, с которого начнётся следующий фрагмент.
+        size_t position() const {
+            return std::min(index * drive->storage.getBlockSize(), drive->inodeAt(file).size);
+        }
+    };
+
+    ChunkReader openReader(const std::string& filename) const {
+        return ChunkReader(*this, openFile(filename));
     }
 
-    std::vector<uint8_t> readFile(const String* filename) {
-        return readFile(cstring_bridge::toStdString(filename));
+    ChunkReader openReader(FileHandle file) const {
+        checkHandle(file);
+        return ChunkReader(*this, file);
     }
 
-    std::vector<uint8_t> readFile(const std::string& filename) {
-        if (file_blocks.find(filename) == file_blocks.end()) {
-            throw std::runtime_error("File not found: " + filename);
+    // Передать fn(BlockView) фрагменты файла по порядку; каждый блок
+    // читается под блокировкой хранилища, без промежуточных копий.
+    template <typename Fn>
+    void forEachChunk(const std::string& filename, Fn&& fn) const {
+        forEachChunkOf(inodes[requireInode(filename)], fn);
+    }
+
+    template <typename Fn>
+    void forEachChunk(FileHandle file, Fn&& fn) const {
+        forEachChunkOf(inodeAt(file), fn);
+    }
+
+    // Включить кэш блоков на capacity_blocks блоков (прежний кэш сбрасывается).
+    // WriteBack — записи копятся в кэше до вытеснения, commit() или flush().
+    // Включайте до начала работы с диском из других потоков (DMA).
+    void enableCache(size_t capacity_blocks, CacheMode mode = CacheMode::WriteThrough) {
+        if (cache) cache->writeBackAll();
+        cache = std::make_unique<BlockCache>(storage, capacity_blocks);
+        cache->setTimingModel(timing.get());
+        cache->setChecksums(&checksums);
+        cache_mode = mode;
+    }
+
+    void disableCache() {
+        if (cache) cache->writeBackAll();
+        cache.reset();
+    }
+
+    CacheMode getCacheMode() const { return cache_mode; }
+    bool hasCache() const { return cache != nullptr; }
+    BlockCache* getCache() { return cache.get(); }
+    BlockCacheStats getCacheStats() const { return cache ? cache->getStats() : BlockCacheStats(); }
+
+    // Моделировать время обслуживания обращений к устройству (HDD или SSD).
+    // Включайте до начала работы с диском из других потоков.
+    void enableTimingModel(const DiskTimingParams& params) {
+        timing = std::make_unique<DiskTimingModel>(params, storage.getTotalBlocks(), storage.getBlockSize());
+        if (cache) cache->setTimingModel(timing.get());
+    }
+
+    void disableTimingModel() {
+        if (cache) cache->setTimingModel(nullptr);
+        timing.reset();
+    }
+
+    bool hasTimingModel() const { return timing != nullptr; }
+    DiskTimingModel* getTimingModel() { return timing.get(); }
+    DiskTimingStats getTimingStats() const { return timing ? timing->getStats() : DiskTimingStats(); }
+
+    // Учесть в модели времени обращение к блокам в обход HardDrive (DMA,
+    // асинхронный ввод-вывод); wait == false — асинхронное обращение.
+    void chargeAccess(bool write, size_t start, size_t count, bool wait = true) {
+        if (timing) timing->access(write, start, count, wait);
+    }
+
+    // Сообщить, что блоки изменены в обход HardDrive (например, DMA):
+    // копии в кэше сбрасываются, суммы блоков пересчитываются.
+    void invalidateCache(size_t start, size_t count) {
+        if (cache) cache->invalidate(start, count);
+        for (size_t i = 0; i < count; ++i) {
+            storage.withBlockRead(start + i, [&](BlockView block) {
+                checksums.update(start + i, block.data());
+            });
         }
+    }
 
-        std::vector<uint8_t> result;
-        size_t block_size = storage.getBlockSize();
-        const auto& blocks = file_blocks[filename];
+    // Прочитать блоки [start, start + count) в обход таблицы файлов (DMA,
+    // асинхронный ввод-вывод): отложенные записи кэша сбрасываются, затем
+    // fn(i, BlockView) получает i-й блок под его блокировкой, а сумма
+    // проверяется под той же блокировкой. На первом расхождении чтение
+    // останавливается (fn для этого блока не вызывается) — false.
+    template <typename Fn>
+    bool readRawBlocks(size_t start, size_t count, Fn&& fn) {
+        writeBackCache(start, count);
+        for (size_t i = 0; i < count; ++i) {
+            const bool intact = storage.withBlockRead(start + i, [&](BlockView block) {
+                if (!checksums.verify(start + i, block.data())) return false;
+                fn(i, block);
+                return true;
+            });
+            if (!intact) return false;
+        }
+        return true;
+    }
+
+    // Записать блоки [start, start + count) в обход таблицы файлов:
+    // fill(i, MutableBlockView) заполняет i-й блок целиком, сумма блока
+    // обновляется под той же блокировкой (параллельное чтение не увидит
+    // данных без суммы). Копии в кэше сбрасываются.
+    //
+    // Общие блоки (дедупликация) и блоки сжатых файлов так не пишутся:
+    // запись изменила бы сразу несколько файлов или испортила сжатые
+    // данные. Такой диапазон отклоняется целиком до записи; блок, который
+    // HardDrive сделал общим во время записи, проверяется ещё раз под его
+    // блокировкой. Отпечаток изменённого блока остаётся в индексе
+    // дедупликации — findDuplicate сверяет содержимое побайтно.
+    template <typename Fn>
+    void writeRawBlocks(size_t start, size_t count, Fn&& fill) {
+        for (size_t i = 0; i < count; ++i) requireRawWritable(start + i);
+        for (size_t i = 0; i < count; ++i) {
+            storage.withBlockWrite(start + i, [&](MutableBlockView block) {
+                requireRawWritable(start + i);
+                fill(i, block);
+                checksums.update(start + i, block.data());
+            });
+        }
+        if (cache) cache->invalidate(start, count);
+    }
 
-        for (size_t block_id : blocks) {
-            std::vector<uint8_t> block_data = storage.readBlock(block_id);
-            result.insert(result.end(), block_data.begin(), block_data.end());
+    // Проверить блок хранилища по таблице сумм (для фоновой проверки).
+    // Расхождение перепроверяется, чтобы не принять за ошибку запись,
+    // идущую в этот момент в обход HardDrive.
+    bool scrubBlock(size_t block_id) {
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            const bool intact = storage.withBlockRead(block_id, [&](BlockView block) {
+                return checksums.matches(block_id, block.data());
+            });
+            if (intact) return true;
         }
+        checksums.reportBad(block_id);
+        return false;
+    }
+
+    // Первый занятый блок с номером >= from (getTotalBlocks(), если нет).
+    // Читает только битовую карту, поэтому допустим из фонового потока.
+    size_t findNextUsedBlock(size_t from) const { return free_space.findNextUsed(from); }
+
+    // Блоки, не прошедшие проверку суммы (до их перезаписи).
+    std::vector<size_t> getChecksumErrors() const { return checksums.getBadBlocks(); }
+    ChecksumStats getChecksumStats() const { return checksums.getStats(); }
+
+    // Записать отложенные изменения блоков перед чтением хранилища в обход HardDrive.
+    void writeBackCache(size_t start, size_t count) {
+        if (cache) cache->writeBack(start, count);
+    }
+
+    size_t getFileCount() const { return inodes.size() - free_inodes.size(); }
+
+    // Блочное хранилище диска в обход таблицы файлов и кэша; для DMA и
+    // асинхронного ввода-вывода — readRawBlocks()/writeRawBlocks(), иначе
+    // перед чтением вызовите writeBackCache(), после записи — invalidateCache().
+    MemoryBlock& getStorage() { return storage; }
 
+    // Блоки файла в порядке следования данных.
+    const std::vector<size_t>& getFileBlocks(const std::string& filename) const {
+        return getInode(filename).blocks;
+    }
+
+    // Число непрерывных участков, на которые разбит файл (1 — без фрагментации).
+    size_t getFileFragments(const std::string& filename) const {
+        const std::vector<size_t>& blocks = getFileBlocks(filename);
+        size_t fragments = blocks.empty() ? 0 : 1;
+        for (size_t i = 1; i < blocks.size(); ++i) {
+            if (blocks[i] != blocks[i - 1] + 1) ++fragments;
+        }
+        return fragments;
+    }
+
+    // Создавать новые файлы сжатыми (уже существующие не меняются).
+    // Данные сжимаются участками по kChunkBlocks блоков быстрым LZ-кодеком;
+    // чтение с любого смещения распаковывает только нужные участки.
+    // Небольшие часто изменяемые файлы стоит исключить: setCompressed(name, false).
+    void enableCompression() { compress_new_files = true; }
+    void disableCompression() { compress_new_files = false; }
+    bool isCompressionEnabled() const { return compress_new_files; }
+
+    // Сжать или распаковать файл (данные переписываются в новом виде).
+    // Файл, записанный в заданные блоки (writeFile с allocated_blocks),
+    // хранится без сжатия.
+    void setCompressed(const std::string& filename, bool compressed) {
+        const size_t ino = requireInode(filename);
+        Inode& inode = inodes[ino];
+        if (inode.compressed == compressed) return;
+        const std::vector<uint8_t> data = readWhole(inode);
+        inode.compressed = compressed;
+        try {
+            rewriteFile(ino, data);
+        } catch (...) {
+            inode.compressed = !compressed;  // места не хватило: файл не тронут
+            throw;
+        }
+    }
+
+    bool isCompressed(const std::string& filename) const { return getInode(filename).compressed; }
+
+    CompressionStats getCompressionStats() const {
+        CompressionStats result;
+        for (const Inode& inode : inodes) {
+            if (!inode.in_use || !inode.compressed) continue;
+            ++result.files;
+            result.chunks += inode.chunks.size();
+            for (const FileChunk& chunk : inode.chunks) {
+                if (chunk.stored == 0) ++result.raw_chunks;
+            }
+            result.logical_bytes += inode.size;
+            result.stored_blocks += inode.blocks.size();
+        }
+        result.stored_bytes = result.stored_blocks * storage.getBlockSize();
         return result;
     }
 
-    void deleteFile(const String* filename) { deleteFile(cstring_bridge::toStdString(filename)); }
-    void deleteFile(const std::string& filename) {
-        file_blocks.erase(filename);
+    // Включить дедупликацию блоков: writeFile() не пишет блоки, содержимое
+    // которых уже есть на диске, а ссылается на них. Индекс отпечатков
+    // строится по блокам существующих файлов. Общие блоки переживают
+    // перемонтирование и без дедупликации: таблица файлов хранит ссылки, а
+    // изменение общего блока всегда копирует его.
+    void enableDedup() {
+        dedup = true;
+        for (const Inode& inode : inodes) {
+            if (!inode.in_use || inode.compressed) continue;  // сжатые файлы не делят блоки
+            for (size_t block : inode.blocks) {
+                if (dedup_prints.count(block)) continue;
+                try {
+                    readBlock(block, [&](BlockView view) {
+                        indexBlock(block, fingerprint::compute(view.data(), view.size()));
+                    });
+                } catch (const std::runtime_error&) {
+                    // повреждённый блок в индекс не попадает
+                }
+            }
+        }
     }
 
-    bool fileExists(const String* filename) const { return fileExists(cstring_bridge::toStdString(filename)); }
-    bool fileExists(const std::string& filename) const {
-        return file_blocks.find(filename) != file_blocks.end();
+    // Выключить дедупликацию для новых записей (общие блоки остаются общими).
+    void disableDedup() {
+        dedup = false;
+        dedup_index.clear();
+        dedup_prints.clear();
+    }
+
+    bool isDedupEnabled() const { return dedup; }
+
+    DedupStats getDedupStats() const {
+        DedupStats result;
+        for (const Inode& inode : inodes) {
+            if (inode.in_use) result.logical_blocks += inode.blocks.size();
+        }
+        result.physical_blocks = free_space.getUsedBlocks();
+        for (uint32_t refs : block_refs) {
+            if (refs > 1) ++result.shared_blocks;
+        }
+        result.indexed_blocks = dedup_prints.size();
+        result.hits = dedup_hits;
+        result.cow_copies = cow_copies;
+        return result;
     }
 
+    const FreeSpaceManager& getFreeSpace() const { return free_space; }
+    size_t getFreeBlocks() const { return free_space.getFreeBlocks(); }
+    size_t getUsedBlocks() const { return free_space.getUsedBlocks(); }
+    // Внешняя фрагментация свободного места (0 — свободное место непрерывно).
+    double getFragmentation() const { return free_space.getFragmentation(); }
+
     size_t getTotalBlocks() const { return storage.getTotalBlocks(); }
+    std::string getImagePath() const { return image ? image->getPath() : std::string(); }
     size_t getBlockSize() const { return storage.getBlockSize(); }
 
     // Простая проверка исправности (self-test).
@@ -107,4 +1787,3 @@ public:
 };
 
 #endif // HARD_DRIVE_HPP
-
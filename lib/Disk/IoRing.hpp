@@ -0,0 +1,417 @@
+#ifndef IO_RING_HPP
+#define IO_RING_HPP
+
+#include "Disk/HardDrive.hpp"
+#include "Disk/IoScheduler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * LockFreeRing<T> — ограниченная очередь без блокировок для нескольких
+ * производителей и потребителей (схема Д. Вьюкова): у каждой ячейки свой
+ * номер поколения, позиции чтения и записи продвигаются CAS. Ёмкость —
+ * степень двойки.
+ */
+template <typename T>
+class LockFreeRing {
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) std::atomic<size_t> enqueue_pos{0};
+    alignas(64) std::atomic<size_t> dequeue_pos{0};
+
+public:
+    explicit LockFreeRing(size_t capacity) : cells(new Cell[capacity]), mask(capacity - 1) {
+        if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+            throw std::invalid_argument("Ring capacity must be a power of two >= 2");
+        }
+        for (size_t i = 0; i < capacity; ++i) cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bool push(const T& value) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells[pos & mask];
+            const size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;  // заполнена
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value) {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells[pos & mask];
+            const size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;  // пуста
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->data);
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return mask + 1; }
+};
+
+struct IoCompletion {
+    uint64_t user_data = 0;
+    bool ok = true;
+    size_t bytes = 0;
+    std::string error;
+};
+
+struct IoRingStats {
+    size_t submitted = 0;
+    size_t completed = 0;
+    size_t failed = 0;
+    size_t max_in_flight = 0;
+};
+
+/**
+ * IoRing — асинхронный ввод-вывод с HardDrive в духе io_uring.
+ *
+ * Вызывающий поток кладёт запросы в кольцо отправки (prepare*) и будит
+ * рабочие потоки (submit); рабочие выполняют их параллельно и кладут
+ * результаты с user_data в кольцо завершений, откуда они забираются
+ * пачками (reap/waitCompletions). Кольца без блокировок; мьютексы нужны
+ * только чтобы усыплять и будить простаивающие потоки.
+ *
+ * Число запросов в полёте ограничено ёмкостью кольца завершений, поэтому
+ * оно не переполняется: prepare() вернёт false, пока завершения не забраны.
+ * Отправлять и забирать следует из одного потока (как в io_uring).
+ *
+ * Read/Write работают с блочным хранилищем в обход таблицы файлов
+ * (HardDrive::readRawBlocks/writeRawBlocks: кэш диска согласуется, суммы
+ * блоков проверяются и обновляются под блокировкой блока вместе с данными).
+ * Рабочий поток переносит запросы из кольца в планировщик (IoScheduler)
+ * и выполняет каждую выданную им слитую операцию одним вызовом
+ * readRawBlocks/writeRawBlocks на весь участок (модель времени тоже видит
+ * одно обращение); ошибки сообщаются по частям. Flush минует
+ * планировщик, сбрасывает данные диска (syncData) и не упорядочен
+ * относительно выполняющихся запросов — для барьера сначала дождитесь
+ * завершения записей (как fsync без IOSQE_IO_DRAIN).
+ */
+class IoRing {
+private:
+    HardDrive& hdd;
+    LockFreeRing<IoRequest> submissions;
+    LockFreeRing<IoCompletion> completions;
+
+    std::mutex scheduler_mutex;
+    IoScheduler scheduler;
+
+    std::atomic<size_t> queued{0};     // в кольце отправки
+    std::atomic<size_t> scheduled{0};  // в планировщике
+    std::atomic<size_t> in_flight{0};  // отправлено, но не забрано
+    std::atomic<size_t> ready{0};      // в кольце завершений
+    size_t prepared = 0;               // с последнего submit()
+    IoRingStats stats;                 // поля, меняемые вызывающим потоком
+    std::atomic<size_t> failed{0};
+
+    std::mutex work_mutex;
+    std::condition_variable work_ready;
+    std::mutex completion_mutex;
+    std::condition_variable completion_ready;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    void validate(const IoRequest& req) const {
+        const size_t total = hdd.getStorage().getTotalBlocks();
+        if (req.block > total || req.count > total - req.block) {
+            throw std::out_of_range("I/O request out of bounds: block " + std::to_string(req.block) +
+                                    " + " + std::to_string(req.count));
+        }
+        if (req.count > 0 && !req.buffer) throw std::invalid_argument("I/O request without buffer");
+    }
+
+    // Выполнить объединённый запрос одним обращением ко всему участку: кэш
+    // диска согласуется один раз, блоки копируются под их блокировками
+    // вместе с проверкой (обновлением) сумм. errors[k] — ошибка k-й части
+    // (пусто — успех). Чтение после испорченного блока продолжается со
+    // следующей части; отклонённая запись повторяется по частям, чтобы
+    // ошибку получили только затронутые части.
+    void execute(const IoDispatch& dispatch, std::vector<std::string>& errors) {
+        const size_t block_size = hdd.getBlockSize();
+        const std::vector<IoRequest>& parts = dispatch.parts;
+        errors.assign(parts.size(), std::string());
+        // Части идут подряд: starts[k] — начало k-й части от dispatch.block,
+        // buffers[j] — куда (откуда) копируется j-й блок участка.
+        std::vector<size_t> starts(parts.size());
+        std::vector<uint8_t*> buffers(dispatch.count);
+        for (size_t k = 0, at = 0; k < parts.size(); at += parts[k].count, ++k) {
+            starts[k] = at;
+            for (size_t i = 0; i < parts[k].count; ++i) buffers[at + i] = parts[k].buffer + i * block_size;
+        }
+        auto partOf = [&](size_t offset) {
+            return static_cast<size_t>(std::upper_bound(starts.begin(), starts.end(), offset) - starts.begin()) - 1;
+        };
+
+        if (dispatch.op == IoOp::Read) {
+            size_t pos = 0;
+            while (pos < dispatch.count) {
+                size_t done = pos;
+                try {
+                    const bool intact = hdd.readRawBlocks(dispatch.block + pos, dispatch.count - pos,
+                                                          [&](size_t i, BlockView block) {
+                        std::memcpy(buffers[pos + i], block.data(), block_size);
+                        done = pos + i + 1;
+                    });
+                    if (intact) break;
+                } catch (const std::exception& e) {
+                    for (size_t k = partOf(done); k < parts.size(); ++k) errors[k] = e.what();
+                    break;
+                }
+                const size_t k = partOf(done);
+                errors[k] = "Checksum mismatch in blocks " + std::to_string(parts[k].block) + " + " +
+                            std::to_string(parts[k].count);
+                pos = starts[k] + parts[k].count;
+            }
+        } else {
+            try {
+                hdd.writeRawBlocks(dispatch.block, dispatch.count, [&](size_t i, MutableBlockView block) {
+                    std::memcpy(block.data(), buffers[i], block_size);
+                });
+            } catch (const std::exception&) {
+                for (size_t k = 0; k < parts.size(); ++k) {
+                    try {
+                        hdd.writeRawBlocks(parts[k].block, parts[k].count, [&](size_t i, MutableBlockView block) {
+                            std::memcpy(block.data(), buffers[starts[k] + i], block_size);
+                        });
+                    } catch (const std::exception& e) {
+                        errors[k] = e.what();
+                    }
+                }
+            }
+        }
+        hdd.chargeAccess(dispatch.op == IoOp::Write, dispatch.block, dispatch.count, false);
+    }
+
+    void complete(IoCompletion& done) {
+        if (!done.ok) failed.fetch_add(1, std::memory_order_relaxed);
+        // Место есть всегда: запросов в полёте не больше ёмкости кольца
+        while (!completions.push(done)) std::this_thread::yield();
+        ready.fetch_add(1, std::memory_order_release);
+    }
+
+    void notifyCompletions() {
+        { std::lock_guard<std::mutex> lock(completion_mutex); }
+        completion_ready.notify_all();
+    }
+
+    void run() {
+        std::vector<IoCompletion> direct;  // Flush и ошибочные запросы
+        std::vector<IoRequest> flushes;
+        IoDispatch dispatch;
+        std::vector<std::string> errors;
+        for (;;) {
+            bool have_dispatch = false;
+            bool more = false;
+            {
+                std::lock_guard<std::mutex> lock(scheduler_mutex);
+                const IoScheduler::Clock::time_point now = IoScheduler::Clock::now();
+                IoRequest req;
+                while (submissions.pop(req)) {
+                    queued.fetch_sub(1, std::memory_order_relaxed);
+                    if (req.op == IoOp::Flush) {
+                        flushes.push_back(req);
+                        continue;
+                    }
+                    try {
+                        validate(req);
+                        scheduler.add(req, now);
+                        scheduled.fetch_add(1, std::memory_order_relaxed);
+                    } catch (const std::exception& e) {
+                        IoCompletion done;
+                        done.user_data = req.user_data;
+                        done.ok = false;
+                        done.error = e.what();
+                        direct.push_back(std::move(done));
+                    }
+                }
+                have_dispatch = scheduler.next(dispatch, now);
+                if (have_dispatch) scheduled.fetch_sub(dispatch.parts.size(), std::memory_order_relaxed);
+                more = !scheduler.empty();
+            }
+            // Остаток очереди могут разбирать и другие рабочие
+            if (more) work_ready.notify_one();
+
+            for (const IoRequest& flush : flushes) {
+                IoCompletion done;
+                done.user_data = flush.user_data;
+                try {
+                    hdd.syncData();
+                } catch (const std::exception& e) {
+                    done.ok = false;
+                    done.error = e.what();
+                }
+                direct.push_back(std::move(done));
+            }
+            if (have_dispatch) {
+                execute(dispatch, errors);
+                const size_t block_size = hdd.getBlockSize();
+                for (size_t k = 0; k < dispatch.parts.size(); ++k) {
+                    const IoRequest& part = dispatch.parts[k];
+                    IoCompletion done;
+                    done.user_data = part.user_data;
+                    done.error = std::move(errors[k]);
+                    done.ok = done.error.empty();
+                    done.bytes = done.ok ? part.count * block_size : 0;
+                    complete(done);
+                }
+            }
+            const bool worked = have_dispatch || !direct.empty() || !flushes.empty();
+            for (IoCompletion& done : direct) complete(done);
+            direct.clear();
+            flushes.clear();
+            if (worked) {
+                notifyCompletions();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(work_mutex);
+            work_ready.wait(lock, [this] {
+                return stopping || queued.load(std::memory_order_acquire) > 0 ||
+                       scheduled.load(std::memory_order_acquire) > 0;
+            });
+            if (stopping && queued.load(std::memory_order_acquire) == 0 &&
+                scheduled.load(std::memory_order_acquire) == 0) {
+                return;
+            }
+        }
+    }
+
+public:
+    // entries — ёмкость колец (степень двойки). Хранилище диска должно быть
+    // потокобезопасным: рабочие потоки обращаются к нему параллельно.
+    IoRing(HardDrive& hdd, size_t worker_count = 2, size_t entries = 64,
+           SchedulerPolicy policy = SchedulerPolicy::Deadline)
+        : hdd(hdd), submissions(entries), completions(entries), scheduler(policy) {
+        if (!hdd.getStorage().isThreadSafe()) {
+            throw std::runtime_error("Asynchronous I/O requires thread-safe disk storage");
+        }
+        if (worker_count == 0) throw std::invalid_argument("IoRing needs at least one worker");
+        for (size_t i = 0; i < worker_count; ++i) workers.emplace_back([this] { run(); });
+    }
+
+    IoRing(const IoRing&) = delete;
+    IoRing& operator=(const IoRing&) = delete;
+
+    // Отправленные запросы выполняются до конца; незабранные завершения теряются.
+    ~IoRing() {
+        {
+            std::lock_guard<std::mutex> lock(work_mutex);
+            stopping = true;
+        }
+        work_ready.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    // Положить запрос в кольцо отправки; false — кольцо заполнено.
+    bool prepare(const IoRequest& req) {
+        if (in_flight.load(std::memory_order_relaxed) >= completions.capacity()) return false;
+        if (!submissions.push(req)) return false;
+        in_flight.fetch_add(1, std::memory_order_relaxed);
+        queued.fetch_add(1, std::memory_order_release);
+        ++prepared;
+        ++stats.submitted;
+        stats.max_in_flight = std::max(stats.max_in_flight, in_flight.load(std::memory_order_relaxed));
+        return true;
+    }
+
+    bool prepareRead(size_t block, size_t count, uint8_t* buffer, uint64_t user_data) {
+        return prepare(IoRequest{IoOp::Read, block, count, buffer, user_data, 0});
+    }
+
+    bool prepareWrite(size_t block, size_t count, const uint8_t* buffer, uint64_t user_data) {
+        return prepare(IoRequest{IoOp::Write, block, count, const_cast<uint8_t*>(buffer), user_data, 0});
+    }
+
+    bool prepareFlush(uint64_t user_data) {
+        return prepare(IoRequest{IoOp::Flush, 0, 0, nullptr, user_data, 0});
+    }
+
+    // Разбудить рабочие потоки; возвращает число запросов с прошлого вызова.
+    size_t submit() {
+        const size_t count = prepared;
+        prepared = 0;
+        { std::lock_guard<std::mutex> lock(work_mutex); }
+        work_ready.notify_all();
+        return count;
+    }
+
+    // Забрать до max готовых завершений, не ожидая.
+    size_t reap(std::vector<IoCompletion>& out, size_t max) {
+        size_t count = 0;
+        IoCompletion done;
+        while (count < max && completions.pop(done)) {
+            ready.fetch_sub(1, std::memory_order_relaxed);
+            in_flight.fetch_sub(1, std::memory_order_relaxed);
+            ++stats.completed;
+            out.push_back(std::move(done));
+            ++count;
+        }
+        return count;
+    }
+
+    // Дождаться хотя бы min завершений и забрать до max.
+    size_t waitCompletions(std::vector<IoCompletion>& out, size_t min, size_t max) {
+        size_t count = reap(out, max);
+        while (count < min) {
+            {
+                std::unique_lock<std::mutex> lock(completion_mutex);
+                completion_ready.wait(lock, [this] { return ready.load(std::memory_order_acquire) > 0; });
+            }
+            count += reap(out, max - count);
+        }
+        return count;
+    }
+
+    size_t getInFlight() const { return in_flight.load(std::memory_order_relaxed); }
+    size_t getWorkerCount() const { return workers.size(); }
+
+    IoSchedulerStats getSchedulerStats() {
+        std::lock_guard<std::mutex> lock(scheduler_mutex);
+        return scheduler.getStats();
+    }
+
+    IoRingStats getStats() const {
+        IoRingStats result = stats;
+        result.failed = failed.load(std::memory_order_relaxed);
+        return result;
+    }
+};
+
+#endif // IO_RING_HPP
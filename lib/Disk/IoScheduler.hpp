@@ -0,0 +1,188 @@
+#ifndef IO_SCHEDULER_HPP
+#define IO_SCHEDULER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+enum class IoOp { Read, Write, Flush };
+
+// Запрос: блоки [block, block + count) диска; буфер принадлежит вызывающему
+// и должен жить до получения завершения (count * block_size байт).
+struct IoRequest {
+    IoOp op = IoOp::Read;
+    size_t block = 0;
+    size_t count = 0;
+    uint8_t* buffer = nullptr;
+    uint64_t user_data = 0;     // возвращается в завершении как есть
+    uint32_t deadline_us = 0;   // срок выполнения; 0 — по умолчанию планировщика
+};
+
+enum class SchedulerPolicy {
+    Noop,      // порядок поступления, слияние только с последующими запросами
+    Deadline,  // элеватор, но просроченные запросы — первыми
+    Elevator   // циклический проход по возрастанию номера блока (C-LOOK)
+};
+
+// Одна операция с хранилищем: непрерывный участок [block, block + count)
+// и вошедшие в него запросы по возрастанию блока.
+struct IoDispatch {
+    IoOp op = IoOp::Read;
+    size_t block = 0;
+    size_t count = 0;
+    std::vector<IoRequest> parts;
+};
+
+struct IoSchedulerStats {
+    size_t requests = 0;
+    size_t dispatches = 0;
+    size_t merged = 0;     // запросов, присоединённых к чужой операции
+    size_t expired = 0;    // операций, выбранных по истёкшему сроку
+    size_t max_depth = 0;
+    uint64_t depth_sum = 0;  // глубина очереди, суммированная по поступлениям
+
+    double getMergeRate() const {
+        return requests ? static_cast<double>(merged) / static_cast<double>(requests) : 0.0;
+    }
+
+    double getAverageDepth() const {
+        return requests ? static_cast<double>(depth_sum) / static_cast<double>(requests) : 0.0;
+    }
+};
+
+/**
+ * IoScheduler — очередь блочных запросов чтения/записи перед хранилищем.
+ *
+ * Запросы упорядочиваются политикой и сливаются: соседние по блокам
+ * запросы одного типа выдаются одной операцией (IoDispatch) не длиннее
+ * max_merge_blocks. У каждого запроса есть срок (по умолчанию read_expire
+ * или write_expire от поступления); политика Deadline выдаёт просроченные
+ * запросы раньше остальных.
+ *
+ * Время передаётся вызывающим, поэтому планировщик детерминирован.
+ * Не потокобезопасен; запросы к одним и тем же блокам могут быть
+ * переупорядочены (как и параллельные запросы IoRing).
+ */
+class IoScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    struct Entry {
+        IoRequest req;
+        Clock::time_point expires;
+    };
+
+    using BlockKey = std::pair<size_t, uint64_t>;  // (блок, номер поступления)
+
+    SchedulerPolicy policy;
+    size_t max_merge_blocks;
+    Clock::duration read_expire;
+    Clock::duration write_expire;
+
+    std::map<BlockKey, Entry> by_block;
+    std::map<uint64_t, size_t> by_arrival;  // номер -> блок
+    std::set<std::tuple<Clock::time_point, uint64_t, size_t>> by_deadline;
+    uint64_t next_seq = 0;
+    size_t head = 0;  // блок, на котором закончилась последняя операция
+    IoSchedulerStats stats;
+
+    void take(std::map<BlockKey, Entry>::iterator it, IoDispatch& out) {
+        const BlockKey key = it->first;
+        by_arrival.erase(key.second);
+        by_deadline.erase(std::make_tuple(it->second.expires, key.second, key.first));
+        out.count += it->second.req.count;
+        out.parts.push_back(it->second.req);
+        by_block.erase(it);
+    }
+
+    bool canMerge(const IoDispatch& out, const IoRequest& req) const {
+        return req.op == out.op && req.block == out.block + out.count &&
+               out.count + req.count <= max_merge_blocks;
+    }
+
+    std::map<BlockKey, Entry>::iterator pickFirst(Clock::time_point now) {
+        if (policy == SchedulerPolicy::Noop) {
+            const auto first = by_arrival.begin();
+            return by_block.find({first->second, first->first});
+        }
+        if (policy == SchedulerPolicy::Deadline) {
+            const auto& oldest = *by_deadline.begin();
+            if (std::get<0>(oldest) <= now) {
+                ++stats.expired;
+                return by_block.find({std::get<2>(oldest), std::get<1>(oldest)});
+            }
+        }
+        auto it = by_block.lower_bound({head, 0});
+        return it != by_block.end() ? it : by_block.begin();
+    }
+
+public:
+    explicit IoScheduler(SchedulerPolicy policy = SchedulerPolicy::Deadline,
+                         size_t max_merge_blocks = 128,
+                         Clock::duration read_expire = std::chrono::milliseconds(5),
+                         Clock::duration write_expire = std::chrono::milliseconds(50))
+        : policy(policy), max_merge_blocks(max_merge_blocks),
+          read_expire(read_expire), write_expire(write_expire) {
+        if (max_merge_blocks == 0) throw std::invalid_argument("Merge limit must be positive");
+    }
+
+    void add(const IoRequest& req, Clock::time_point now) {
+        if (req.op == IoOp::Flush) {
+            throw std::invalid_argument("Flush requests are not scheduled");
+        }
+        Clock::time_point expires = now + (req.op == IoOp::Read ? read_expire : write_expire);
+        if (req.deadline_us) expires = now + std::chrono::microseconds(req.deadline_us);
+        const uint64_t seq = next_seq++;
+        by_block.emplace(BlockKey{req.block, seq}, Entry{req, expires});
+        by_arrival.emplace(seq, req.block);
+        by_deadline.emplace(expires, seq, req.block);
+        ++stats.requests;
+        stats.depth_sum += by_block.size();
+        if (by_block.size() > stats.max_depth) stats.max_depth = by_block.size();
+    }
+
+    // Выдать следующую операцию; false — очередь пуста.
+    bool next(IoDispatch& out, Clock::time_point now) {
+        if (by_block.empty()) return false;
+        auto first = pickFirst(now);
+        out.op = first->second.req.op;
+        out.block = first->second.req.block;
+        out.count = 0;
+        out.parts.clear();
+        take(first, out);
+
+        if (policy == SchedulerPolicy::Noop) {
+            while (!by_arrival.empty()) {
+                const auto following = by_arrival.begin();
+                auto it = by_block.find({following->second, following->first});
+                if (!canMerge(out, it->second.req)) break;
+                take(it, out);
+            }
+        } else {
+            auto it = by_block.lower_bound({out.block + out.count, 0});
+            while (it != by_block.end() && canMerge(out, it->second.req)) {
+                take(it, out);
+                it = by_block.lower_bound({out.block + out.count, 0});
+            }
+        }
+        head = out.block + out.count;
+        ++stats.dispatches;
+        stats.merged += out.parts.size() - 1;
+        return true;
+    }
+
+    size_t size() const { return by_block.size(); }
+    bool empty() const { return by_block.empty(); }
+    SchedulerPolicy getPolicy() const { return policy; }
+    IoSchedulerStats getStats() const { return stats; }
+    void resetStats() { stats = IoSchedulerStats{}; }
+};
+
+#endif // IO_SCHEDULER_HPP
@@ -0,0 +1,140 @@
+#ifndef METADATA_JOURNAL_HPP
+#define METADATA_JOURNAL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * MetadataJournal — кольцевой журнал транзакций в области памяти
+ * (в образе диска — отображённая область между метаданными и данными).
+ *
+ * Транзакция: [магия u32][длина данных u32][номер u64][сумма u64][данные].
+ * Номера идут подряд, сумма (FNV-1a) покрывает номер и данные. При
+ * воспроизведении цепочка обрывается на первой записи с чужой магией,
+ * неожиданным номером или неверной суммой — так отбрасываются и
+ * недописанная при сбое транзакция, и старые записи, оставшиеся в кольце
+ * после контрольной записи.
+ *
+ * Содержимое транзакции журнал не интерпретирует. Когда место кончается,
+ * append() возвращает false: владелец сохраняет полное состояние и
+ * вызывает checkpoint(), освобождая кольцо.
+ */
+class MetadataJournal {
+public:
+    static constexpr uint32_t kMagic = 0x4C4E524A;  // "JRNL"
+    static constexpr size_t kRecordHeader = 24;
+
+private:
+    uint8_t* region;
+    size_t capacity;
+    size_t start;        // смещение первой живой транзакции
+    size_t used = 0;     // байт от start до конца последней транзакции
+    uint64_t first_seq;  // номер транзакции по смещению start
+    uint64_t next_seq;
+
+    static uint64_t checksum(uint64_t seq, const uint8_t* data, size_t n) {
+        uint64_t h = 0xCBF29CE484222325ull;
+        for (int i = 0; i < 8; ++i) h = (h ^ static_cast<uint8_t>(seq >> (8 * i))) * 0x100000001B3ull;
+        for (size_t i = 0; i < n; ++i) h = (h ^ data[i]) * 0x100000001B3ull;
+        return h;
+    }
+
+    // Чтение и запись с переходом через конец кольца.
+    void put(size_t pos, const void* src, size_t n) {
+        if (n == 0) return;
+        const size_t first = std::min(n, capacity - pos);
+        std::memcpy(region + pos, src, first);
+        if (n > first) std::memcpy(region, static_cast<const uint8_t*>(src) + first, n - first);
+    }
+
+    void get(size_t pos, void* dst, size_t n) const {
+        if (n == 0) return;
+        const size_t first = std::min(n, capacity - pos);
+        std::memcpy(dst, region + pos, first);
+        if (n > first) std::memcpy(static_cast<uint8_t*>(dst) + first, region, n - first);
+    }
+
+    size_t head() const { return (start + used) % capacity; }
+
+public:
+    MetadataJournal(uint8_t* region, size_t capacity, size_t start, uint64_t first_seq)
+        : region(region), capacity(capacity), start(start), first_seq(first_seq), next_seq(first_seq) {
+        if (capacity < kRecordHeader || start >= capacity) {
+            throw std::invalid_argument("Journal region is too small or start is out of range");
+        }
+    }
+
+    // Передать fn(const std::vector<uint8_t>&) данные уцелевших транзакций
+    // по порядку; после этого append() продолжает цепочку. Возвращает их число.
+    template <typename Fn>
+    size_t replay(Fn&& fn) {
+        used = 0;
+        next_seq = first_seq;
+        size_t count = 0;
+        std::vector<uint8_t> payload;
+        while (capacity - used >= kRecordHeader) {
+            const size_t pos = head();
+            uint8_t header[kRecordHeader];
+            get(pos, header, kRecordHeader);
+            uint32_t magic, length;
+            uint64_t seq, sum;
+            std::memcpy(&magic, header, 4);
+            std::memcpy(&length, header + 4, 4);
+            std::memcpy(&seq, header + 8, 8);
+            std::memcpy(&sum, header + 16, 8);
+            if (magic != kMagic || seq != next_seq ||
+                length > capacity - used - kRecordHeader) {
+                break;
+            }
+            payload.resize(length);
+            get((pos + kRecordHeader) % capacity, payload.data(), length);
+            if (checksum(seq, payload.data(), length) != sum) break;
+            fn(payload);
+            used += kRecordHeader + length;
+            ++next_seq;
+            ++count;
+        }
+        return count;
+    }
+
+    // Дописать транзакцию; false — не хватает места (нужна контрольная запись).
+    bool append(const std::vector<uint8_t>& payload) {
+        const size_t bytes = kRecordHeader + payload.size();
+        if (bytes > capacity - used || payload.size() > UINT32_MAX) return false;
+        const size_t pos = head();
+        uint8_t header[kRecordHeader];
+        const uint32_t magic = kMagic;
+        const uint32_t length = static_cast<uint32_t>(payload.size());
+        const uint64_t sum = checksum(next_seq, payload.data(), payload.size());
+        std::memcpy(header, &magic, 4);
+        std::memcpy(header + 4, &length, 4);
+        std::memcpy(header + 8, &next_seq, 8);
+        std::memcpy(header + 16, &sum, 8);
+        put((pos + kRecordHeader) % capacity, payload.data(), payload.size());
+        put(pos, header, kRecordHeader);
+        used += bytes;
+        ++next_seq;
+        return true;
+    }
+
+    // Всё записанное отражено в полном состоянии владельца: кольцо пусто,
+    // следующая транзакция пишется с текущей позиции.
+    void checkpoint() {
+        start = head();
+        used = 0;
+        first_seq = next_seq;
+    }
+
+    size_t getCapacity() const { return capacity; }
+    size_t getUsed() const { return used; }
+    size_t getStart() const { return start; }
+    // Куда запишется следующая транзакция (начало кольца после checkpoint()).
+    size_t getHead() const { return head(); }
+    uint64_t getNextSeq() const { return next_seq; }
+};
+
+#endif // METADATA_JOURNAL_HPP
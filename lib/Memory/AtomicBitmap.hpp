@@ -0,0 +1,179 @@
+#ifndef ATOMIC_BITMAP_HPP
+#define ATOMIC_BITMAP_HPP
+
+#include "Memory/BitOps.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+/**
+ * AtomicBitmap — битовая карта из 64-битных атомарных слов.
+ * Установка бита безопасна из нескольких потоков; обход и массовая
+ * очистка идут пословно (countTrailingZeros по ненулевым словам).
+ */
+class AtomicBitmap {
+private:
+    static constexpr size_t kWordBits = 64;
+
+    size_t bits = 0;
+    size_t word_count = 0;
+    std::unique_ptr<std::atomic<uint64_t>[]> words;
+
+    void checkIndex(size_t i) const {
+        if (i >= bits) {
+            throw std::out_of_range("Bitmap index out of range: " + std::to_string(i));
+        }
+    }
+
+    // Применить fn(word_index, mask) ко всем словам диапазона [first, first + count).
+    template <typename Fn>
+    void forEachWordInRange(size_t first, size_t count, Fn&& fn) {
+        if (first > bits || count > bits - first) {
+            throw std::out_of_range("Bitmap range out of range");
+        }
+        size_t i = first;
+        const size_t end = first + count;
+        while (i < end) {
+            const size_t w = i / kWordBits;
+            const unsigned from = static_cast<unsigned>(i % kWordBits);
+            const unsigned to = static_cast<unsigned>(std::min<size_t>(kWordBits, from + (end - i)));
+            fn(w, bitops::rangeMask(from, to));
+            i += to - from;
+        }
+    }
+
+public:
+    explicit AtomicBitmap(size_t bit_count = 0)
+        : bits(bit_count), word_count((bit_count + kWordBits - 1) / kWordBits),
+          words(new std::atomic<uint64_t>[word_count]) {
+        for (size_t w = 0; w < word_count; ++w) words[w].store(0, std::memory_order_relaxed);
+    }
+
+    AtomicBitmap(const AtomicBitmap& other) : AtomicBitmap(other.bits) {
+        for (size_t w = 0; w < word_count; ++w) {
+            words[w].store(other.words[w].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+    }
+
+    AtomicBitmap(AtomicBitmap&& other) noexcept
+        : bits(other.bits), word_count(other.word_count), words(std::move(other.words)) {
+        other.bits = 0;
+        other.word_count = 0;
+    }
+
+    AtomicBitmap& operator=(AtomicBitmap other) noexcept {
+        std::swap(bits, other.bits);
+        std::swap(word_count, other.word_count);
+        std::swap(words, other.words);
+        return *this;
+    }
+
+    size_t size() const { return bits; }
+
+    bool test(size_t i) const {
+        checkIndex(i);
+        return (words[i / kWordBits].load(std::memory_order_relaxed) >> (i % kWordBits)) & 1;
+    }
+
+    // Сначала обычное чтение: если бит уже стоит, слово не захватывается
+    // на запись (меньше перебросов строки кэша между ядрами).
+    void set(size_t i) {
+        checkIndex(i);
+        const uint64_t mask = uint64_t(1) << (i % kWordBits);
+        std::atomic<uint64_t>& word = words[i / kWordBits];
+        if ((word.load(std::memory_order_relaxed) & mask) == 0) {
+            word.fetch_or(mask, std::memory_order_relaxed);
+        }
+    }
+
+    void reset(size_t i) {
+        checkIndex(i);
+        words[i / kWordBits].fetch_and(~(uint64_t(1) << (i % kWordBits)), std::memory_order_relaxed);
+    }
+
+    // Сбросить бит и вернуть его прежнее значение.
+    bool testAndReset(size_t i) {
+        checkIndex(i);
+        const uint64_t mask = uint64_t(1) << (i % kWordBits);
+        std::atomic<uint64_t>& word = words[i / kWordBits];
+        if ((word.load(std::memory_order_relaxed) & mask) == 0) return false;
+        return (word.fetch_and(~mask, std::memory_order_relaxed) & mask) != 0;
+    }
+
+    void setRange(size_t first, size_t count) {
+        forEachWordInRange(first, count, [this](size_t w, uint64_t mask) {
+            if ((words[w].load(std::memory_order_relaxed) & mask) != mask) {
+                words[w].fetch_or(mask, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    void resetRange(size_t first, size_t count) {
+        forEachWordInRange(first, count, [this](size_t w, uint64_t mask) {
+            words[w].fetch_and(~mask, std::memory_order_relaxed);
+        });
+    }
+
+    void clear() {
+        for (size_t w = 0; w < word_count; ++w) words[w].store(0, std::memory_order_relaxed);
+    }
+
+    size_t count() const {
+        size_t n = 0;
+        for (size_t w = 0; w < word_count; ++w) {
+            n += bitops::popCount(words[w].load(std::memory_order_relaxed));
+        }
+        return n;
+    }
+
+    bool any() const {
+        for (size_t w = 0; w < word_count; ++w) {
+            if (words[w].load(std::memory_order_relaxed)) return true;
+        }
+        return false;
+    }
+
+    // Первый установленный бит с индексом >= from; size(), если таких нет.
+    size_t findNextSet(size_t from) const {
+        for (size_t w = from / kWordBits; w < word_count; ++w) {
+            uint64_t word = words[w].load(std::memory_order_relaxed);
+            if (w == from / kWordBits) word &= ~uint64_t(0) << (from % kWordBits);
+            if (word) return w * kWordBits + bitops::countTrailingZeros(word);
+        }
+        return bits;
+    }
+
+    // Обход установленных битов: fn(index).
+    template <typename Fn>
+    void forEachSet(Fn&& fn) const {
+        for (size_t w = 0; w < word_count; ++w) {
+            uint64_t word = words[w].load(std::memory_order_relaxed);
+            while (word) {
+                fn(w * kWordBits + bitops::countTrailingZeros(word));
+                word &= word - 1;
+            }
+        }
+    }
+
+    // Атомарно забрать и очистить установленные биты, вызывая fn(index).
+    // Биты, установленные во время обхода, не теряются: они попадут
+    // в текущий обход или останутся до следующего.
+    template <typename Fn>
+    void drain(Fn&& fn) {
+        for (size_t w = 0; w < word_count; ++w) {
+            if (words[w].load(std::memory_order_relaxed) == 0) continue;
+            uint64_t word = words[w].exchange(0, std::memory_order_acq_rel);
+            while (word) {
+                fn(w * kWordBits + bitops::countTrailingZeros(word));
+                word &= word - 1;
+            }
+        }
+    }
+};
+
+#endif // ATOMIC_BITMAP_HPP
@@ -0,0 +1,52 @@
+#ifndef BIT_OPS_HPP
+#define BIT_OPS_HPP
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Пословные битовые операции для битовых карт (C++17: без <bit>).
+namespace bitops {
+
+// Номер младшего установленного бита; word != 0.
+inline unsigned countTrailingZeros(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctzll(word));
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return static_cast<unsigned>(index);
+#else
+    unsigned n = 0;
+    while ((word & 1) == 0) {
+        word >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+inline unsigned popCount(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_popcountll(word));
+#else
+    unsigned n = 0;
+    while (word) {
+        word &= word - 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+// Маска битов [from, to) внутри 64-битного слова; 0 <= from < to <= 64.
+inline uint64_t rangeMask(unsigned from, unsigned to) {
+    const uint64_t high = to == 64 ? ~uint64_t(0) : ((uint64_t(1) << to) - 1);
+    return high & ~((uint64_t(1) << from) - 1);
+}
+
+} // namespace bitops
+
+#endif // BIT_OPS_HPP
@@ -0,0 +1,63 @@
+#ifndef BLOCK_VIEW_HPP
+#define BLOCK_VIEW_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * BlockSpan<T> — невладеющее представление непрерывного участка памяти
+ * (упрощённый аналог std::span из C++20: указатель + длина).
+ * Данные не копируются; представление действительно, пока жив владелец буфера.
+ */
+template <typename T>
+class BlockSpan {
+private:
+    T* ptr;
+    size_t len;
+
+public:
+    constexpr BlockSpan() noexcept : ptr(nullptr), len(0) {}
+    constexpr BlockSpan(T* data, size_t size) noexcept : ptr(data), len(size) {}
+
+    // Неявное преобразование изменяемого представления в константное.
+    template <typename U,
+              typename = std::enable_if_t<std::is_same<const U, T>::value && !std::is_same<U, T>::value>>
+    constexpr BlockSpan(const BlockSpan<U>& other) noexcept : ptr(other.data()), len(other.size()) {}
+
+    constexpr T* data() const noexcept { return ptr; }
+    constexpr size_t size() const noexcept { return len; }
+    constexpr bool empty() const noexcept { return len == 0; }
+
+    constexpr T* begin() const noexcept { return ptr; }
+    constexpr T* end() const noexcept { return ptr + len; }
+
+    T& operator[](size_t i) const { return ptr[i]; }
+
+    T& at(size_t i) const {
+        if (i >= len) {
+            throw std::out_of_range("BlockSpan index out of range: " + std::to_string(i));
+        }
+        return ptr[i];
+    }
+
+    BlockSpan subspan(size_t offset, size_t count) const {
+        if (offset > len || count > len - offset) {
+            throw std::out_of_range("BlockSpan subspan out of range");
+        }
+        return BlockSpan(ptr + offset, count);
+    }
+
+    // Явная копия — для кода, которому нужен владеющий буфер.
+    std::vector<std::remove_const_t<T>> toVector() const {
+        return std::vector<std::remove_const_t<T>>(ptr, ptr + len);
+    }
+};
+
+using BlockView = BlockSpan<const uint8_t>;
+using MutableBlockView = BlockSpan<uint8_t>;
+
+#endif // BLOCK_VIEW_HPP
@@ -0,0 +1,272 @@
+#ifndef FRAME_STORE_HPP
+#define FRAME_STORE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define SIMPLEVM_HAS_MMAP 1
+#else
+#define SIMPLEVM_HAS_MMAP 0
+#endif
+
+// Откуда берётся общий буфер Dense-режима.
+enum class MemoryBacking {
+    Heap,       // operator new
+    Mmap,       // анонимный mmap с MAP_NORESERVE
+    HugePages,  // mmap на больших страницах (при неудаче — обычный mmap)
+    External    // внешний буфер (например, отображённый файл образа диска), не принадлежит хранилищу
+};
+
+// Кадр памяти: данные блока и счётчик ссылок на них
+// (сколько экземпляров MemoryBlock сейчас разделяют этот кадр).
+struct FrameSlot {
+    uint8_t* data = nullptr;
+    std::atomic<uint32_t>* refs = nullptr;
+};
+
+/**
+ * FrameStore — владелец памяти кадров.
+ * Общий (через shared_ptr) для MemoryBlock и всех его снимков, поэтому
+ * кадр живёт, пока на него ссылается хотя бы один экземпляр.
+ *
+ * Кадры берутся из Dense-области (один непрерывный буфер, выделяется
+ * один раз), из порций по kChunkBytes или из списка освобождённых кадров.
+ * Выделение и освобождение потокобезопасны; счётчики ссылок атомарны.
+ */
+class FrameStore {
+public:
+    static constexpr size_t kAlignment = 64;
+
+private:
+    static constexpr size_t kChunkBytes = 64 * 1024;
+    // Большая страница (PMD на x86-64 и AArch64 с 4-КБ страницами): по ней
+    // выравнивается отображение для MADV_HUGEPAGE.
+    static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+    struct Chunk {
+        uint8_t* data;
+        std::unique_ptr<std::atomic<uint32_t>[]> refs;
+    };
+
+    size_t block_size;
+    MemoryBacking backing;
+    size_t page_size = 0;
+    size_t mapped_bytes = 0;
+
+    uint8_t* dense = nullptr;
+    size_t dense_bytes = 0;
+    std::unique_ptr<std::atomic<uint32_t>[]> dense_refs;
+    uint8_t* zero_page = nullptr;
+
+    std::mutex mutex;
+    std::vector<Chunk> chunks;
+    size_t chunk_used = 0;
+    std::vector<FrameSlot> free_frames;
+
+    static size_t roundUp(size_t value, size_t align) {
+        return (value + align - 1) / align * align;
+    }
+
+    static size_t systemPageSize() {
+#if SIMPLEVM_HAS_MMAP
+        const long size = sysconf(_SC_PAGESIZE);
+        if (size > 0) return static_cast<size_t>(size);
+#endif
+        return 4096;
+    }
+
+    size_t framesPerChunk() const {
+        return block_size >= kChunkBytes ? 1 : kChunkBytes / block_size;
+    }
+
+#if SIMPLEVM_HAS_MMAP
+    static int anonymousFlags() {
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+        flags |= MAP_NORESERVE;
+#endif
+        return flags;
+    }
+
+    // Отображение на больших страницах. Сначала пробуем явные huge pages
+    // (MAP_HUGETLB, требуют резерва в ядре), затем выровненную область
+    // с MADV_HUGEPAGE. Возвращает false, если mmap не удался совсем.
+    bool mapHugePages(size_t bytes) {
+        const size_t huge = kHugePageSize;
+        const size_t length = roundUp(bytes, huge);
+#ifdef MAP_HUGETLB
+        // Без MAP_NORESERVE: иначе при пустом пуле huge pages mmap удаётся,
+        // а первое обращение к странице завершается SIGBUS.
+        void* explicit_huge = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (explicit_huge != MAP_FAILED) {
+            dense = static_cast<uint8_t*>(explicit_huge);
+            mapped_bytes = length;
+            page_size = huge;
+            return true;
+        }
+#endif
+        void* raw = mmap(nullptr, length + huge, PROT_READ | PROT_WRITE, anonymousFlags(), -1, 0);
+        if (raw == MAP_FAILED) return false;
+        const uintptr_t base = reinterpret_cast<uintptr_t>(raw);
+        const uintptr_t aligned = roundUp(base, huge);
+        const size_t head = aligned - base;
+        const size_t tail = huge - head;
+        if (head) munmap(raw, head);
+        if (tail) munmap(reinterpret_cast<void*>(aligned + length), tail);
+        dense = reinterpret_cast<uint8_t*>(aligned);
+        mapped_bytes = length;
+#ifdef MADV_HUGEPAGE
+        if (madvise(dense, length, MADV_HUGEPAGE) == 0) {
+            page_size = huge;
+            return true;
+        }
+#endif
+        backing = MemoryBacking::Mmap;
+        return true;
+    }
+
+    bool mapAnonymous(size_t bytes) {
+        if (backing == MemoryBacking::HugePages) return mapHugePages(bytes);
+        const size_t length = roundUp(bytes, page_size);
+        void* p = mmap(nullptr, length, PROT_READ | PROT_WRITE, anonymousFlags(), -1, 0);
+        if (p == MAP_FAILED) return false;
+        dense = static_cast<uint8_t*>(p);
+        mapped_bytes = length;
+        return true;
+    }
+#endif
+
+public:
+    static uint8_t* allocateAligned(size_t bytes) {
+        if (bytes == 0) return nullptr;
+        void* p = ::operator new(bytes, std::align_val_t(kAlignment));
+        std::memset(p, 0, bytes);
+        return static_cast<uint8_t*>(p);
+    }
+
+    static void releaseAligned(uint8_t* p) {
+        if (p) ::operator delete(p, std::align_val_t(kAlignment));
+    }
+
+    FrameStore(size_t block_size, MemoryBacking backing)
+        : block_size(block_size), backing(backing), page_size(systemPageSize()) {
+        zero_page = allocateAligned(block_size);
+    }
+
+    FrameStore(const FrameStore&) = delete;
+    FrameStore& operator=(const FrameStore&) = delete;
+
+    ~FrameStore() {
+#if SIMPLEVM_HAS_MMAP
+        if (backing == MemoryBacking::Mmap || backing == MemoryBacking::HugePages) {
+            if (dense) munmap(dense, mapped_bytes);
+        } else if (backing == MemoryBacking::Heap) {
+            releaseAligned(dense);
+        }
+#else
+        if (backing != MemoryBacking::External) releaseAligned(dense);
+#endif
+        releaseAligned(zero_page);
+        for (Chunk& chunk : chunks) releaseAligned(chunk.data);
+    }
+
+    // Dense-область из count кадров подряд (выделяется один раз).
+    // Если mmap недоступен, используется куча, а getBacking() сообщает,
+    // что реально получено.
+    void allocateDense(size_t count, std::vector<FrameSlot>& out) {
+        const size_t bytes = count * block_size;
+        dense_bytes = bytes;
+#if SIMPLEVM_HAS_MMAP
+        if (backing == MemoryBacking::Heap || bytes == 0 || !mapAnonymous(bytes)) {
+            backing = MemoryBacking::Heap;
+            dense = allocateAligned(bytes);
+        }
+#else
+        backing = MemoryBacking::Heap;
+        dense = allocateAligned(bytes);
+#endif
+        dense_refs.reset(new std::atomic<uint32_t>[count]);
+        for (size_t i = 0; i < count; ++i) {
+            dense_refs[i].store(1, std::memory_order_relaxed);
+            out[i] = FrameSlot{dense + i * block_size, &dense_refs[i]};
+        }
+    }
+
+    // Dense-область поверх внешнего буфера из count кадров.
+    void attachDense(uint8_t* base, size_t count, std::vector<FrameSlot>& out) {
+        backing = MemoryBacking::External;
+        dense = base;
+        dense_bytes = count * block_size;
+        dense_refs.reset(new std::atomic<uint32_t>[count]);
+        for (size_t i = 0; i < count; ++i) {
+            dense_refs[i].store(1, std::memory_order_relaxed);
+            out[i] = FrameSlot{dense + i * block_size, &dense_refs[i]};
+        }
+    }
+
+    // Новый кадр со счётчиком ссылок 1. При zeroed = false содержимое
+    // не определено (вызывающий сразу перезапишет кадр целиком).
+    FrameSlot allocate(bool zeroed = true) {
+        FrameSlot frame;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!free_frames.empty()) {
+                frame = free_frames.back();
+                free_frames.pop_back();
+                if (zeroed) std::memset(frame.data, 0, block_size);
+            } else {
+                const size_t per_chunk = framesPerChunk();
+                if (chunks.empty() || chunk_used == per_chunk) {
+                    Chunk chunk{allocateAligned(per_chunk * block_size),
+                                std::unique_ptr<std::atomic<uint32_t>[]>(new std::atomic<uint32_t>[per_chunk])};
+                    chunks.push_back(std::move(chunk));
+                    chunk_used = 0;
+                }
+                Chunk& chunk = chunks.back();
+                frame = FrameSlot{chunk.data + chunk_used * block_size, &chunk.refs[chunk_used]};
+                ++chunk_used;
+            }
+        }
+        frame.refs->store(1, std::memory_order_relaxed);
+        return frame;
+    }
+
+    void retain(const FrameSlot& frame) {
+        frame.refs->fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Снять ссылку; последний владелец возвращает кадр в список свободных.
+    // Страницы освобождённого кадра из mmap-области отдаются ядру
+    // (при повторном использовании они снова читаются нулями).
+    void release(const FrameSlot& frame) {
+        if (frame.refs->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+#if SIMPLEVM_HAS_MMAP && defined(MADV_DONTNEED)
+            if ((backing == MemoryBacking::Mmap || backing == MemoryBacking::HugePages) &&
+                frame.data >= dense &&
+                frame.data < dense + dense_bytes && block_size % page_size == 0 &&
+                (reinterpret_cast<uintptr_t>(frame.data) % page_size) == 0) {
+                madvise(frame.data, block_size, MADV_DONTNEED);
+            }
+#endif
+            std::lock_guard<std::mutex> lock(mutex);
+            free_frames.push_back(frame);
+        }
+    }
+
+    const uint8_t* zeroPage() const { return zero_page; }
+    uint8_t* denseBase() const { return dense; }
+    size_t getBlockSize() const { return block_size; }
+    MemoryBacking getBacking() const { return backing; }
+    size_t getPageSize() const { return page_size; }
+};
+
+#endif // FRAME_STORE_HPP
@@ -0,0 +1,439 @@
+#ifndef GUEST_ALLOCATOR_HPP
+#define GUEST_ALLOCATOR_HPP
+
+#include "Memory/MemoryBlock.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * BuddyAllocator — выделение непрерывных групп блоков из диапазона
+ * [first_block, first_block + block_count) по схеме «двойников».
+ * Кусок порядка k занимает 2^k блоков и начинается с номера, кратного 2^k
+ * (относительно first_block). Свободные куски каждого порядка лежат в
+ * двусвязных списках на массивах, поэтому allocate/free — O(log n).
+ * Сам аллокатор хранит только метаданные и в память не пишет.
+ */
+class BuddyAllocator {
+public:
+    static constexpr size_t kNone = SIZE_MAX;
+
+private:
+    size_t base;
+    size_t count;
+    unsigned max_order = 0;
+
+    std::vector<size_t> heads;          // heads[k] — первый свободный кусок порядка k
+    std::vector<size_t> next;
+    std::vector<size_t> prev;
+    std::vector<int8_t> free_order;     // >= 0: здесь начинается свободный кусок этого порядка
+    std::vector<int8_t> alloc_order;    // >= 0: здесь начинается выделенный кусок этого порядка
+    size_t free_blocks = 0;
+    size_t free_chunks = 0;
+
+    static unsigned floorLog2(size_t n) {
+        unsigned k = 0;
+        while ((n >> 1) >= 1 && k < 63) {
+            n >>= 1;
+            ++k;
+        }
+        return k;
+    }
+
+    static unsigned ceilLog2(size_t n) {
+        const unsigned k = floorLog2(n);
+        return (size_t(1) << k) == n ? k : k + 1;
+    }
+
+    void pushFree(size_t rel, unsigned order) {
+        free_order[rel] = static_cast<int8_t>(order);
+        prev[rel] = kNone;
+        next[rel] = heads[order];
+        if (heads[order] != kNone) prev[heads[order]] = rel;
+        heads[order] = rel;
+        free_blocks += size_t(1) << order;
+        ++free_chunks;
+    }
+
+    void removeFree(size_t rel) {
+        const unsigned order = static_cast<unsigned>(free_order[rel]);
+        if (prev[rel] != kNone) next[prev[rel]] = next[rel];
+        else heads[order] = next[rel];
+        if (next[rel] != kNone) prev[next[rel]] = prev[rel];
+        free_order[rel] = -1;
+        free_blocks -= size_t(1) << order;
+        --free_chunks;
+    }
+
+    size_t relative(size_t block_id) const {
+        if (block_id < base || block_id - base >= count) {
+            throw std::out_of_range("Block is outside of allocator range: " + std::to_string(block_id));
+        }
+        return block_id - base;
+    }
+
+public:
+    BuddyAllocator(size_t first_block, size_t block_count)
+        : base(first_block), count(block_count) {
+        if (block_count == 0) {
+            throw std::invalid_argument("BuddyAllocator: empty block range");
+        }
+        max_order = floorLog2(block_count);
+        heads.assign(max_order + 1, kNone);
+        next.assign(count, kNone);
+        prev.assign(count, kNone);
+        free_order.assign(count, -1);
+        alloc_order.assign(count, -1);
+
+        // Диапазон произвольной длины режется на максимальные выровненные куски.
+        size_t pos = 0;
+        while (pos < count) {
+            unsigned order = max_order;
+            while ((pos & ((size_t(1) << order) - 1)) != 0 || pos + (size_t(1) << order) > count) {
+                --order;
+            }
+            pushFree(pos, order);
+            pos += size_t(1) << order;
+        }
+    }
+
+    // Выделить не менее blocks блоков; возвращает номер первого блока.
+    // Реально выделяется 2^ceil(log2(blocks)) блоков (см. allocationSize).
+    size_t allocate(size_t blocks) {
+        if (blocks == 0) {
+            throw std::invalid_argument("BuddyAllocator: zero-sized allocation");
+        }
+        const unsigned order = ceilLog2(blocks);
+        unsigned k = order;
+        while (k <= max_order && heads[k] == kNone) ++k;
+        if (order > max_order || k > max_order) {
+            throw std::runtime_error("Out of guest memory: cannot allocate " +
+                                     std::to_string(blocks) + " block(s)");
+        }
+        const size_t rel = heads[k];
+        removeFree(rel);
+        // Расщепляем кусок, возвращая правые половины в списки.
+        while (k > order) {
+            --k;
+            pushFree(rel + (size_t(1) << k), k);
+        }
+        alloc_order[rel] = static_cast<int8_t>(order);
+        return base + rel;
+    }
+
+    void free(size_t block_id) {
+        size_t rel = relative(block_id);
+        if (alloc_order[rel] < 0) {
+            throw std::invalid_argument("BuddyAllocator: block " + std::to_string(block_id) +
+                                        " is not an allocation start");
+        }
+        unsigned order = static_cast<unsigned>(alloc_order[rel]);
+        alloc_order[rel] = -1;
+        // Слияние со свободным двойником того же порядка.
+        while (order < max_order) {
+            const size_t buddy = rel ^ (size_t(1) << order);
+            if (buddy + (size_t(1) << order) > count || free_order[buddy] != static_cast<int8_t>(order)) {
+                break;
+            }
+            removeFree(buddy);
+            rel = std::min(rel, buddy);
+            ++order;
+        }
+        pushFree(rel, order);
+    }
+
+    bool isAllocated(size_t block_id) const {
+        return alloc_order[relative(block_id)] >= 0;
+    }
+
+    // Размер выделенного куска в блоках.
+    size_t allocationSize(size_t block_id) const {
+        const int8_t order = alloc_order[relative(block_id)];
+        if (order < 0) {
+            throw std::invalid_argument("BuddyAllocator: block " + std::to_string(block_id) +
+                                        " is not an allocation start");
+        }
+        return size_t(1) << order;
+    }
+
+    size_t getFirstBlock() const { return base; }
+    size_t getBlockCount() const { return count; }
+    size_t getFreeBlocks() const { return free_blocks; }
+    size_t getFreeChunks() const { return free_chunks; }
+
+    // Самый большой свободный кусок — старший непустой порядок, O(log n).
+    size_t getLargestFreeRun() const {
+        for (size_t k = heads.size(); k-- > 0;) {
+            if (heads[k] != kNone) return size_t(1) << k;
+        }
+        return 0;
+    }
+
+    // Внешняя фрагментация: 1 - (наибольший свободный кусок / всё свободное).
+    double getExternalFragmentation() const {
+        if (free_blocks == 0) return 0.0;
+        return 1.0 - static_cast<double>(getLargestFreeRun()) / static_cast<double>(free_blocks);
+    }
+};
+
+/**
+ * SlabCache — кэш объектов одного размера внутри блоков памяти.
+ * Слаб — кусок от BuddyAllocator, нарезанный на ячейки object_size байт.
+ * Свободные ячейки хранятся стеком в метаданных слаба, поэтому
+ * allocate/free — O(1). Пустой слаб возвращается в BuddyAllocator,
+ * если в кэше есть другие слабы.
+ */
+class SlabCache {
+private:
+    // Слаб вмещает не меньше стольких объектов (пока хватает памяти).
+    static constexpr size_t kMinObjectsPerSlab = 8;
+
+    struct Slab {
+        size_t first_block;
+        size_t capacity;
+        std::vector<uint32_t> free_slots;
+        std::vector<bool> used;
+        size_t partial_index;  // позиция в partial или SIZE_MAX
+        size_t index;          // позиция в slabs
+    };
+
+    BuddyAllocator& buddy;
+    size_t block_size;
+    size_t object_size;
+    size_t slab_blocks;
+
+    std::vector<std::unique_ptr<Slab>> slabs;
+    std::vector<Slab*> partial;                   // слабы со свободными ячейками
+    std::unordered_map<size_t, Slab*> slab_by_block;
+    size_t objects_in_use = 0;
+
+    void addPartial(Slab* slab) {
+        slab->partial_index = partial.size();
+        partial.push_back(slab);
+    }
+
+    void removePartial(Slab* slab) {
+        Slab* last = partial.back();
+        partial[slab->partial_index] = last;
+        last->partial_index = slab->partial_index;
+        partial.pop_back();
+        slab->partial_index = SIZE_MAX;
+    }
+
+    Slab* growSlab() {
+        const size_t first = buddy.allocate(slab_blocks);
+        const size_t blocks = buddy.allocationSize(first);
+        auto slab = std::make_unique<Slab>();
+        slab->first_block = first;
+        slab->capacity = blocks * block_size / object_size;
+        slab->used.assign(slab->capacity, false);
+        slab->free_slots.reserve(slab->capacity);
+        for (size_t i = slab->capacity; i-- > 0;) {
+            slab->free_slots.push_back(static_cast<uint32_t>(i));
+        }
+        for (size_t b = 0; b < blocks; ++b) slab_by_block[first + b] = slab.get();
+        slab->index = slabs.size();
+        Slab* raw = slab.get();
+        slabs.push_back(std::move(slab));
+        addPartial(raw);
+        return raw;
+    }
+
+    void releaseSlab(Slab* slab) {
+        const size_t blocks = buddy.allocationSize(slab->first_block);
+        for (size_t b = 0; b < blocks; ++b) slab_by_block.erase(slab->first_block + b);
+        buddy.free(slab->first_block);
+        const size_t index = slab->index;
+        slabs[index] = std::move(slabs.back());
+        slabs[index]->index = index;
+        slabs.pop_back();
+    }
+
+public:
+    SlabCache(BuddyAllocator& buddy, size_t block_size, size_t object_size)
+        : buddy(buddy), block_size(block_size), object_size(object_size) {
+        if (object_size == 0 || object_size > block_size * buddy.getBlockCount()) {
+            throw std::invalid_argument("SlabCache: invalid object size " + std::to_string(object_size));
+        }
+        slab_blocks = (object_size * kMinObjectsPerSlab + block_size - 1) / block_size;
+        slab_blocks = std::max((object_size + block_size - 1) / block_size,
+                               std::min(slab_blocks, buddy.getLargestFreeRun()));
+    }
+
+    // Выделить объект; возвращает байтовый адрес в памяти.
+    size_t allocate() {
+        Slab* slab = partial.empty() ? growSlab() : partial.back();
+        const uint32_t slot = slab->free_slots.back();
+        slab->free_slots.pop_back();
+        slab->used[slot] = true;
+        if (slab->free_slots.empty()) removePartial(slab);
+        ++objects_in_use;
+        return slab->first_block * block_size + slot * object_size;
+    }
+
+    void free(size_t addr) {
+        auto it = slab_by_block.find(addr / block_size);
+        if (it == slab_by_block.end()) {
+            throw std::invalid_argument("SlabCache: address " + std::to_string(addr) + " is not owned");
+        }
+        Slab* slab = it->second;
+        const size_t offset = addr - slab->first_block * block_size;
+        const size_t slot = offset / object_size;
+        if (offset % object_size != 0 || slot >= slab->capacity || !slab->used[slot]) {
+            throw std::invalid_argument("SlabCache: invalid free of address " + std::to_string(addr));
+        }
+        slab->used[slot] = false;
+        if (slab->free_slots.empty()) addPartial(slab);
+        slab->free_slots.push_back(static_cast<uint32_t>(slot));
+        --objects_in_use;
+
+        if (slab->free_slots.size() == slab->capacity && slabs.size() > 1) {
+            removePartial(slab);
+            releaseSlab(slab);
+        }
+    }
+
+    bool owns(size_t addr) const { return slab_by_block.count(addr / block_size) != 0; }
+
+    size_t getObjectSize() const { return object_size; }
+    size_t getObjectsInUse() const { return objects_in_use; }
+    size_t getSlabCount() const { return slabs.size(); }
+    size_t getReservedBytes() const {
+        size_t bytes = 0;
+        for (const auto& slab : slabs) bytes += buddy.allocationSize(slab->first_block) * block_size;
+        return bytes;
+    }
+};
+
+// Сводная статистика аллокатора гостевой памяти.
+struct GuestAllocatorStats {
+    size_t total_blocks = 0;
+    size_t free_blocks = 0;
+    size_t free_chunks = 0;
+    size_t largest_free_run = 0;        // в блоках
+    double external_fragmentation = 0;  // 1 - largest_free_run / free_blocks
+    size_t live_allocations = 0;
+    size_t requested_bytes = 0;         // сколько просили живые выделения
+    size_t granted_bytes = 0;           // сколько им реально отдано (ячейки слабов, куски buddy)
+    double internal_fragmentation = 0;  // 1 - requested_bytes / granted_bytes
+};
+
+/**
+ * GuestAllocator — malloc/free поверх MemoryBlock.
+ * Небольшие объекты обслуживают слаб-кэши размеров 16, 32, 64, ... байт
+ * (до половины блока); остальные выделения — BuddyAllocator целыми блоками.
+ * При блоке не степени двойки объект между наибольшим кэшем и половиной
+ * блока, а при блоке меньше 32 байт — любой объект идёт в buddy.
+ * Адреса байтовые, их можно передавать в MemoryBlock::read/write/load/store.
+ */
+class GuestAllocator {
+private:
+    static constexpr size_t kMinObjectSize = 16;
+
+    MemoryBlock& memory;
+    BuddyAllocator buddy;
+    std::vector<std::unique_ptr<SlabCache>> caches;   // caches[i]: объекты kMinObjectSize << i
+    std::unordered_map<size_t, size_t> live;          // адрес -> запрошенный размер
+    size_t requested_bytes = 0;
+    size_t granted_bytes = 0;
+
+    size_t smallLimit() const { return memory.getBlockSize() / 2; }
+
+    size_t cacheIndex(size_t bytes) const {
+        size_t index = 0;
+        size_t size = kMinObjectSize;
+        while (size < bytes) {
+            size <<= 1;
+            ++index;
+        }
+        return index;
+    }
+
+    // Есть ли слаб-кэш для объектов размера bytes.
+    bool fromSlab(size_t bytes) const { return bytes <= smallLimit() && cacheIndex(bytes) < caches.size(); }
+
+    size_t grantedFor(size_t addr, size_t bytes) const {
+        if (fromSlab(bytes)) return caches[cacheIndex(bytes)]->getObjectSize();
+        return buddy.allocationSize(addr / memory.getBlockSize()) * memory.getBlockSize();
+    }
+
+public:
+    // Управляет блоками [first_block, getTotalBlocks()); блоки ниже first_block
+    // остаются в распоряжении вызывающего (например, под загрузчик).
+    explicit GuestAllocator(MemoryBlock& memory, size_t first_block = 0)
+        : memory(memory),
+          buddy(first_block, first_block < memory.getTotalBlocks() ? memory.getTotalBlocks() - first_block : 0) {
+        for (size_t size = kMinObjectSize; size <= smallLimit(); size <<= 1) {
+            caches.push_back(std::make_unique<SlabCache>(buddy, memory.getBlockSize(), size));
+        }
+    }
+
+    // Слаб-кэши ссылаются на buddy этого объекта — копировать нельзя.
+    GuestAllocator(const GuestAllocator&) = delete;
+    GuestAllocator& operator=(const GuestAllocator&) = delete;
+
+    // Выделить bytes байт; возвращает байтовый адрес.
+    size_t allocate(size_t bytes) {
+        if (bytes == 0) {
+            throw std::invalid_argument("GuestAllocator: zero-sized allocation");
+        }
+        size_t addr;
+        if (fromSlab(bytes)) {
+            addr = caches[cacheIndex(bytes)]->allocate();
+        } else {
+            const size_t blocks = (bytes + memory.getBlockSize() - 1) / memory.getBlockSize();
+            addr = buddy.allocate(blocks) * memory.getBlockSize();
+        }
+        live[addr] = bytes;
+        requested_bytes += bytes;
+        granted_bytes += grantedFor(addr, bytes);
+        return addr;
+    }
+
+    void free(size_t addr) {
+        auto it = live.find(addr);
+        if (it == live.end()) {
+            throw std::invalid_argument("GuestAllocator: address " + std::to_string(addr) +
+                                        " was not allocated");
+        }
+        const size_t bytes = it->second;
+        requested_bytes -= bytes;
+        granted_bytes -= grantedFor(addr, bytes);
+        if (fromSlab(bytes)) {
+            caches[cacheIndex(bytes)]->free(addr);
+        } else {
+            buddy.free(addr / memory.getBlockSize());
+        }
+        live.erase(it);
+    }
+
+    // Прямое выделение целых блоков (для хост-подсистем); возвращает номер блока.
+    size_t allocateBlocks(size_t count) { return buddy.allocate(count); }
+    void freeBlocks(size_t block_id) { buddy.free(block_id); }
+
+    MemoryBlock& getMemory() { return memory; }
+    const BuddyAllocator& getBuddy() const { return buddy; }
+
+    GuestAllocatorStats getStats() const {
+        GuestAllocatorStats stats;
+        stats.total_blocks = buddy.getBlockCount();
+        stats.free_blocks = buddy.getFreeBlocks();
+        stats.free_chunks = buddy.getFreeChunks();
+        stats.largest_free_run = buddy.getLargestFreeRun();
+        stats.external_fragmentation = buddy.getExternalFragmentation();
+        stats.live_allocations = live.size();
+        stats.requested_bytes = requested_bytes;
+        stats.granted_bytes = granted_bytes;
+        stats.internal_fragmentation = granted_bytes == 0
+            ? 0.0
+            : 1.0 - static_cast<double>(requested_bytes) / static_cast<double>(granted_bytes);
+        return stats;
+    }
+};
+
+#endif // GUEST_ALLOCATOR_HPP
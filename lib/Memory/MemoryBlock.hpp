@@ -1,56 +1,827 @@
 #ifndef MEMORY_BLOCK_HPP
 #define MEMORY_BLOCK_HPP
 
+#include "Compression/LzCodec.hpp"
+#include "Memory/AtomicBitmap.hpp"
+#include "Memory/BlockView.hpp"
+#include "Memory/FrameStore.hpp"
+#include <algorithm>
+#include <atomic>
 #include <vector>
 #include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 
 /**
  * Класс MemoryBlock - блочная память
  * M = {B_0, B_1, ..., B_{n-1}}
- * где каждый блок B_i — вектор байтов фиксированного размера
+ * где каждый блок B_i — участок фиксированного размера (кадр).
+ *
+ * Режимы выделения:
+ *  - Dense:  все кадры лежат в едином выровненном буфере,
+ *            B_i = storage[i * block_size, (i + 1) * block_size);
+ *  - Sparse: кадр выделяется при первой записи в блок, а до этого блок
+ *            читается из общей нулевой страницы (zero page).
+ *
+ * Общий буфер Dense-режима можно получить через анонимный mmap
+ * (MAP_NORESERVE, ядро само лениво обнуляет страницы) и, дополнительно,
+ * на больших страницах (MAP_HUGETLB или transparent huge pages).
+ *
+ * snapshot() создаёт копию-при-записи: снимок разделяет кадры с исходной
+ * памятью (счётчик ссылок на кадр), и первая запись в разделяемый блок
+ * копирует только этот блок.
+ *
+ * Каждый путь записи отмечает блок в битовой карте изменённых (dirty)
+ * блоков — по ней строятся инкрементальные контрольные точки.
+ *
+ * enableThreadSafety() включает потокобезопасный режим: блоки делятся
+ * на полосы (stripe = block_id % stripes), у каждой полосы свой
+ * reader/writer lock в отдельной строке кэша. Читатели разных блоков
+ * не мешают друг другу; запись блокирует только свою полосу.
+ *
+ * enableCompression() разрешает уплотнение холодных блоков (compactBlock,
+ * обычно из MemoryCompactor): нулевой блок возвращается к нулевой
+ * странице, дубликат разделяет кадр с оригиналом (copy-on-write), прочие
+ * блоки сжимаются LZ-кодеком. Сжатый блок распаковывается при первом
+ * обращении.
  */
 class MemoryBlock {
+public:
+    static constexpr size_t kAlignment = FrameStore::kAlignment;
+
+    enum class Mode {
+        Dense,
+        Sparse
+    };
+
+    using Backing = MemoryBacking;
+
+    static constexpr size_t kDefaultStripes = 64;
+
+    // Результат уплотнения одного блока.
+    enum class CompactAction {
+        None,        // блок горячий, не материализован, разделяется или не сжимается
+        Zero,        // нулевой блок отдан нулевой странице
+        Duplicate,   // блок разделяет данные с совпадающим блоком
+        Compressed   // блок хранится сжатым
+    };
+
+    struct CompactResult {
+        CompactAction action = CompactAction::None;
+        size_t saved_bytes = 0;
+    };
+
+    // Индекс дубликатов: хэш содержимого -> номер блока.
+    using DedupIndex = std::unordered_map<uint64_t, size_t>;
+
 private:
-    std::vector<std::vector<uint8_t>> blocks;
+    // Полоса блокировок; выравнивание исключает ложное разделение строк кэша.
+    struct alignas(64) Stripe {
+        std::shared_mutex lock;
+        std::atomic<size_t> contentions{0};
+    };
+
+    // Захват полосы: сначала try_lock, при неудаче — учёт конфликта и ожидание.
+    // Без потокобезопасного режима (stripe == nullptr) ничего не делает.
+    class StripeGuard {
+    private:
+        Stripe* stripe;
+        bool exclusive;
+
+    public:
+        StripeGuard(Stripe* stripe, bool exclusive) : stripe(stripe), exclusive(exclusive) {
+            if (!stripe) return;
+            if (exclusive) {
+                if (!stripe->lock.try_lock()) {
+                    stripe->contentions.fetch_add(1, std::memory_order_relaxed);
+                    stripe->lock.lock();
+                }
+            } else if (!stripe->lock.try_lock_shared()) {
+                stripe->contentions.fetch_add(1, std::memory_order_relaxed);
+                stripe->lock.lock_shared();
+            }
+        }
+
+        ~StripeGuard() {
+            if (!stripe) return;
+            if (exclusive) {
+                stripe->lock.unlock();
+            } else {
+                stripe->lock.unlock_shared();
+            }
+        }
+
+        StripeGuard(const StripeGuard&) = delete;
+        StripeGuard& operator=(const StripeGuard&) = delete;
+    };
+
     size_t block_size;
     size_t total_blocks;
+    Mode mode;
 
-public:
-    MemoryBlock(size_t blocks_count, size_t block_size)
-        : total_blocks(blocks_count), block_size(block_size) {
-        blocks.resize(blocks_count, std::vector<uint8_t>(block_size, 0));
-    }
+    std::shared_ptr<FrameStore> frame_store;  // общий с снимками владелец кадров
+    std::vector<FrameSlot> frames;            // frames[i].data == nullptr — блок не материализован
+    std::atomic<size_t> resident_blocks{0};
+    std::atomic<size_t> cow_copies{0};
+    AtomicBitmap dirty;                       // блоки, изменённые с последней очистки
 
-    std::vector<uint8_t> readBlock(size_t block_id) {
+    std::unique_ptr<Stripe[]> stripes;        // nullptr — потокобезопасный режим выключен
+    size_t stripe_count = 0;
+
+    // Сжатые блоки: packed[i] != nullptr, frames[i].data == nullptr.
+    // Сжатые данные неизменяемы и разделяются снимками и дубликатами.
+    // Пустой вектор — уплотнение не включено.
+    using PackedData = std::shared_ptr<const std::vector<uint8_t>>;
+    std::vector<PackedData> packed;
+    std::atomic<size_t> packed_blocks{0};
+    std::atomic<size_t> packed_bytes{0};
+    mutable AtomicBitmap accessed;            // обращения с прошлого прохода уплотнителя
+
+    // Пока Dense-память не разделяется со снимками и не включены
+    // потокобезопасный режим и уплотнение, frames[i] лежат подряд
+    // начиная с flat — байтовые операции идут одним memcpy.
+    uint8_t* flat = nullptr;
+
+    struct SnapshotTag {};
+
+    void checkBlockId(size_t block_id) const {
         if (block_id >= total_blocks) {
             throw std::out_of_range("Invalid block_id: " + std::to_string(block_id));
         }
-        return blocks[block_id];
     }
 
-    void writeBlock(size_t block_id, const std::vector<uint8_t>& data) {
-        if (block_id >= total_blocks) {
-            throw std::out_of_range("Invalid block_id: " + std::to_string(block_id));
+    void checkRange(size_t addr, size_t len) const {
+        const size_t capacity = getCapacity();
+        if (addr > capacity || len > capacity - addr) {
+            throw std::out_of_range("Invalid address range: [" + std::to_string(addr) +
+                                    ", +" + std::to_string(len) + ")");
+        }
+    }
+
+    Stripe* stripeFor(size_t block_id) const {
+        return stripes ? &stripes[block_id % stripe_count] : nullptr;
+    }
+
+    bool isPackedAt(size_t block_id) const {
+        return !packed.empty() && packed[block_id] != nullptr;
+    }
+
+    void touch(size_t block_id) const {
+        if (!packed.empty()) accessed.set(block_id);
+    }
+
+    // Распаковать сжатый блок в новый кадр. Содержимое памяти не меняется,
+    // поэтому вызывается и из const-методов (под исключительной блокировкой
+    // полосы в потокобезопасном режиме).
+    void unpack(size_t block_id) const {
+        if (!isPackedAt(block_id)) return;
+        MemoryBlock& self = const_cast<MemoryBlock&>(*this);
+        PackedData data = std::move(self.packed[block_id]);
+        FrameSlot frame = frame_store->allocate(false);
+        lz::decompress(data->data(), data->size(), frame.data, block_size);
+        self.frames[block_id] = frame;
+        self.resident_blocks.fetch_add(1, std::memory_order_relaxed);
+        self.packed_blocks.fetch_sub(1, std::memory_order_relaxed);
+        self.packed_bytes.fetch_sub(data->size(), std::memory_order_relaxed);
+    }
+
+    // Чтение кадра блока: fn(const uint8_t*). Сжатый блок распаковывается
+    // под исключительной блокировкой, остальные читаются под разделяемой.
+    template <typename Fn>
+    auto withReadFrame(size_t block_id, Fn&& fn) const {
+        touch(block_id);
+        {
+            StripeGuard guard(stripeFor(block_id), false);
+            if (!isPackedAt(block_id)) return fn(frameForRead(block_id));
+        }
+        StripeGuard guard(stripeFor(block_id), true);
+        unpack(block_id);
+        return fn(frameForRead(block_id));
+    }
+
+    void storePacked(size_t block_id, PackedData data) {
+        packed_blocks.fetch_add(1, std::memory_order_relaxed);
+        packed_bytes.fetch_add(data->size(), std::memory_order_relaxed);
+        packed[block_id] = std::move(data);
+    }
+
+    void dropFrame(size_t block_id) {
+        frame_store->release(frames[block_id]);
+        frames[block_id] = FrameSlot{};
+        resident_blocks.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    static bool isZeroBlock(const uint8_t* p, size_t n) {
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= n; i += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, p + i, sizeof(word));
+            if (word) return false;
+        }
+        for (; i < n; ++i) {
+            if (p[i]) return false;
+        }
+        return true;
+    }
+
+    // 64-битный хэш содержимого для поиска дубликатов (совпадение
+    // всегда перепроверяется сравнением данных).
+    static uint64_t contentHash(const uint8_t* p, size_t n) {
+        uint64_t h = 0x9E3779B97F4A7C15ull ^ n;
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= n; i += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, p + i, sizeof(word));
+            h = (h ^ word) * 0xFF51AFD7ED558CCDull;
+            h ^= h >> 32;
+        }
+        for (; i < n; ++i) h = (h ^ p[i]) * 0x100000001B3ull;
+        return h;
+    }
+
+    const uint8_t* frameForRead(size_t block_id) const {
+        const uint8_t* frame = frames[block_id].data;
+        return frame ? frame : frame_store->zeroPage();
+    }
+
+    // Кадр для записи: нетронутый блок материализуется при первом обращении,
+    // а кадр, разделяемый со снимком, сначала копируется (copy-on-write).
+    // В потокобезопасном режиме вызывается под исключительной блокировкой полосы.
+    // Отметку в dirty ставит вызывающий — уже после записи данных, чтобы
+    // параллельный drainDirtyBlocks() не сбросил её до окончания записи.
+    uint8_t* frameForWrite(size_t block_id) {
+        touch(block_id);
+        unpack(block_id);
+        FrameSlot& frame = frames[block_id];
+        if (!frame.data) {
+            frame = frame_store->allocate();
+            resident_blocks.fetch_add(1, std::memory_order_relaxed);
+        } else if (frame.refs->load(std::memory_order_acquire) > 1) {
+            FrameSlot copy = frame_store->allocate(false);
+            std::memcpy(copy.data, frame.data, block_size);
+            frame_store->release(frame);
+            frame = copy;
+            cow_copies.fetch_add(1, std::memory_order_relaxed);
         }
+        return frame.data;
+    }
+
+    void markDirtyRange(size_t addr, size_t len) {
+        const size_t first = addr / block_size;
+        dirty.setRange(first, (addr + len - 1) / block_size - first + 1);
+    }
+
+    void initFrames(Backing backing, uint8_t* external = nullptr) {
+        if (block_size != 0 && total_blocks > SIZE_MAX / block_size) {
+            throw std::invalid_argument("Memory size overflow: " + std::to_string(total_blocks) +
+                                        " x " + std::to_string(block_size));
+        }
+        if (mode == Mode::Sparse && backing != Backing::Heap) {
+            throw std::invalid_argument("Sparse memory does not support mmap backing");
+        }
+        if ((backing == Backing::External) != (external != nullptr)) {
+            throw std::invalid_argument("External backing requires an external buffer");
+        }
+        frame_store = std::make_shared<FrameStore>(block_size, backing);
+        frames.assign(total_blocks, FrameSlot{});
+        dirty = AtomicBitmap(total_blocks);
+        if (external) {
+            frame_store->attachDense(external, total_blocks, frames);
+            flat = external;
+            resident_blocks = total_blocks;
+        } else if (mode == Mode::Dense) {
+            frame_store->allocateDense(total_blocks, frames);
+            flat = frame_store->denseBase();
+            resident_blocks = total_blocks;
+        }
+    }
+
+    void releaseFrames() {
+        // Единственный владелец хранилища освобождает его целиком.
+        if (frame_store && frame_store.use_count() > 1) {
+            for (const FrameSlot& frame : frames) {
+                if (frame.data) frame_store->release(frame);
+            }
+        }
+        frames.clear();
+        frame_store.reset();
+        resident_blocks = 0;
+        flat = nullptr;
+    }
+
+    MemoryBlock(const MemoryBlock& source, SnapshotTag)
+        : block_size(source.block_size), total_blocks(source.total_blocks), mode(source.mode),
+          frame_store(source.frame_store), frames(source.frames),
+          resident_blocks(source.resident_blocks.load()), dirty(source.total_blocks) {
+        for (const FrameSlot& frame : frames) {
+            if (frame.data) frame_store->retain(frame);
+        }
+        if (source.stripes) enableThreadSafety(source.stripe_count);
+        if (!source.packed.empty()) {
+            enableCompression();
+            packed = source.packed;
+            packed_blocks = source.packed_blocks.load();
+            packed_bytes = source.packed_bytes.load();
+        }
+    }
+
+    // Обход диапазона [addr, addr + len) по кускам в пределах одного блока.
+    template <typename Fn>
+    void forEachPiece(size_t addr, size_t len, Fn&& fn) const {
+        size_t done = 0;
+        while (done < len) {
+            const size_t block_id = (addr + done) / block_size;
+            const size_t offset = (addr + done) % block_size;
+            const size_t n = std::min(block_size - offset, len - done);
+            fn(block_id, offset, done, n);
+            done += n;
+        }
+    }
+
+public:
+    MemoryBlock(size_t blocks_count, size_t block_size,
+                Mode mode = Mode::Dense, Backing backing = Backing::Heap)
+        : block_size(block_size), total_blocks(blocks_count), mode(mode) {
+        initFrames(backing);
+    }
+
+    // Dense-память поверх внешнего буфера из blocks_count * block_size байт
+    // (например, MAP_SHARED-отображения образа диска): записи сразу попадают
+    // в буфер. Буфер не принадлежит MemoryBlock и должен его пережить.
+    // Снимки и уплотнение для такой памяти недоступны — данные должны
+    // оставаться на своих местах в буфере.
+    MemoryBlock(size_t blocks_count, size_t block_size, uint8_t* external)
+        : block_size(block_size), total_blocks(blocks_count), mode(Mode::Dense) {
+        initFrames(Backing::External, external);
+    }
+
+    // Копирование — полная (глубокая) копия данных.
+    // Для дешёвого клонирования используйте snapshot().
+    MemoryBlock(const MemoryBlock& other)
+        : block_size(other.block_size), total_blocks(other.total_blocks), mode(other.mode) {
+        // Копия внешнего буфера живёт в собственной памяти.
+        initFrames(other.getBacking() == Backing::External ? Backing::Heap : other.getBacking());
+        if (other.stripes) enableThreadSafety(other.stripe_count);
+        if (!other.packed.empty()) enableCompression();
+        for (size_t i = 0; i < total_blocks; ++i) {
+            if (other.frames[i].data) {
+                std::memcpy(frameForWrite(i), other.frames[i].data, block_size);
+            } else if (other.isPackedAt(i)) {
+                if (frames[i].data) dropFrame(i);  // Dense: кадр не нужен, блок остаётся сжатым
+                storePacked(i, other.packed[i]);
+            }
+        }
+        dirty = other.dirty;
+    }
+
+    // Копирование, перемещение и присваивание не синхронизированы: объекты
+    // не должны в это время использоваться другими потоками.
+    MemoryBlock(MemoryBlock&& other) noexcept
+        : block_size(other.block_size), total_blocks(other.total_blocks), mode(other.mode),
+          frame_store(std::move(other.frame_store)), frames(std::move(other.frames)),
+          resident_blocks(other.resident_blocks.load()), cow_copies(other.cow_copies.load()),
+          dirty(std::move(other.dirty)), stripes(std::move(other.stripes)),
+          stripe_count(other.stripe_count), packed(std::move(other.packed)),
+          packed_blocks(other.packed_blocks.load()), packed_bytes(other.packed_bytes.load()),
+          accessed(std::move(other.accessed)), flat(other.flat) {
+        other.frames.clear();
+        other.packed.clear();
+        other.total_blocks = 0;
+        other.resident_blocks = 0;
+        other.stripe_count = 0;
+        other.flat = nullptr;
+    }
+
+    MemoryBlock& operator=(MemoryBlock other) noexcept {
+        std::swap(block_size, other.block_size);
+        std::swap(total_blocks, other.total_blocks);
+        std::swap(mode, other.mode);
+        std::swap(frame_store, other.frame_store);
+        std::swap(frames, other.frames);
+        resident_blocks = other.resident_blocks.exchange(resident_blocks.load());
+        cow_copies = other.cow_copies.exchange(cow_copies.load());
+        std::swap(dirty, other.dirty);
+        std::swap(stripes, other.stripes);
+        std::swap(stripe_count, other.stripe_count);
+        std::swap(packed, other.packed);
+        packed_blocks = other.packed_blocks.exchange(packed_blocks.load());
+        packed_bytes = other.packed_bytes.exchange(packed_bytes.load());
+        std::swap(accessed, other.accessed);
+        std::swap(flat, other.flat);
+        return *this;
+    }
+
+    ~MemoryBlock() { releaseFrames(); }
+
+    // Включить потокобезопасный режим с заданным числом полос.
+    // Вызывается до того, как память станет доступна другим потокам.
+    // Под блокировками идут readBlock/writeBlock/read/write/fill/copy/
+    // load/store, withBlockRead/withBlockWrite и snapshot(); атомарность
+    // гарантируется в пределах одного блока. Представления viewBlock()/
+    // mutableBlock() блокировками не защищены — для совместного доступа
+    // используйте withBlockRead()/withBlockWrite().
+    void enableThreadSafety(size_t stripe_count = kDefaultStripes) {
+        if (stripe_count == 0) {
+            throw std::invalid_argument("Stripe count must be positive");
+        }
+        stripes.reset(new Stripe[stripe_count]);
+        this->stripe_count = stripe_count;
+        flat = nullptr;
+    }
+
+    bool isThreadSafe() const { return stripes != nullptr; }
+    size_t getStripeCount() const { return stripe_count; }
+
+    // Сколько раз захват полосы не удался сразу и поток ждал.
+    size_t getLockContentions() const {
+        size_t total = 0;
+        for (size_t i = 0; i < stripe_count; ++i) {
+            total += stripes[i].contentions.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    void resetLockContentions() {
+        for (size_t i = 0; i < stripe_count; ++i) {
+            stripes[i].contentions.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Разрешить уплотнение блоков. Вызывается до того, как память станет
+    // доступна другим потокам; отключает путь через единый буфер.
+    void enableCompression() {
+        if (!packed.empty()) return;
+        if (getBacking() == Backing::External) {
+            throw std::runtime_error("Compression is not supported for externally backed memory");
+        }
+        packed.assign(total_blocks, nullptr);
+        accessed = AtomicBitmap(total_blocks);
+        flat = nullptr;
+    }
+
+    bool isCompressionEnabled() const { return !packed.empty(); }
+
+    bool isCompressed(size_t block_id) const {
+        checkBlockId(block_id);
+        return isPackedAt(block_id);
+    }
+    size_t getCompressedBlocks() const { return packed_blocks.load(std::memory_order_relaxed); }
+    size_t getCompressedBytes() const { return packed_bytes.load(std::memory_order_relaxed); }
+
+    // Было ли обращение к блоку с прошлого вызова (бит при этом сбрасывается).
+    // Уплотнитель считает холодными блоки без обращений за целый проход.
+    bool testAndClearAccessed(size_t block_id) {
+        checkBlockId(block_id);
+        return !packed.empty() && accessed.testAndReset(block_id);
+    }
+
+    // Уплотнить один блок: нулевой — отдать нулевой странице; совпадающий
+    // с блоком из index — разделить с ним данные; иначе сжать, если это
+    // экономит хотя бы четверть блока. Разделяемые со снимками блоки
+    // не трогаются. Сначала блок проверяется под разделяемой блокировкой,
+    // изменение — под исключительной с повторной проверкой.
+    CompactResult compactBlock(size_t block_id, DedupIndex* index = nullptr) {
+        checkBlockId(block_id);
+        if (packed.empty()) {
+            throw std::runtime_error("Compression is not enabled for this memory");
+        }
+        bool zero = false;
+        uint64_t hash = 0;
+        {
+            StripeGuard guard(stripeFor(block_id), false);
+            const FrameSlot& frame = frames[block_id];
+            if (!frame.data || frame.refs->load(std::memory_order_acquire) > 1) {
+                return CompactResult{};
+            }
+            zero = isZeroBlock(frame.data, block_size);
+            if (!zero) hash = contentHash(frame.data, block_size);
+        }
+
+        if (zero) {
+            StripeGuard guard(stripeFor(block_id), true);
+            const FrameSlot& frame = frames[block_id];
+            if (!frame.data || frame.refs->load(std::memory_order_acquire) > 1 ||
+                !isZeroBlock(frame.data, block_size)) {
+                return CompactResult{};
+            }
+            dropFrame(block_id);
+            return CompactResult{CompactAction::Zero, block_size};
+        }
+
+        std::optional<size_t> candidate;
+        if (index) {
+            auto it = index->find(hash);
+            if (it == index->end()) {
+                index->emplace(hash, block_id);
+            } else if (it->second != block_id) {
+                candidate = it->second;
+            }
+        }
+
+        // Полосы двух блоков захватываются по возрастанию индекса.
+        std::optional<StripeGuard> first_guard;
+        std::optional<StripeGuard> second_guard;
+        Stripe* own = stripeFor(block_id);
+        Stripe* other = candidate ? stripeFor(*candidate) : nullptr;
+        if (other && other != own && other < own) std::swap(own, other);
+        first_guard.emplace(own, true);
+        if (other && other != own) second_guard.emplace(other, true);
+
+        FrameSlot& frame = frames[block_id];
+        if (!frame.data || frame.refs->load(std::memory_order_acquire) > 1) {
+            return CompactResult{};
+        }
+        std::vector<uint8_t> compressed;
+        if (candidate) {
+            const FrameSlot& original = frames[*candidate];
+            if (original.data && std::memcmp(original.data, frame.data, block_size) == 0) {
+                frame_store->release(frame);
+                frame = original;
+                frame_store->retain(frame);
+                return CompactResult{CompactAction::Duplicate, block_size};
+            }
+            if (isPackedAt(*candidate)) {
+                // Оригинал уже сжат: кодек детерминирован, поэтому равные
+                // сжатые данные означают равное содержимое.
+                compressed = lz::compress(frame.data, block_size);
+                if (compressed == *packed[*candidate]) {
+                    dropFrame(block_id);
+                    storePacked(block_id, packed[*candidate]);
+                    return CompactResult{CompactAction::Duplicate, block_size};
+                }
+            }
+        }
+        if (compressed.empty()) compressed = lz::compress(frame.data, block_size);
+        if (compressed.size() > block_size - block_size / 4) return CompactResult{};
+        const size_t saved = block_size - compressed.size();
+        dropFrame(block_id);
+        storePacked(block_id, std::make_shared<const std::vector<uint8_t>>(std::move(compressed)));
+        return CompactResult{CompactAction::Compressed, saved};
+    }
+
+    // Снимок с копированием при записи: O(число блоков) работы с указателями,
+    // данные не копируются. Исходная память и снимок независимы по содержимому.
+    // Битовая карта изменённых блоков у снимка начинается чистой.
+    // В потокобезопасном режиме на время снимка захватываются все полосы
+    // (по порядку индексов), так что снимок согласован поблочно.
+    MemoryBlock snapshot() {
+        if (getBacking() == Backing::External) {
+            throw std::runtime_error("Snapshots are not supported for externally backed memory");
+        }
+        std::vector<std::unique_ptr<StripeGuard>> guards;
+        guards.reserve(stripe_count);
+        for (size_t i = 0; i < stripe_count; ++i) {
+            guards.emplace_back(new StripeGuard(&stripes[i], true));
+        }
+        MemoryBlock clone(*this, SnapshotTag{});
+        flat = nullptr;
+        return clone;
+    }
+
+    // Копирующий API (совместимость): возвращает копию блока.
+    std::vector<uint8_t> readBlock(size_t block_id) {
+        checkBlockId(block_id);
+        return withReadFrame(block_id, [&](const uint8_t* p) {
+            return std::vector<uint8_t>(p, p + block_size);
+        });
+    }
+
+    void writeBlock(size_t block_id, const std::vector<uint8_t>& data) {
+        checkBlockId(block_id);
         if (data.size() != block_size) {
-            throw std::invalid_argument("Invalid data size: expected " + 
-                                      std::to_string(block_size) + ", got " + 
+            throw std::invalid_argument("Invalid data size: expected " +
+                                      std::to_string(block_size) + ", got " +
                                       std::to_string(data.size()));
         }
-        blocks[block_id] = data;
+        StripeGuard guard(stripeFor(block_id), true);
+        std::memcpy(frameForWrite(block_id), data.data(), block_size);
+        dirty.set(block_id);
+    }
+
+    // Zero-copy доступ: представление кадра блока без копирования.
+    // Нетронутый Sparse-блок отдаётся как представление нулевой страницы,
+    // сжатый блок предварительно распаковывается.
+    // Представление действительно, пока жив объект MemoryBlock.
+    BlockView viewBlock(size_t block_id) const {
+        checkBlockId(block_id);
+        touch(block_id);
+        unpack(block_id);
+        return BlockView(frameForRead(block_id), block_size);
+    }
+
+    // Изменяемое представление; в Sparse-режиме материализует блок.
+    MutableBlockView mutableBlock(size_t block_id) {
+        checkBlockId(block_id);
+        uint8_t* frame = frameForWrite(block_id);
+        dirty.set(block_id);
+        return MutableBlockView(frame, block_size);
+    }
+
+    // Доступ к блоку под блокировкой его полосы: fn(BlockView) / fn(MutableBlockView).
+    // Представление нельзя сохранять после возврата из fn.
+    template <typename Fn>
+    auto withBlockRead(size_t block_id, Fn&& fn) const {
+        checkBlockId(block_id);
+        return withReadFrame(block_id, [&](const uint8_t* frame) {
+            return fn(BlockView(frame, block_size));
+        });
+    }
+
+    template <typename Fn>
+    auto withBlockWrite(size_t block_id, Fn&& fn) {
+        checkBlockId(block_id);
+        StripeGuard guard(stripeFor(block_id), true);
+        struct MarkDirty {
+            AtomicBitmap& dirty;
+            size_t block_id;
+            ~MarkDirty() { dirty.set(block_id); }
+        } mark{dirty, block_id};
+        return fn(MutableBlockView(frameForWrite(block_id), block_size));
+    }
+
+    // Байтовая адресация: addr = block_id * block_size + offset.
+    // Диапазоны могут пересекать границы блоков. Пока Dense-память не
+    // разделяется со снимками, копирование идёт одним memcpy/memset по
+    // общему буферу (векторизованная реализация libc), иначе — по блокам.
+    void read(size_t addr, void* dst, size_t len) const {
+        checkRange(addr, len);
+        if (len == 0) return;
+        if (flat) {
+            std::memcpy(dst, flat + addr, len);
+            return;
+        }
+        uint8_t* out = static_cast<uint8_t*>(dst);
+        forEachPiece(addr, len, [&](size_t block_id, size_t offset, size_t done, size_t n) {
+            withReadFrame(block_id, [&](const uint8_t* frame) {
+                std::memcpy(out + done, frame + offset, n);
+            });
+        });
+    }
+
+    void write(size_t addr, const void* src, size_t len) {
+        checkRange(addr, len);
+        if (len == 0) return;
+        if (flat) {
+            std::memcpy(flat + addr, src, len);
+            markDirtyRange(addr, len);
+            return;
+        }
+        const uint8_t* in = static_cast<const uint8_t*>(src);
+        forEachPiece(addr, len, [&](size_t block_id, size_t offset, size_t done, size_t n) {
+            StripeGuard guard(stripeFor(block_id), true);
+            std::memcpy(frameForWrite(block_id) + offset, in + done, n);
+            dirty.set(block_id);
+        });
+    }
+
+    void fill(size_t addr, uint8_t value, size_t len) {
+        checkRange(addr, len);
+        if (len == 0) return;
+        if (flat) {
+            std::memset(flat + addr, value, len);
+            markDirtyRange(addr, len);
+            return;
+        }
+        forEachPiece(addr, len, [&](size_t block_id, size_t offset, size_t, size_t n) {
+            StripeGuard guard(stripeFor(block_id), true);
+            // Обнуление нетронутого блока ничего не меняет — не материализуем его.
+            if (value == 0 && !frames[block_id].data && !isPackedAt(block_id)) return;
+            std::memset(frameForWrite(block_id) + offset, value, n);
+            dirty.set(block_id);
+        });
+    }
+
+    // Копирование внутри памяти; диапазоны могут перекрываться.
+    void copy(size_t dst_addr, size_t src_addr, size_t len) {
+        checkRange(dst_addr, len);
+        checkRange(src_addr, len);
+        if (len == 0 || dst_addr == src_addr) return;
+        if (flat) {
+            std::memmove(flat + dst_addr, flat + src_addr, len);
+            markDirtyRange(dst_addr, len);
+            return;
+        }
+        if (stripes) {
+            // Через промежуточный буфер: одновременный захват полос источника
+            // и приёмника в разном порядке мог бы привести к взаимоблокировке.
+            std::vector<uint8_t> buffer(len);
+            read(src_addr, buffer.data(), len);
+            write(dst_addr, buffer.data(), len);
+            return;
+        }
+        // Куски ограничены границами блоков и источника, и приёмника.
+        // При dst > src идём с конца, чтобы не затереть ещё не скопированное.
+        const bool backward = dst_addr > src_addr && dst_addr < src_addr + len;
+        size_t done = 0;
+        while (done < len) {
+            size_t n;
+            size_t s, d;
+            if (!backward) {
+                s = src_addr + done;
+                d = dst_addr + done;
+                n = std::min({len - done, block_size - s % block_size, block_size - d % block_size});
+            } else {
+                const size_t s_end = src_addr + len - done;
+                const size_t d_end = dst_addr + len - done;
+                const size_t s_in = (s_end - 1) % block_size + 1;
+                const size_t d_in = (d_end - 1) % block_size + 1;
+                n = std::min({len - done, s_in, d_in});
+                s = s_end - n;
+                d = d_end - n;
+            }
+            unpack(s / block_size);
+            touch(s / block_size);
+            const uint8_t* from = frameForRead(s / block_size) + s % block_size;
+            std::memmove(frameForWrite(d / block_size) + d % block_size, from, n);
+            dirty.set(d / block_size);
+            done += n;
+        }
+    }
+
+    // Чтение/запись скалярного значения (для LOAD/STORE гостевых программ).
+    template <typename T>
+    T load(size_t addr) const {
+        static_assert(std::is_trivially_copyable<T>::value, "load<T> requires a trivially copyable type");
+        T value;
+        read(addr, &value, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    void store(size_t addr, const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "store<T> requires a trivially copyable type");
+        write(addr, &value, sizeof(T));
     }
 
     size_t getBlockSize() const { return block_size; }
     size_t getTotalBlocks() const { return total_blocks; }
+    size_t getCapacity() const { return total_blocks * block_size; }
+    Mode getMode() const { return mode; }
+    Backing getBacking() const { return frame_store ? frame_store->getBacking() : Backing::Heap; }
+    // Размер страницы, реально полученный для буфера (4 KiB, 2 MiB, ...).
+    size_t getPageSize() const { return frame_store ? frame_store->getPageSize() : 0; }
+
+    // Число блоков, под которые реально выделены кадры.
+    size_t getResidentBlocks() const { return resident_blocks.load(std::memory_order_relaxed); }
+    bool isResident(size_t block_id) const {
+        checkBlockId(block_id);
+        return frames[block_id].data != nullptr;
+    }
+
+    // Блоки, кадры которых сейчас разделяются со снимками (или исходной памятью),
+    // и блоки с собственными кадрами. Подсчёт — проход по таблице кадров.
+    size_t getSharedBlocks() const {
+        size_t shared = 0;
+        for (const FrameSlot& frame : frames) {
+            if (frame.data && frame.refs->load(std::memory_order_relaxed) > 1) ++shared;
+        }
+        return shared;
+    }
+    size_t getPrivateBlocks() const { return getResidentBlocks() - getSharedBlocks(); }
+
+    // Сколько раз запись в разделяемый блок привела к его копированию.
+    size_t getCowCopies() const { return cow_copies.load(std::memory_order_relaxed); }
+
+    // Изменённые (dirty) блоки. Отмечаются writeBlock/write/fill/copy/store,
+    // а также mutableBlock — выдача изменяемого представления считается записью.
+    bool isDirty(size_t block_id) const {
+        checkBlockId(block_id);
+        return dirty.test(block_id);
+    }
+    size_t getDirtyCount() const { return dirty.count(); }
+
+    // Обход изменённых блоков по возрастанию номера: fn(block_id).
+    template <typename Fn>
+    void forEachDirtyBlock(Fn&& fn) const { dirty.forEachSet(std::forward<Fn>(fn)); }
+
+    std::vector<size_t> getDirtyBlocks() const {
+        std::vector<size_t> result;
+        dirty.forEachSet([&](size_t block_id) { result.push_back(block_id); });
+        return result;
+    }
+
+    // Забрать изменённые блоки и сбросить их отметки за один проход
+    // (шаг pre-copy: блоки, изменённые во время обхода, попадут в следующий).
+    template <typename Fn>
+    void drainDirtyBlocks(Fn&& fn) { dirty.drain(std::forward<Fn>(fn)); }
+
+    void clearDirty() { dirty.clear(); }
+    void clearDirty(size_t first_block, size_t count) { dirty.resetRange(first_block, count); }
+    void markDirty(size_t first_block, size_t count) { dirty.setRange(first_block, count); }
 
     // Простая проверка исправности (self-test).
     // В реальной системе здесь мог бы быть тест чтения/записи блоков.
     bool selfTest() const {
-        return total_blocks > 0 && block_size > 0 && blocks.size() == total_blocks;
+        return total_blocks > 0 && block_size > 0 && frame_store != nullptr &&
+               frames.size() == total_blocks;
     }
 };
 
 #endif // MEMORY_BLOCK_HPP
-
@@ -0,0 +1,161 @@
+#ifndef MEMORY_COMPACTOR_HPP
+#define MEMORY_COMPACTOR_HPP
+
+#include "Memory/MemoryBlock.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+struct CompactorStats {
+    size_t passes = 0;             // полных обходов памяти
+    size_t scanned_blocks = 0;
+    size_t zero_blocks = 0;
+    size_t duplicate_blocks = 0;
+    size_t compressed_blocks = 0;
+    size_t bytes_saved = 0;        // сэкономлено в момент уплотнения (без учёта последующих распаковок)
+};
+
+/**
+ * MemoryCompactor — уплотнитель холодных блоков MemoryBlock.
+ * Обходит блоки по кругу (алгоритм «часы»): блок, к которому обращались
+ * с прошлого обхода, получает второй шанс, остальные уплотняются через
+ * MemoryBlock::compactBlock. Индекс дубликатов живёт один полный обход.
+ *
+ * Работа ограничена бюджетом процессорного времени: runSlice(budget)
+ * останавливается, как только бюджет исчерпан. Фоновый режим (start)
+ * выполняет срез раз в interval, т.е. занимает не больше budget/interval
+ * одного ядра и не останавливает интерпретатор надолго.
+ */
+class MemoryCompactor {
+private:
+    static constexpr size_t kClockCheckInterval = 16;  // блоков между проверками времени
+
+    MemoryBlock& memory;
+    MemoryBlock::DedupIndex index;
+    size_t cursor = 0;
+    CompactorStats stats;
+
+    std::mutex mutex;  // stats, cursor, index; потоки — через running/wake
+    std::condition_variable wake;
+    bool running = false;
+    std::thread worker;
+
+    void account(const MemoryBlock::CompactResult& result) {
+        switch (result.action) {
+        case MemoryBlock::CompactAction::Zero:
+            ++stats.zero_blocks;
+            break;
+        case MemoryBlock::CompactAction::Duplicate:
+            ++stats.duplicate_blocks;
+            break;
+        case MemoryBlock::CompactAction::Compressed:
+            ++stats.compressed_blocks;
+            break;
+        case MemoryBlock::CompactAction::None:
+            break;
+        }
+        stats.bytes_saved += result.saved_bytes;
+    }
+
+    // Обработать следующий блок; true — обход памяти завершён.
+    bool step() {
+        const size_t block_id = cursor;
+        ++stats.scanned_blocks;
+        if (!memory.testAndClearAccessed(block_id)) {
+            account(memory.compactBlock(block_id, &index));
+        }
+        if (++cursor < memory.getTotalBlocks()) return false;
+        cursor = 0;
+        index.clear();
+        ++stats.passes;
+        return true;
+    }
+
+public:
+    explicit MemoryCompactor(MemoryBlock& memory) : memory(memory) {
+        memory.enableCompression();
+    }
+
+    MemoryCompactor(const MemoryCompactor&) = delete;
+    MemoryCompactor& operator=(const MemoryCompactor&) = delete;
+
+    ~MemoryCompactor() { stop(); }
+
+    // Обработать не больше max_blocks блоков (детерминированный шаг).
+    size_t runBlocks(size_t max_blocks) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const size_t count = std::min(max_blocks, memory.getTotalBlocks());
+        for (size_t i = 0; i < count; ++i) step();
+        return count;
+    }
+
+    // Полный обход памяти от текущей позиции.
+    void runPass() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < memory.getTotalBlocks(); ++i) {
+            if (step()) break;
+        }
+    }
+
+    // Работать, пока не исчерпан бюджет времени (не больше одного обхода).
+    // Возвращает число обработанных блоков.
+    size_t runSlice(std::chrono::microseconds budget) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto deadline = std::chrono::steady_clock::now() + budget;
+        size_t processed = 0;
+        while (processed < memory.getTotalBlocks()) {
+            ++processed;
+            if (step()) break;
+            if (processed % kClockCheckInterval == 0 &&
+                std::chrono::steady_clock::now() >= deadline) {
+                break;
+            }
+        }
+        return processed;
+    }
+
+    // Фоновое уплотнение: срез budget раз в interval. Память должна быть
+    // в потокобезопасном режиме — её одновременно использует CPU.
+    void start(std::chrono::milliseconds interval, std::chrono::microseconds budget) {
+        if (!memory.isThreadSafe()) {
+            throw std::runtime_error("Background compaction requires thread-safe memory");
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (running) return;
+        running = true;
+        worker = std::thread([this, interval, budget] {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (running) {
+                lock.unlock();
+                runSlice(budget);
+                lock.lock();
+                wake.wait_for(lock, interval, [this] { return !running; });
+            }
+        });
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        wake.notify_all();
+        if (worker.joinable()) worker.join();
+    }
+
+    bool isRunning() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return running;
+    }
+
+    CompactorStats getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+};
+
+#endif // MEMORY_COMPACTOR_HPP
@@ -0,0 +1,292 @@
+#ifndef VIRTUAL_MEMORY_HPP
+#define VIRTUAL_MEMORY_HPP
+
+#include "Memory/MemoryBlock.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Виртуальная память: страница = блок MemoryBlock.
+// vaddr = vpn * page_size + offset  ->  paddr = frame * page_size + offset
+
+enum class Access {
+    Read,
+    Write
+};
+
+struct PageTableEntry {
+    size_t frame = 0;        // номер блока в MemoryBlock
+    bool present = false;
+    bool writable = false;
+    bool accessed = false;
+    bool dirty = false;
+};
+
+// Необработанный страничный сбой.
+class PageFault : public std::runtime_error {
+private:
+    size_t address;
+    Access access;
+
+public:
+    PageFault(size_t vaddr, Access access)
+        : std::runtime_error("Page fault at address " + std::to_string(vaddr) +
+                             (access == Access::Write ? " (write)" : " (read)")),
+          address(vaddr), access(access) {}
+
+    size_t getAddress() const { return address; }
+    Access getAccess() const { return access; }
+};
+
+/**
+ * AddressSpace — адресное пространство процесса.
+ * Таблица страниц двухуровневая: каталог указывает на листовые таблицы
+ * по kLeafSize записей, которые создаются при первом отображении.
+ * asid различает пространства в общих TLB; generation растёт при
+ * отмене/сужении отображений и делает устаревшие записи TLB недействительными.
+ */
+class AddressSpace {
+public:
+    static constexpr size_t kLeafBits = 9;
+    static constexpr size_t kLeafSize = size_t(1) << kLeafBits;
+
+private:
+    uint32_t asid;
+    size_t virtual_pages;
+    std::vector<std::unique_ptr<PageTableEntry[]>> directory;
+    uint64_t generation = 0;
+    size_t mapped_pages = 0;
+
+    void checkPage(size_t vpn) const {
+        if (vpn >= virtual_pages) {
+            throw std::out_of_range("Virtual page out of range: " + std::to_string(vpn));
+        }
+    }
+
+public:
+    AddressSpace(uint32_t asid, size_t virtual_pages)
+        : asid(asid), virtual_pages(virtual_pages),
+          directory((virtual_pages + kLeafSize - 1) / kLeafSize) {}
+
+    AddressSpace(const AddressSpace&) = delete;
+    AddressSpace& operator=(const AddressSpace&) = delete;
+
+    void map(size_t vpn, size_t frame, bool writable = true) {
+        checkPage(vpn);
+        auto& leaf = directory[vpn >> kLeafBits];
+        if (!leaf) leaf.reset(new PageTableEntry[kLeafSize]());
+        PageTableEntry& pte = leaf[vpn & (kLeafSize - 1)];
+        if (pte.present) {
+            ++generation;  // перенаправление страницы: старые записи TLB недействительны
+        } else {
+            ++mapped_pages;
+        }
+        pte = PageTableEntry{frame, true, writable, false, false};
+    }
+
+    void unmap(size_t vpn) {
+        PageTableEntry* pte = lookup(vpn);
+        if (!pte) return;
+        *pte = PageTableEntry{};
+        --mapped_pages;
+        ++generation;
+    }
+
+    void protect(size_t vpn, bool writable) {
+        PageTableEntry* pte = lookup(vpn);
+        if (!pte) {
+            throw std::invalid_argument("Virtual page is not mapped: " + std::to_string(vpn));
+        }
+        if (pte->writable && !writable) ++generation;
+        pte->writable = writable;
+    }
+
+    // Запись таблицы страниц или nullptr, если страница не отображена.
+    // Указатель стабилен, пока жив AddressSpace.
+    PageTableEntry* lookup(size_t vpn) {
+        if (vpn >= virtual_pages) return nullptr;
+        auto& leaf = directory[vpn >> kLeafBits];
+        if (!leaf) return nullptr;
+        PageTableEntry& pte = leaf[vpn & (kLeafSize - 1)];
+        return pte.present ? &pte : nullptr;
+    }
+
+    const PageTableEntry* lookup(size_t vpn) const {
+        return const_cast<AddressSpace*>(this)->lookup(vpn);
+    }
+
+    uint32_t getAsid() const { return asid; }
+    size_t getVirtualPages() const { return virtual_pages; }
+    size_t getMappedPages() const { return mapped_pages; }
+    uint64_t getGeneration() const { return generation; }
+};
+
+/**
+ * Tlb — прямоотображаемый буфер трансляций одного ядра.
+ * Запись: (asid, vpn, generation) -> PTE. Число записей — степень двойки,
+ * индекс — младшие биты vpn.
+ */
+class Tlb {
+private:
+    struct Entry {
+        bool valid = false;
+        uint32_t asid = 0;
+        size_t vpn = 0;
+        uint64_t generation = 0;
+        PageTableEntry* pte = nullptr;
+    };
+
+    std::vector<Entry> entries;
+    size_t mask;
+    size_t hits = 0;
+    size_t misses = 0;
+
+    static size_t roundUpPow2(size_t n) {
+        size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+public:
+    explicit Tlb(size_t entry_count = 64)
+        : entries(roundUpPow2(entry_count ? entry_count : 1)), mask(entries.size() - 1) {}
+
+    PageTableEntry* lookup(const AddressSpace& space, size_t vpn) {
+        const Entry& e = entries[vpn & mask];
+        if (e.valid && e.vpn == vpn && e.asid == space.getAsid() &&
+            e.generation == space.getGeneration()) {
+            ++hits;
+            return e.pte;
+        }
+        ++misses;
+        return nullptr;
+    }
+
+    void insert(const AddressSpace& space, size_t vpn, PageTableEntry* pte) {
+        entries[vpn & mask] = Entry{true, space.getAsid(), vpn, space.getGeneration(), pte};
+    }
+
+    void flush() {
+        for (Entry& e : entries) e.valid = false;
+    }
+
+    void flushAsid(uint32_t asid) {
+        for (Entry& e : entries) {
+            if (e.asid == asid) e.valid = false;
+        }
+    }
+
+    size_t getEntryCount() const { return entries.size(); }
+    size_t getHits() const { return hits; }
+    size_t getMisses() const { return misses; }
+    double getHitRate() const {
+        const size_t total = hits + misses;
+        return total == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(total);
+    }
+    void resetCounters() { hits = misses = 0; }
+};
+
+/**
+ * Mmu — трансляция адресов одного ядра: TLB, обход таблицы страниц и
+ * вызов обработчика страничных сбоев хоста. Обработчик получает
+ * (пространство, vpn, тип доступа), может отобразить страницу
+ * (например, подкачав её с HardDrive) и вернуть true — тогда трансляция
+ * повторяется. Если обработчика нет или он вернул false, бросается PageFault.
+ */
+class Mmu {
+public:
+    using FaultHandler = std::function<bool(AddressSpace&, size_t, Access)>;
+
+private:
+    MemoryBlock& memory;
+    Tlb tlb;
+    FaultHandler fault_handler;
+    size_t page_faults = 0;
+
+    static bool permits(const PageTableEntry* pte, Access access) {
+        return pte && (access == Access::Read || pte->writable);
+    }
+
+    PageTableEntry* walk(AddressSpace& space, size_t vaddr, size_t vpn, Access access) {
+        PageTableEntry* pte = space.lookup(vpn);
+        if (permits(pte, access)) return pte;
+        ++page_faults;
+        if (fault_handler && fault_handler(space, vpn, access)) {
+            pte = space.lookup(vpn);
+            if (permits(pte, access)) return pte;
+        }
+        throw PageFault(vaddr, access);
+    }
+
+    template <typename Fn>
+    void forEachPage(AddressSpace& space, size_t vaddr, size_t len, Access access, Fn&& fn) {
+        const size_t page = memory.getBlockSize();
+        size_t done = 0;
+        while (done < len) {
+            const size_t n = std::min(page - (vaddr + done) % page, len - done);
+            fn(translate(space, vaddr + done, access), done, n);
+            done += n;
+        }
+    }
+
+public:
+    explicit Mmu(MemoryBlock& memory, size_t tlb_entries = 64)
+        : memory(memory), tlb(tlb_entries) {}
+
+    void setFaultHandler(FaultHandler handler) { fault_handler = std::move(handler); }
+
+    // Виртуальный адрес -> физический байтовый адрес в MemoryBlock.
+    size_t translate(AddressSpace& space, size_t vaddr, Access access) {
+        const size_t page = memory.getBlockSize();
+        const size_t vpn = vaddr / page;
+        PageTableEntry* pte = tlb.lookup(space, vpn);
+        if (!permits(pte, access)) {
+            pte = walk(space, vaddr, vpn, access);
+            tlb.insert(space, vpn, pte);
+        }
+        if (!pte->accessed) pte->accessed = true;
+        if (access == Access::Write && !pte->dirty) pte->dirty = true;
+        return pte->frame * page + vaddr % page;
+    }
+
+    void read(AddressSpace& space, size_t vaddr, void* dst, size_t len) {
+        uint8_t* out = static_cast<uint8_t*>(dst);
+        forEachPage(space, vaddr, len, Access::Read, [&](size_t paddr, size_t done, size_t n) {
+            memory.read(paddr, out + done, n);
+        });
+    }
+
+    void write(AddressSpace& space, size_t vaddr, const void* src, size_t len) {
+        const uint8_t* in = static_cast<const uint8_t*>(src);
+        forEachPage(space, vaddr, len, Access::Write, [&](size_t paddr, size_t done, size_t n) {
+            memory.write(paddr, in + done, n);
+        });
+    }
+
+    template <typename T>
+    T load(AddressSpace& space, size_t vaddr) {
+        static_assert(std::is_trivially_copyable<T>::value, "load<T> requires a trivially copyable type");
+        T value;
+        read(space, vaddr, &value, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    void store(AddressSpace& space, size_t vaddr, const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "store<T> requires a trivially copyable type");
+        write(space, vaddr, &value, sizeof(T));
+    }
+
+    Tlb& getTlb() { return tlb; }
+    const Tlb& getTlb() const { return tlb; }
+    size_t getPageFaults() const { return page_faults; }
+    MemoryBlock& getMemory() { return memory; }
+};
+
+#endif // VIRTUAL_MEMORY_HPP
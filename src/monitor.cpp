@@ -322,6 +322,8 @@ int Monitor::Run(Computer& computer) {
                 std::cout << "  Total blocks: " << ram.getTotalBlocks() << std::endl;
                 std::cout << "  Block size: " << ram.getBlockSize() << " bytes" << std::endl;
                 std::cout << "  Total capacity: " << (ram.getTotalBlocks() * ram.getBlockSize()) << " bytes" << std::endl;
+                std::cout << "  Resident blocks: " << ram.getResidentBlocks() << std::endl;
+                std::cout << "  Page size: " << ram.getPageSize() << " bytes" << std::endl;
             }
         } else if (cstring_bridge::equalsLit(command, "disk")) {
             if (args.size() < 2 || !cstring_bridge::equalsLit(args[1], "info")) {
@@ -332,6 +334,33 @@ int Monitor::Run(Computer& computer) {
                 std::cout << "  Total blocks: " << hdd.getTotalBlocks() << std::endl;
                 std::cout << "  Block size: " << hdd.getBlockSize() << " bytes" << std::endl;
                 std::cout << "  Total capacity: " << (hdd.getTotalBlocks() * hdd.getBlockSize()) << " bytes" << std::endl;
+                std::cout << "  Free blocks: " << hdd.getFreeBlocks() << std::endl;
+                std::cout << "  Fragmentation: " << hdd.getFragmentation() << std::endl;
+                if (hdd.hasCache()) {
+                    const BlockCacheStats cache = hdd.getCacheStats();
+                    std::cout << "  Cache: " << cache.hits << " hits, " << cache.misses << " misses, "
+                              << cache.evictions << " evictions" << std::endl;
+                }
+                if (hdd.hasTimingModel()) {
+                    const DiskTimingStats timing = hdd.getTimingStats();
+                    std::cout << "  Simulated: " << timing.requests << " requests, "
+                              << timing.virtual_time_us / 1000.0 << " ms, "
+                              << timing.getThroughput() << " MB/s" << std::endl;
+                }
+                std::cout << "  Checksum errors: " << hdd.getChecksumErrors().size() << std::endl;
+                const CompressionStats compression = hdd.getCompressionStats();
+                if (compression.files > 0) {
+                    std::cout << "  Compression ratio: " << compression.getRatio() << " ("
+                              << compression.files << " files)" << std::endl;
+                }
+                if (hdd.isDedupEnabled()) {
+                    const DedupStats dedup = hdd.getDedupStats();
+                    std::cout << "  Dedup ratio: " << dedup.getRatio() << " (" << dedup.shared_blocks
+                              << " shared blocks)" << std::endl;
+                }
+                if (hdd.isPersistent()) {
+                    std::cout << "  Image: " << hdd.getImagePath() << std::endl;
+                }
             }
         } else if (cstring_bridge::equalsLit(command, "poweroff")) {
             computer.powerOff();
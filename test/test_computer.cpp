@@ -1,5 +1,7 @@
 #include "test_framework.hpp"
 #include "../lib/Computer.hpp"
+#include "../lib/Memory/VirtualMemory.hpp"
+#include <atomic>
 #include <stdexcept>
 
 void test_computer_creation() {
@@ -26,6 +28,127 @@ void test_computer_ram_access() {
     ASSERT_EQ(64, ram.getBlockSize());
 }
 
+void test_computer_ram_allocator() {
+    Computer computer;
+    computer.powerOn();
+
+    GuestAllocator& alloc = computer.getAllocator();
+    size_t addr = alloc.allocate(24);
+    computer.getRAM().store<uint64_t>(addr, 42);
+    ASSERT_EQ(42, computer.getRAM().load<uint64_t>(addr));
+    alloc.free(addr);
+
+    computer.powerOff();
+    ASSERT_THROWS(computer.getAllocator(), std::runtime_error);
+}
+
+void test_computer_demand_paging_from_disk() {
+    Computer computer;
+    computer.powerOn();
+    MemoryBlock& ram = computer.getRAM();
+    HardDrive& hdd = computer.getHDD();
+
+    // Образ программы на диске: страница i заполнена байтом i
+    const size_t page = ram.getBlockSize();
+    std::vector<uint8_t> image(page * 4);
+    for (size_t i = 0; i < image.size(); ++i) image[i] = static_cast<uint8_t>(i / page);
+    hdd.writeFile("prog.bin", image, {0});
+
+    AddressSpace process(1, 256);
+    Mmu mmu(ram);
+    mmu.setFaultHandler([&](AddressSpace& as, size_t vpn, Access) {
+        std::vector<uint8_t> data = hdd.readFile("prog.bin");
+        if ((vpn + 1) * page > data.size()) return false;
+        size_t frame = computer.getAllocator().allocateBlocks(1);
+        ram.write(frame * page, data.data() + vpn * page, page);
+        as.map(vpn, frame);
+        return true;
+    });
+
+    ASSERT_EQ(2, mmu.load<uint8_t>(process, 2 * page + 5));
+    ASSERT_EQ(0, mmu.load<uint8_t>(process, 7));
+    ASSERT_EQ(2, process.getMappedPages());
+}
+
+void test_computer_dma_transfers() {
+    Computer computer;
+    computer.powerOn();
+    MemoryBlock& ram = computer.getRAM();
+    HardDrive& hdd = computer.getHDD();
+    // Потокобезопасный режим включается только вместе с DMA
+    ASSERT_FALSE(ram.isThreadSafe());
+    ASSERT_FALSE(hdd.getStorage().isThreadSafe());
+    DmaController& dma = computer.getDMA();
+    ASSERT_TRUE(ram.isThreadSafe());
+    ASSERT_TRUE(hdd.getStorage().isThreadSafe());
+
+    const size_t disk_block = hdd.getBlockSize();
+    std::vector<uint8_t> image(disk_block * 3);
+    for (size_t i = 0; i < image.size(); ++i) image[i] = static_cast<uint8_t>(i % 251);
+    hdd.writeFile("image.bin", image, {10, 11, 20});
+
+    std::atomic<size_t> interrupts{0};
+    dma.setInterruptHandler([&](const DmaCompletion&) { ++interrupts; });
+
+    // Цепочка: два непрерывных диапазона диска в один диапазон RAM
+    uint64_t load = dma.submit({
+        DmaDescriptor{DmaDirection::DiskToRam, 10, 2, 4096},
+        DmaDescriptor{DmaDirection::DiskToRam, 20, 1, 4096 + 2 * disk_block}
+    });
+    DmaCompletion done = dma.waitCompletion(load);
+    ASSERT_TRUE(done.status == DmaStatus::Completed);
+    ASSERT_EQ(image.size(), done.bytes);
+    std::vector<uint8_t> loaded(image.size());
+    ram.read(4096, loaded.data(), loaded.size());
+    ASSERT_TRUE(loaded == image);
+
+    // Обратно: RAM -> диск
+    ram.fill(0, 0x5A, disk_block);
+    uint64_t save = dma.submit(DmaDescriptor{DmaDirection::RamToDisk, 100, 1, 0});
+    dma.waitIdle();
+    DmaCompletion polled;
+    ASSERT_TRUE(dma.pollCompletion(polled));
+    ASSERT_EQ(save, polled.id);
+    ASSERT_FALSE(dma.pollCompletion(polled));
+    ASSERT_EQ(0x5A, hdd.getStorage().viewBlock(100)[disk_block - 1]);
+    ASSERT_EQ(2, interrupts.load());
+    ASSERT_EQ(2, dma.getCompletedChains());
+
+    // Некорректный дескриптор отклоняется при постановке
+    ASSERT_THROWS(dma.submit(DmaDescriptor{DmaDirection::DiskToRam, hdd.getTotalBlocks(), 1, 0}),
+                  std::out_of_range);
+    ASSERT_THROWS(dma.submit(DmaDescriptor{DmaDirection::DiskToRam, 0, 1, ram.getCapacity()}),
+                  std::out_of_range);
+
+    // Общий блок двух файлов (дедупликация) и блок сжатого файла в обход
+    // таблицы файлов не пишутся: файлы не меняются
+    hdd.enableDedup();
+    const std::vector<uint8_t> same(disk_block, 'S');
+    hdd.writeFile("a.bin", same);
+    hdd.writeFile("b.bin", same);
+    const size_t shared = hdd.getFileBlocks("a.bin")[0];
+    ASSERT_EQ(shared, hdd.getFileBlocks("b.bin")[0]);
+    DmaCompletion rejected = dma.waitCompletion(dma.submit(DmaDescriptor{DmaDirection::RamToDisk, shared, 1, 0}));
+    ASSERT_TRUE(rejected.status == DmaStatus::Failed);
+    ASSERT_TRUE(hdd.readFile("a.bin") == same);
+    ASSERT_TRUE(hdd.readFile("b.bin") == same);
+
+    hdd.setCompressed("image.bin", true);
+    const size_t packed = hdd.getFileBlocks("image.bin")[0];
+    rejected = dma.waitCompletion(dma.submit(DmaDescriptor{DmaDirection::RamToDisk, packed, 1, 0}));
+    ASSERT_TRUE(rejected.status == DmaStatus::Failed);
+    ASSERT_TRUE(hdd.readFile("image.bin") == image);
+
+    // Файл снова один: блок открыт для записи
+    hdd.deleteFile("b.bin");
+    DmaCompletion allowed = dma.waitCompletion(dma.submit(DmaDescriptor{DmaDirection::RamToDisk, shared, 1, 0}));
+    ASSERT_TRUE(allowed.status == DmaStatus::Completed);
+    ASSERT_EQ(0x5A, hdd.readFile("a.bin")[0]);
+
+    computer.powerOff();
+    ASSERT_THROWS(computer.getDMA(), std::runtime_error);
+}
+
 void test_computer_hdd_access() {
     Computer computer;
     computer.powerOn();
@@ -110,6 +233,9 @@ int main() {
     framework.addTest("Computer creation", test_computer_creation);
     framework.addTest("Computer power on/off", test_computer_power_on_off);
     framework.addTest("Computer RAM access", test_computer_ram_access);
+    framework.addTest("Computer RAM allocator", test_computer_ram_allocator);
+    framework.addTest("Computer demand paging from disk", test_computer_demand_paging_from_disk);
+    framework.addTest("Computer DMA transfers", test_computer_dma_transfers);
     framework.addTest("Computer HDD access", test_computer_hdd_access);
     framework.addTest("Computer filesystem access", test_computer_filesystem_access);
     framework.addTest("Computer CPU access", test_computer_cpu_access);
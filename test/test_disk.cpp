@@ -1,5 +1,15 @@
 #include "test_framework.hpp"
 #include "../lib/Disk/HardDrive.hpp"
+#include "../lib/Disk/IoRing.hpp"
+#include "../lib/Disk/BlockScrubber.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
 #include <vector>
 #include <cstdint>
 
@@ -19,7 +29,7 @@ void test_disk_write_read() {
     ASSERT_TRUE(disk.fileExists("test.txt"));
     
     std::vector<uint8_t> read_data = disk.readFile("test.txt");
-    ASSERT_EQ(64, read_data.size()); // Читаем весь блок
+    ASSERT_EQ(5, read_data.size()); // Ровно длина файла, без добивки до блока
     ASSERT_EQ(0x01, read_data[0]);
     ASSERT_EQ(0x02, read_data[1]);
     ASSERT_EQ(0x03, read_data[2]);
@@ -38,7 +48,7 @@ void test_disk_multiple_blocks() {
     ASSERT_TRUE(disk.fileExists("large.txt"));
     
     std::vector<uint8_t> read_data = disk.readFile("large.txt");
-    ASSERT_EQ(64, read_data.size()); // 2 блока * 32 байта
+    ASSERT_EQ(50, read_data.size());
     
     // Проверяем первые байты
     for (size_t i = 0; i < 32; ++i) {
@@ -90,6 +100,1080 @@ void test_disk_insufficient_blocks() {
     ASSERT_THROWS(disk.writeFile("file.txt", data, blocks), std::runtime_error);
 }
 
+void test_disk_free_space_allocation() {
+    HardDrive disk(64, 32);
+    ASSERT_EQ(64, disk.getFreeBlocks());
+
+    std::vector<uint8_t> a(100, 0x11);   // 4 блока
+    std::vector<uint8_t> b(64, 0x22);    // 2 блока
+    disk.writeFile("a.bin", a);
+    disk.writeFile("b.bin", b);
+    ASSERT_EQ(58, disk.getFreeBlocks());
+    ASSERT_EQ(1, disk.getFileFragments("a.bin"));
+    ASSERT_EQ(0x11, disk.readFile("a.bin")[99]);
+    ASSERT_EQ(100, disk.readFile("a.bin").size());
+
+    // Перезапись и удаление возвращают блоки
+    disk.writeFile("a.bin", std::vector<uint8_t>(10, 0x33));
+    ASSERT_EQ(61, disk.getFreeBlocks());
+    disk.deleteFile("b.bin");
+    ASSERT_EQ(63, disk.getFreeBlocks());
+    ASSERT_TRUE(disk.getFreeSpace().verify());
+
+    // Длительная работа без утечки блоков
+    for (int i = 0; i < 100; ++i) {
+        disk.writeFile("log.txt", std::vector<uint8_t>(32 * (i % 7 + 1), static_cast<uint8_t>(i)));
+    }
+    disk.deleteFile("log.txt");
+    disk.deleteFile("a.bin");
+    ASSERT_EQ(64, disk.getFreeBlocks());
+    ASSERT_EQ(0.0, disk.getFragmentation());
+
+    ASSERT_THROWS(disk.writeFile("huge.bin", std::vector<uint8_t>(65 * 32)), std::runtime_error);
+    ASSERT_EQ(64, disk.getFreeBlocks());
+}
+
+void test_disk_fragmentation_metrics() {
+    HardDrive disk(16, 16);
+    // Занять весь диск файлами по 2 блока, затем удалить каждый второй
+    for (int i = 0; i < 8; ++i) {
+        disk.writeFile("f" + std::to_string(i), std::vector<uint8_t>(32, static_cast<uint8_t>(i)));
+    }
+    ASSERT_EQ(0, disk.getFreeBlocks());
+    for (int i = 0; i < 8; i += 2) disk.deleteFile("f" + std::to_string(i));
+    ASSERT_EQ(8, disk.getFreeBlocks());
+    ASSERT_EQ(4, disk.getFreeSpace().getFreeExtentCount());
+    ASSERT_EQ(2, disk.getFreeSpace().getLargestFreeExtent());
+    ASSERT_TRUE(disk.getFragmentation() > 0.7);
+
+    // Файл на 6 блоков не помещается в один участок — разбивается
+    disk.writeFile("big.bin", std::vector<uint8_t>(96, 0x7E));
+    ASSERT_EQ(3, disk.getFileFragments("big.bin"));
+    std::vector<uint8_t> data = disk.readFile("big.bin");
+    ASSERT_EQ(96, data.size());
+    ASSERT_EQ(0x7E, data[95]);
+    ASSERT_EQ(1, disk.readFile("f1")[0]);
+
+    // Соседние освобождённые участки сливаются
+    disk.deleteFile("big.bin");
+    disk.deleteFile("f1");
+    ASSERT_EQ(6, disk.getFreeSpace().getLargestFreeExtent());
+    ASSERT_TRUE(disk.getFreeSpace().verify());
+}
+
+void test_disk_preallocated_blocks_are_tracked() {
+    HardDrive disk(10, 64);
+    disk.writeFile("x.bin", std::vector<uint8_t>(100, 1), {3, 4});
+    ASSERT_FALSE(disk.getFreeSpace().isFree(3));
+    ASSERT_EQ(8, disk.getFreeBlocks());
+
+    // Чужие блоки не перезаписываются
+    ASSERT_THROWS(disk.writeFile("y.bin", std::vector<uint8_t>(10, 2), {4}), std::runtime_error);
+    ASSERT_THROWS(disk.writeFile("y.bin", std::vector<uint8_t>(10, 2), {10}), std::out_of_range);
+    ASSERT_EQ(1, disk.readFile("x.bin")[64]);
+
+    // Автоматическое выделение обходит занятые блоки
+    disk.writeFile("z.bin", std::vector<uint8_t>(64 * 3, 3));
+    for (size_t block : disk.getFileBlocks("z.bin")) {
+        ASSERT_TRUE(block != 3 && block != 4);
+    }
+    disk.writeFile("x.bin", std::vector<uint8_t>(10, 4), {4});
+    ASSERT_TRUE(disk.getFreeSpace().isFree(3));
+    ASSERT_TRUE(disk.getFreeSpace().verify());
+}
+
+void test_disk_persistent_image() {
+    const std::string path = "test_disk_image.svmdisk";
+    std::remove(path.c_str());
+    std::vector<uint8_t> boot(300);
+    for (size_t i = 0; i < boot.size(); ++i) boot[i] = static_cast<uint8_t>(i * 3);
+    {
+        HardDrive disk(path, 128, 64);
+        ASSERT_TRUE(disk.isPersistent());
+        disk.writeFile("boot.img", boot);
+        disk.writeFile("note.txt", std::vector<uint8_t>(10, 0x42), {100});
+        disk.flush();
+    }
+    {
+        // Повторное открытие: данные и таблица файлов на месте
+        HardDrive disk(path, 128, 64);
+        ASSERT_TRUE(disk.fileExists("boot.img"));
+        std::vector<uint8_t> data = disk.readFile("boot.img");
+        ASSERT_TRUE(data == boot);
+        ASSERT_EQ(0x42, disk.readFile("note.txt")[9]);
+        ASSERT_FALSE(disk.getFreeSpace().isFree(100));
+        ASSERT_EQ(128 - 5 - 1, disk.getFreeBlocks());
+        ASSERT_EQ(300, disk.getFileSize("boot.img"));
+        disk.deleteFile("note.txt");
+        // Без явного flush() таблица файлов сохраняется при уничтожении диска
+    }
+    {
+        HardDrive disk(path, 128, 64);
+        ASSERT_FALSE(disk.fileExists("note.txt"));
+        ASSERT_EQ(128 - 5, disk.getFreeBlocks());
+    }
+    ASSERT_THROWS(HardDrive(path, 256, 64), std::runtime_error);
+
+    // Повреждённый заголовок обнаруживается по контрольной сумме
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(16);
+        file.put('\x7F');
+    }
+    ASSERT_THROWS(HardDrive(path, 128, 64), std::runtime_error);
+    std::remove(path.c_str());
+
+    // Таблица файлов больше начального слота метаданных: диск, заполненный
+    // мелкими файлами с длинными именами, сохраняется и открывается заново
+    const std::string prefix(100, 'f');
+    {
+        HardDrive disk(path, 1024, 64);
+        for (size_t i = 0; i < 1024; ++i) {
+            disk.writeFile(prefix + std::to_string(i), std::vector<uint8_t>(10, static_cast<uint8_t>(i)));
+        }
+        ASSERT_EQ(0, disk.getFreeBlocks());
+        disk.flush();
+    }
+    {
+        HardDrive disk(path, 1024, 64);
+        ASSERT_EQ(1024, disk.getFileCount());
+        ASSERT_EQ(0, disk.getFreeBlocks());
+        ASSERT_EQ(static_cast<uint8_t>(777), disk.readFile(prefix + "777")[9]);
+        disk.deleteFile(prefix + "0");
+    }
+    {
+        HardDrive disk(path, 1024, 64);
+        ASSERT_EQ(1023, disk.getFileCount());
+        ASSERT_EQ(1, disk.getFreeBlocks());
+        ASSERT_EQ(static_cast<uint8_t>(1023), disk.readFile(prefix + "1023")[0]);
+    }
+    std::remove(path.c_str());
+}
+
+void test_disk_partial_io() {
+    HardDrive disk(32, 16);
+    std::vector<uint8_t> data(40);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<uint8_t>(i);
+    disk.writeFile("log.txt", data);
+    ASSERT_EQ(40, disk.getFileSize("log.txt"));
+
+    // Чтение через границу блока и у конца файла
+    std::vector<uint8_t> part = disk.readAt("log.txt", 14, 4);
+    ASSERT_EQ(4, part.size());
+    ASSERT_EQ(14, part[0]);
+    ASSERT_EQ(17, part[3]);
+    ASSERT_EQ(2, disk.readAt("log.txt", 38, 10).size());
+    ASSERT_EQ(0, disk.readAt("log.txt", 100, 10).size());
+
+    // Запись в середину меняет только затронутые байты
+    disk.writeAt("log.txt", 15, std::vector<uint8_t>{0xEE, 0xEF});
+    part = disk.readAt("log.txt", 14, 4);
+    ASSERT_EQ(14, part[0]);
+    ASSERT_EQ(0xEE, part[1]);
+    ASSERT_EQ(0xEF, part[2]);
+    ASSERT_EQ(17, part[3]);
+    ASSERT_EQ(40, disk.getFileSize("log.txt"));
+
+    // Дозапись продолжает последний участок файла
+    ASSERT_EQ(40, disk.append("log.txt", std::vector<uint8_t>(20, 0x77)));
+    ASSERT_EQ(60, disk.getFileSize("log.txt"));
+    ASSERT_EQ(4, disk.getFileBlocks("log.txt").size());
+    ASSERT_EQ(1, disk.getFileFragments("log.txt"));
+    part = disk.readAt("log.txt", 38, 4);
+    ASSERT_EQ(38, part[0]);
+    ASSERT_EQ(0x77, part[2]);
+
+    // Запись за концом оставляет нулевой промежуток; файл создаётся
+    disk.writeAt("sparse.bin", 20, std::vector<uint8_t>{1, 2});
+    ASSERT_EQ(22, disk.getFileSize("sparse.bin"));
+    part = disk.readAt("sparse.bin", 0, 22);
+    ASSERT_EQ(0, part[0]);
+    ASSERT_EQ(0, part[19]);
+    ASSERT_EQ(2, part[21]);
+
+    // Нехватка места не создаёт пустой файл
+    ASSERT_THROWS(disk.writeAt("huge.bin", 0, std::vector<uint8_t>(16 * 64, 1)), std::runtime_error);
+    ASSERT_FALSE(disk.fileExists("huge.bin"));
+    ASSERT_TRUE(disk.getFreeSpace().verify());
+}
+
+void test_disk_chunk_reader() {
+    HardDrive disk(16, 32);
+    std::vector<uint8_t> data(80);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<uint8_t>(i + 1);
+    disk.writeFile("stream.bin", data);
+
+    // Фрагменты — представления блоков хранилища; последний обрезан по длине
+    HardDrive::ChunkReader reader = disk.openReader("stream.bin");
+    std::vector<uint8_t> joined;
+    std::vector<size_t> sizes;
+    while (!reader.done()) {
+        BlockView chunk = reader.next();
+        ASSERT_TRUE(chunk.data() == disk.getStorage().viewBlock(disk.getFileBlocks("stream.bin")[sizes.size()]).data());
+        sizes.push_back(chunk.size());
+        joined.insert(joined.end(), chunk.begin(), chunk.end());
+    }
+    ASSERT_EQ(3, sizes.size());
+    ASSERT_EQ(16, sizes[2]);
+    ASSERT_TRUE(joined == data);
+    ASSERT_EQ(80, reader.position());
+    ASSERT_TRUE(reader.next().empty());
+
+    size_t total = 0;
+    disk.forEachChunk("stream.bin", [&](BlockView chunk) { total += chunk.size(); });
+    ASSERT_EQ(80, total);
+
+    // Пустой файл не даёт фрагментов
+    disk.writeFile("empty.bin", std::vector<uint8_t>());
+    ASSERT_TRUE(disk.openReader("empty.bin").done());
+    ASSERT_EQ(0, disk.readFile("empty.bin").size());
+}
+
+void test_disk_inode_handles() {
+    HardDrive disk(32, 16);
+    FileHandle log = disk.createFile("app.log");
+    ASSERT_EQ(1, disk.getFileCount());
+    ASSERT_EQ(0, disk.getFileSize(log));
+
+    // Операции по дескриптору не ищут файл по имени
+    ASSERT_EQ(0, disk.append(log, std::vector<uint8_t>{'a', 'b'}));
+    ASSERT_EQ(2, disk.append(log, std::vector<uint8_t>(20, 'c')));
+    ASSERT_EQ(22, disk.getFileSize("app.log"));
+    disk.writeAt(log, 1, std::vector<uint8_t>{'X'});
+    std::vector<uint8_t> head = disk.readAt(log, 0, 3);
+    ASSERT_EQ('a', head[0]);
+    ASSERT_EQ('X', head[1]);
+    ASSERT_EQ('c', head[2]);
+    ASSERT_EQ(22, disk.readFile(log).size());
+
+    // Перезапись по имени не делает дескриптор недействительным
+    disk.writeFile("app.log", std::vector<uint8_t>{'z'});
+    ASSERT_EQ(1, disk.getFileSize(log));
+
+    // Имена из String* ищутся без преобразования; дескриптор совпадает
+    String* name = cstring_bridge::makeString("app.log");
+    ASSERT_TRUE(disk.fileExists(name));
+    FileHandle same = disk.openFile(name);
+    ASSERT_EQ(log.inode, same.inode);
+    ASSERT_EQ('z', disk.readFile(name)[0]);
+
+    // Удаление делает дескриптор недействительным, номер inode используется повторно
+    disk.deleteFile(name);
+    ASSERT_FALSE(disk.fileExists("app.log"));
+    ASSERT_THROWS(disk.getFileSize(log), std::runtime_error);
+    ASSERT_THROWS(disk.readAt(log, 0, 1), std::runtime_error);
+    FileHandle other = disk.createFile("other.log");
+    ASSERT_EQ(log.inode, other.inode);
+    ASSERT_THROWS(disk.append(log, std::vector<uint8_t>{1}), std::runtime_error);
+    ASSERT_EQ(0, disk.getFileSize(other));
+
+    // Создание через String* и поиск по std::string
+    disk.append(name, std::vector<uint8_t>{7, 8});
+    ASSERT_EQ(2, disk.getFileSize("app.log"));
+    ASSERT_THROWS(disk.openFile("missing"), std::runtime_error);
+    cstring_bridge::destroyString(name);
+    ASSERT_TRUE(disk.getFreeSpace().verify());
+}
+
+void test_disk_block_cache() {
+    MemoryBlock storage(64, 16);
+    for (size_t i = 0; i < 64; ++i) storage.writeBlock(i, std::vector<uint8_t>(16, static_cast<uint8_t>(i)));
+    BlockCache cache(storage, 4);
+
+    // Повторное чтение — попадание; представление указывает на буфер кэша
+    cache.read(1, [](BlockView b) { ASSERT_EQ(1, b[0]); });
+    cache.read(1, [](BlockView b) { ASSERT_EQ(1, b[15]); });
+    ASSERT_EQ(1, cache.getStats().hits);
+    ASSERT_EQ(1, cache.getStats().misses);
+
+    // Однократный проход не вытесняет повторно использованный блок (ARC)
+    for (size_t i = 10; i < 30; ++i) cache.read(i, [](BlockView) {});
+    ASSERT_TRUE(cache.contains(1));
+    ASSERT_TRUE(cache.getStats().evictions > 0);
+    ASSERT_TRUE(cache.getResidentBlocks() <= 4);
+
+    // Привязанный блок не вытесняется; когда привязаны все, вставка невозможна
+    BlockCache small(storage, 2);
+    BlockCache::Pin a = small.pin(40);
+    BlockCache::Pin b = small.pin(41);
+    ASSERT_THROWS(small.pin(42), std::runtime_error);
+    ASSERT_EQ(40, a.view()[0]);
+    b.release();
+    BlockCache::Pin c = small.pin(42);
+    ASSERT_TRUE(small.contains(40));
+    ASSERT_FALSE(small.contains(41));
+
+    // Изменение в обход кэша: инвалидация привязанного блока откладывается
+    storage.writeBlock(40, std::vector<uint8_t>(16, 0xEE));
+    small.invalidate(40, 1);
+    ASSERT_FALSE(small.contains(40));
+    ASSERT_EQ(40, a.view()[0]);
+    small.read(40, [](BlockView v) { ASSERT_EQ(0xEE, v[0]); });
+    a.release();
+    small.read(40, [](BlockView v) { ASSERT_EQ(0xEE, v[0]); });
+    ASSERT_TRUE(small.contains(40));
+}
+
+void test_disk_cached_file_io() {
+    HardDrive disk(32, 16);
+    disk.enableCache(8);
+    disk.writeFile("hot.txt", std::vector<uint8_t>(40, 'a'));
+    ASSERT_EQ(40, disk.readFile("hot.txt").size());
+    ASSERT_EQ(3, disk.getCacheStats().misses);
+    ASSERT_EQ(40, disk.readFile("hot.txt").size());
+    ASSERT_EQ(3, disk.getCacheStats().hits);
+
+    // Запись обновляет копию в кэше
+    disk.writeAt("hot.txt", 17, std::vector<uint8_t>{'Z'});
+    ASSERT_EQ('Z', disk.readAt("hot.txt", 17, 1)[0]);
+
+    // Потоковое чтение отдаёт буферы кэша
+    HardDrive::ChunkReader reader = disk.openReader("hot.txt");
+    ASSERT_EQ(16, reader.next().size());
+    ASSERT_EQ('Z', reader.next()[1]);
+    ASSERT_EQ(8, reader.next().size());
+
+    // Запись в хранилище в обход диска видна после инвалидации
+    const size_t block = disk.getFileBlocks("hot.txt")[0];
+    disk.getStorage().writeBlock(block, std::vector<uint8_t>(16, 'q'));
+    disk.invalidateCache(block, 1);
+    ASSERT_EQ('q', disk.readAt("hot.txt", 0, 1)[0]);
+}
+
+void test_disk_write_back_cache() {
+    HardDrive disk(32, 16);
+    disk.enableCache(8, CacheMode::WriteBack);
+    disk.writeFile("wb.txt", std::vector<uint8_t>(40, 'w'));
+    const size_t first = disk.getFileBlocks("wb.txt")[0];
+
+    // Данные пока только в кэше, но читаются через диск
+    ASSERT_EQ(0, disk.getStorage().viewBlock(first)[0]);
+    ASSERT_EQ('w', disk.readFile("wb.txt")[0]);
+
+    // Мелкие дозаписи в грязный блок поглощаются кэшем
+    for (int i = 0; i < 5; ++i) disk.append("wb.txt", std::vector<uint8_t>{'+'});
+    ASSERT_TRUE(disk.getCacheStats().coalesced_writes >= 5);
+    ASSERT_EQ(3, disk.getCache()->getDirtyBlocks());
+
+    // Сброс: три соседних блока — один непрерывный участок
+    disk.commit();
+    ASSERT_EQ(0, disk.getCache()->getDirtyBlocks());
+    ASSERT_EQ(3, disk.getCacheStats().writebacks);
+    ASSERT_EQ(1, disk.getCacheStats().writeback_runs);
+    ASSERT_EQ('w', disk.getStorage().viewBlock(first)[0]);
+
+    // Вытеснение грязного блока записывает его в хранилище
+    disk.writeFile("big.bin", std::vector<uint8_t>(16 * 12, 'b'));
+    ASSERT_TRUE(disk.getCacheStats().writebacks > 3);
+    std::vector<uint8_t> big = disk.readFile("big.bin");
+    ASSERT_EQ(16 * 12, big.size());
+    ASSERT_EQ('b', big.back());
+    disk.flush();
+    ASSERT_EQ('b', disk.getStorage().viewBlock(disk.getFileBlocks("big.bin")[11])[15]);
+}
+
+void test_disk_io_ring() {
+    HardDrive disk(64, 32);
+    ASSERT_THROWS(IoRing(disk, 2, 8), std::runtime_error);
+    disk.getStorage().enableThreadSafety();
+    disk.enableCache(8, CacheMode::WriteBack);
+    disk.writeFile("cached.bin", std::vector<uint8_t>(32, 'c'));
+    const size_t cached = disk.getFileBlocks("cached.bin")[0];
+    IoRing ring(disk, 3, 8);
+
+    // Пачка записей в разные блоки; завершения приходят в любом порядке
+    std::vector<std::vector<uint8_t>> out(8);
+    for (size_t i = 0; i < 8; ++i) {
+        out[i].assign(32, static_cast<uint8_t>(0x10 + i));
+        ASSERT_TRUE(ring.prepareWrite(40 + i, 1, out[i].data(), 100 + i));
+    }
+    ASSERT_FALSE(ring.prepareFlush(999));  // все места заняты
+    ASSERT_EQ(8, ring.submit());
+    std::vector<IoCompletion> done;
+    ASSERT_EQ(8, ring.waitCompletions(done, 8, 8));
+    uint64_t tags = 0;
+    for (const IoCompletion& c : done) {
+        ASSERT_TRUE(c.ok);
+        ASSERT_EQ(32, c.bytes);
+        tags |= uint64_t(1) << (c.user_data - 100);
+    }
+    ASSERT_EQ(0xFF, tags);
+    ASSERT_EQ(0, ring.getInFlight());
+
+    // Многоблочное чтение видит записанное и грязный блок кэша
+    std::vector<uint8_t> in(8 * 32);
+    std::vector<uint8_t> cached_in(32);
+    ASSERT_TRUE(ring.prepareRead(40, 8, in.data(), 1));
+    ASSERT_TRUE(ring.prepareRead(cached, 1, cached_in.data(), 2));
+    ASSERT_TRUE(ring.prepareRead(64, 1, cached_in.data(), 3));  // за концом диска
+    ASSERT_TRUE(ring.prepareFlush(4));
+    ring.submit();
+    done.clear();
+    ring.waitCompletions(done, 4, 4);
+    for (const IoCompletion& c : done) {
+        ASSERT_EQ(c.user_data != 3, c.ok);
+        if (c.user_data == 3) ASSERT_FALSE(c.error.empty());
+    }
+    ASSERT_EQ(0x10, in[0]);
+    ASSERT_EQ(0x17, in[7 * 32 + 31]);
+    ASSERT_EQ('c', cached_in[0]);
+
+    // Запись поверх кэшированного блока сбрасывает его копию
+    std::vector<uint8_t> patch(32, 'p');
+    ASSERT_TRUE(ring.prepareWrite(cached, 1, patch.data(), 5));
+    ring.submit();
+    done.clear();
+    ring.waitCompletions(done, 1, 1);
+    ASSERT_EQ('p', disk.readFile("cached.bin")[0]);
+
+    IoRingStats stats = ring.getStats();
+    ASSERT_EQ(13, stats.submitted);
+    ASSERT_EQ(13, stats.completed);
+    ASSERT_EQ(1, stats.failed);
+    ASSERT_EQ(8, stats.max_in_flight);
+}
+
+static IoRequest blockRequest(IoOp op, size_t block, size_t count, uint64_t tag) {
+    IoRequest req;
+    req.op = op;
+    req.block = block;
+    req.count = count;
+    req.user_data = tag;
+    return req;
+}
+
+void test_disk_io_scheduler() {
+    using std::chrono::milliseconds;
+    const IoScheduler::Clock::time_point t0{};
+    IoDispatch d;
+
+    // Элеватор: по возрастанию блока, соседние запросы сливаются
+    IoScheduler elevator(SchedulerPolicy::Elevator);
+    for (size_t block : {10, 3, 4, 20, 5}) elevator.add(blockRequest(IoOp::Read, block, 1, block), t0);
+    elevator.add(blockRequest(IoOp::Write, 6, 1, 6), t0);  // другой тип — не сливается
+    ASSERT_TRUE(elevator.next(d, t0));
+    ASSERT_EQ(3, d.block);
+    ASSERT_EQ(3, d.count);
+    ASSERT_EQ(4, d.parts[1].user_data);
+    ASSERT_TRUE(elevator.next(d, t0));
+    ASSERT_TRUE(d.op == IoOp::Write);
+    ASSERT_TRUE(elevator.next(d, t0));
+    ASSERT_EQ(10, d.block);
+    ASSERT_TRUE(elevator.next(d, t0));
+    ASSERT_EQ(20, d.block);
+    ASSERT_FALSE(elevator.next(d, t0));
+    IoSchedulerStats stats = elevator.getStats();
+    ASSERT_EQ(6, stats.requests);
+    ASSERT_EQ(4, stats.dispatches);
+    ASSERT_EQ(2, stats.merged);
+    ASSERT_EQ(6, stats.max_depth);
+    ASSERT_TRUE(stats.getMergeRate() > 0.3 && stats.getMergeRate() < 0.4);
+
+    // Предел слияния
+    IoScheduler limited(SchedulerPolicy::Elevator, 4);
+    for (size_t block = 0; block < 6; ++block) limited.add(blockRequest(IoOp::Write, block, 1, block), t0);
+    ASSERT_TRUE(limited.next(d, t0));
+    ASSERT_EQ(4, d.count);
+
+    // Noop: порядок поступления
+    IoScheduler noop(SchedulerPolicy::Noop);
+    noop.add(blockRequest(IoOp::Read, 10, 1, 0), t0);
+    noop.add(blockRequest(IoOp::Read, 11, 2, 1), t0);
+    noop.add(blockRequest(IoOp::Read, 3, 1, 2), t0);
+    ASSERT_TRUE(noop.next(d, t0));
+    ASSERT_EQ(10, d.block);
+    ASSERT_EQ(3, d.count);
+    ASSERT_TRUE(noop.next(d, t0));
+    ASSERT_EQ(3, d.block);
+
+    // Deadline: просроченная запись обгоняет более близкое чтение
+    IoScheduler deadline(SchedulerPolicy::Deadline);
+    deadline.add(blockRequest(IoOp::Write, 50, 1, 1), t0);
+    deadline.add(blockRequest(IoOp::Read, 1, 1, 2), t0 + milliseconds(60));
+    ASSERT_TRUE(deadline.next(d, t0 + milliseconds(60)));
+    ASSERT_EQ(50, d.block);
+    ASSERT_EQ(1, deadline.getStats().expired);
+    ASSERT_TRUE(deadline.next(d, t0 + milliseconds(60)));
+    ASSERT_EQ(1, d.block);
+
+    // Собственный срок запроса
+    IoRequest urgent = blockRequest(IoOp::Write, 40, 1, 3);
+    urgent.deadline_us = 100;
+    deadline.add(blockRequest(IoOp::Read, 2, 1, 4), t0);
+    deadline.add(urgent, t0);
+    ASSERT_TRUE(deadline.next(d, t0 + milliseconds(1)));
+    ASSERT_EQ(3, d.parts[0].user_data);
+    ASSERT_THROWS(deadline.add(blockRequest(IoOp::Flush, 0, 0, 5), t0), std::invalid_argument);
+
+    // Через кольцо: соседние запросы из общего буфера дают верные данные
+    HardDrive disk(64, 32);
+    disk.getStorage().enableThreadSafety();
+    IoRing ring(disk, 1, 16, SchedulerPolicy::Elevator);
+    std::vector<uint8_t> data(8 * 32);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<uint8_t>(i * 7);
+    for (size_t i = 0; i < 8; ++i) ASSERT_TRUE(ring.prepareWrite(16 + (i ^ 5), 1, data.data() + (i ^ 5) * 32, i));
+    ring.submit();
+    std::vector<IoCompletion> done;
+    ring.waitCompletions(done, 8, 8);
+    std::vector<uint8_t> back(8 * 32);
+    ASSERT_TRUE(ring.prepareRead(16, 8, back.data(), 8));
+    ring.submit();
+    ring.waitCompletions(done, 1, 1);
+    for (const IoCompletion& c : done) ASSERT_TRUE(c.ok);
+    ASSERT_TRUE(back == data);
+    ASSERT_EQ(9, ring.getSchedulerStats().requests);
+    ASSERT_TRUE(ring.getSchedulerStats().dispatches <= 9);
+
+    // Испорченный блок в середине слитого чтения: ошибку получает только
+    // его часть, соседние прочитаны
+    const uint8_t junk = 'X';
+    disk.getStorage().write(17 * 32, &junk, 1);
+    std::vector<uint8_t> three(3 * 32);
+    for (size_t i = 0; i < 3; ++i) ASSERT_TRUE(ring.prepareRead(16 + i, 1, three.data() + i * 32, 20 + i));
+    ring.submit();
+    done.clear();
+    ring.waitCompletions(done, 3, 3);
+    for (const IoCompletion& c : done) ASSERT_EQ(c.user_data != 21, c.ok);
+    ASSERT_TRUE(std::equal(three.begin(), three.begin() + 32, data.begin()));
+    ASSERT_TRUE(std::equal(three.begin() + 64, three.end(), data.begin() + 64));
+
+    // Слитая запись, одна часть которой попадает в общий блок: отклоняется
+    // только эта часть
+    disk.enableDedup();
+    disk.writeFile("one.bin", std::vector<uint8_t>(32, 's'));
+    disk.writeFile("two.bin", std::vector<uint8_t>(32, 's'));
+    const size_t shared = disk.getFileBlocks("one.bin")[0];
+    ASSERT_EQ(shared, disk.getFileBlocks("two.bin")[0]);
+    ASSERT_TRUE(shared + 3 <= 16);
+    const std::vector<uint8_t> fill(3 * 32, 'w');
+    for (size_t i = 0; i < 3; ++i) {
+        ASSERT_TRUE(ring.prepareWrite(shared + i, 1, fill.data() + i * 32, 30 + i));
+    }
+    ring.submit();
+    done.clear();
+    ring.waitCompletions(done, 3, 3);
+    for (const IoCompletion& c : done) ASSERT_EQ(c.user_data != 30, c.ok);
+    ASSERT_EQ('s', disk.readFile("two.bin")[0]);
+    ASSERT_EQ('w', disk.getStorage().viewBlock(shared + 2)[0]);
+}
+
+void test_disk_timing_model() {
+    // HDD: продолжение предыдущего обращения без поиска, дальний поиск дороже ближнего
+    DiskTimingModel hdd(DiskTimingParams::hdd(), 1000, 512);
+    const double first = hdd.access(false, 0, 1);
+    const double sequential = hdd.access(false, 1, 1);
+    const double near = hdd.access(false, 10, 1);
+    const double far = hdd.access(false, 990, 1);
+    ASSERT_TRUE(std::fabs(first - sequential) < 1e-9);
+    ASSERT_TRUE(sequential < near && near < far);
+    ASSERT_EQ(2, hdd.getStats().seeks);
+    ASSERT_TRUE(std::fabs(hdd.getVirtualTime() - (first + sequential + near + far)) < 1e-6);
+
+    // Упорядоченный проход быстрее случайного порядка тех же блоков
+    DiskTimingModel shuffled(DiskTimingParams::hdd(), 1000, 512);
+    DiskTimingModel sorted(DiskTimingParams::hdd(), 1000, 512);
+    for (size_t block : {700, 100, 500, 200, 900, 300}) shuffled.access(false, block, 1);
+    for (size_t block : {100, 200, 300, 500, 700, 900}) sorted.access(false, block, 1);
+    ASSERT_TRUE(sorted.getVirtualTime() < shuffled.getVirtualTime());
+
+    // SSD: асинхронные обращения обслуживаются каналами параллельно
+    DiskTimingModel ssd(DiskTimingParams::ssd(4), 1000, 512);
+    const double one = 80 + 512 / 500.0;
+    for (size_t i = 0; i < 8; ++i) ssd.access(false, i * 37, 1, false);
+    ASSERT_TRUE(std::fabs(ssd.getVirtualTime() - 2 * one) < 1e-6);
+    ssd.drain();
+    ssd.access(false, 0, 1);
+    ASSERT_TRUE(std::fabs(ssd.getVirtualTime() - 3 * one) < 1e-6);
+    DiskTimingStats stats = ssd.getStats();
+    ASSERT_EQ(9, stats.requests);
+    ASSERT_TRUE(std::fabs(stats.getThroughput() - 9 * 512 / (3 * one)) < 1e-6);
+
+    // Диск: учитываются обращения к хранилищу, попадания в кэш бесплатны
+    HardDrive disk(256, 512);
+    disk.enableTimingModel(DiskTimingParams::hdd());
+    disk.writeFile("t.bin", std::vector<uint8_t>(4 * 512, 't'));
+    ASSERT_EQ(4, disk.getTimingStats().requests);
+    ASSERT_TRUE(disk.getTimingStats().seeks <= 1);
+    disk.enableCache(16);
+    disk.readFile("t.bin");
+    const size_t after_miss = disk.getTimingStats().requests;
+    ASSERT_EQ(8, after_miss);
+    disk.readFile("t.bin");
+    ASSERT_EQ(after_miss, disk.getTimingStats().requests);
+    ASSERT_TRUE(disk.getTimingStats().getThroughput() > 0);
+    disk.disableTimingModel();
+    ASSERT_EQ(0, disk.getTimingStats().requests);
+}
+
+void test_disk_checksums() {
+    // CRC32C: контрольное значение и совпадение аппаратного и табличного расчёта
+    ASSERT_EQ(0xE3069283u, crc32c::compute("123456789", 9));
+    std::vector<uint8_t> bytes(1001);
+    for (size_t i = 0; i < bytes.size(); ++i) bytes[i] = static_cast<uint8_t>(i * 31 + 7);
+    const uint32_t whole = crc32c::compute(bytes.data(), bytes.size());
+    ASSERT_EQ(~crc32c::detail::software(~0u, bytes.data(), bytes.size()), whole);
+    ASSERT_EQ(whole, crc32c::extend(crc32c::compute(bytes.data(), 500), bytes.data() + 500, 501));
+
+    HardDrive disk(64, 32);
+    disk.writeFile("data.bin", std::vector<uint8_t>(100, 'd'));
+    ASSERT_EQ(100, disk.readFile("data.bin").size());
+    ASSERT_TRUE(disk.getChecksumErrors().empty());
+
+    // Тихая порча хранилища обнаруживается при чтении
+    const size_t block = disk.getFileBlocks("data.bin")[1];
+    const uint8_t junk = 'X';
+    disk.getStorage().write(block * 32 + 5, &junk, 1);
+    ASSERT_THROWS(disk.readFile("data.bin"), std::runtime_error);
+    ASSERT_EQ(1, disk.getChecksumErrors().size());
+    ASSERT_EQ(block, disk.getChecksumErrors()[0]);
+
+    // Проверка занятых блоков находит тот же блок; свободные пропускаются,
+    // перезапись повреждённого блока его исправляет
+    BlockScrubber scrubber(disk);
+    disk.getStorage().write(63 * 32, &junk, 1);
+    scrubber.runPass();
+    ASSERT_EQ(1, scrubber.getStats().passes);
+    ASSERT_EQ(4, scrubber.getStats().scanned_blocks);
+    ASSERT_EQ(1, scrubber.getStats().errors);
+    disk.writeAt("data.bin", 32, std::vector<uint8_t>(32, 'r'));
+    ASSERT_TRUE(disk.getChecksumErrors().empty());
+    ASSERT_EQ(6, scrubber.runBlocks(6));
+    ASSERT_EQ(2, scrubber.getStats().passes);
+    ASSERT_EQ(1, scrubber.getStats().errors);
+
+    // Через кэш: повреждённый блок не кэшируется; запись с уведомлением допустима
+    disk.enableCache(8);
+    const size_t first = disk.getFileBlocks("data.bin")[0];
+    disk.getStorage().write(first * 32, &junk, 1);
+    ASSERT_THROWS(disk.readAt("data.bin", 0, 1), std::runtime_error);
+    ASSERT_FALSE(disk.getCache()->contains(first));
+    disk.invalidateCache(first, 1);
+    ASSERT_EQ('X', disk.readAt("data.bin", 0, 1)[0]);
+    ASSERT_TRUE(disk.getChecksumStats().verified > 0);
+
+    // Фоновая проверка в пределах бюджета
+    disk.getStorage().enableThreadSafety();
+    scrubber.start(std::chrono::milliseconds(1), 16);
+    for (int i = 0; i < 2000 && scrubber.getStats().passes < 3; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    scrubber.stop();
+    ASSERT_TRUE(scrubber.getStats().passes >= 3);
+    ASSERT_EQ(1, scrubber.getStats().errors);
+
+    // Запись в обход таблицы файлов меняет данные и сумму под одной
+    // блокировкой: параллельное чтение файла не видит ложных расхождений
+    disk.disableCache();
+    const size_t errors_before = disk.getChecksumStats().errors;
+    const size_t target = disk.getFileBlocks("data.bin")[1];
+    std::atomic<bool> writing{true};
+    std::atomic<size_t> read_failures{0};
+    std::thread reader([&] {
+        while (writing.load()) {
+            try {
+                const uint8_t c = disk.readAt("data.bin", 40, 1)[0];
+                if (c != 'r' && c != 'u' && c != 'v') ++read_failures;
+            } catch (const std::exception&) {
+                ++read_failures;
+            }
+        }
+    });
+    {
+        IoRing ring(disk, 2, 8);
+        const std::vector<uint8_t> u(32, 'u');
+        const std::vector<uint8_t> v(32, 'v');
+        std::vector<IoCompletion> done;
+        for (int i = 0; i < 1000; ++i) {
+            ASSERT_TRUE(ring.prepareWrite(target, 1, (i % 2 ? u : v).data(), i));
+            ring.submit();
+            done.clear();
+            ring.waitCompletions(done, 1, 1);
+            ASSERT_TRUE(done[0].ok);
+        }
+    }
+    writing = false;
+    reader.join();
+    ASSERT_EQ(0, read_failures.load());
+    ASSERT_EQ(errors_before, disk.getChecksumStats().errors);
+}
+
+static std::vector<uint8_t> blocksOf(const std::string& fill) {
+    std::vector<uint8_t> data;
+    for (char c : fill) data.insert(data.end(), 32, static_cast<uint8_t>(c));
+    return data;
+}
+
+void test_disk_dedup() {
+    std::vector<uint8_t> bytes(100, 7);
+    const Fingerprint print = fingerprint::compute(bytes.data(), bytes.size());
+    ASSERT_TRUE(print == fingerprint::compute(bytes.data(), bytes.size()));
+    bytes[99] = 8;
+    ASSERT_TRUE(print != fingerprint::compute(bytes.data(), bytes.size()));
+    ASSERT_TRUE(print != fingerprint::compute(bytes.data(), 99));
+
+    const std::string path = "test_disk_dedup.svmdisk";
+    std::remove(path.c_str());
+    {
+        HardDrive disk(path, 64, 32);
+        disk.writeFile("before.bin", blocksOf("ab"));
+        disk.enableDedup();
+        ASSERT_EQ(2, disk.getDedupStats().indexed_blocks);
+
+        // Совпадения с существующими файлами, внутри записи и в неполном блоке
+        disk.writeFile("copy.bin", blocksOf("ab"));
+        ASSERT_TRUE(disk.getFileBlocks("copy.bin") == disk.getFileBlocks("before.bin"));
+        disk.writeFile("rep.bin", blocksOf("zzz"));
+        std::vector<uint8_t> tail = blocksOf("a");
+        tail.insert(tail.end(), 8, 'q');
+        disk.writeFile("tail.bin", tail);
+        ASSERT_EQ(disk.getFileBlocks("before.bin")[0], disk.getFileBlocks("tail.bin")[0]);
+        DedupStats stats = disk.getDedupStats();
+        ASSERT_EQ(9, stats.logical_blocks);
+        ASSERT_EQ(4, stats.physical_blocks);
+        ASSERT_EQ(4, disk.getUsedBlocks());
+        ASSERT_EQ(5, stats.hits);
+        ASSERT_EQ(3, stats.shared_blocks);
+        ASSERT_TRUE(std::fabs(stats.getRatio() - 2.25) < 1e-9);
+        ASSERT_TRUE(disk.readFile("tail.bin") == tail);
+
+        // Изменение общего блока копирует его
+        disk.writeAt("copy.bin", 0, std::vector<uint8_t>{'X'});
+        ASSERT_EQ(1, disk.getDedupStats().cow_copies);
+        ASSERT_EQ('a', disk.readAt("before.bin", 0, 1)[0]);
+        ASSERT_EQ('X', disk.readAt("copy.bin", 0, 1)[0]);
+        ASSERT_EQ('a', disk.readAt("tail.bin", 0, 1)[0]);
+        ASSERT_EQ(5, disk.getUsedBlocks());
+
+        // Удаление снимает ссылки; блоки других файлов остаются
+        disk.deleteFile("before.bin");
+        ASSERT_EQ(5, disk.getUsedBlocks());
+        ASSERT_EQ('b', disk.readAt("copy.bin", 32, 1)[0]);
+        disk.writeFile("rep.bin", blocksOf("zzz"));
+        ASSERT_EQ(5, disk.getUsedBlocks());
+    }
+    {
+        // Общие блоки переживают перемонтирование и без дедупликации
+        HardDrive disk(path, 64, 32);
+        ASSERT_FALSE(disk.isDedupEnabled());
+        ASSERT_EQ(5, disk.getUsedBlocks());
+        ASSERT_TRUE(disk.getFreeSpace().verify());
+        ASSERT_TRUE(disk.readFile("rep.bin") == blocksOf("zzz"));
+        disk.writeAt("rep.bin", 40, std::vector<uint8_t>{'y'});
+        const std::vector<size_t>& rep = disk.getFileBlocks("rep.bin");
+        ASSERT_TRUE(rep[0] == rep[2] && rep[1] != rep[0]);
+        ASSERT_EQ(6, disk.getUsedBlocks());
+    }
+    {
+        HardDrive disk(path, 64, 32);
+        ASSERT_EQ('y', disk.readAt("rep.bin", 40, 1)[0]);
+        ASSERT_EQ('z', disk.readAt("rep.bin", 64, 1)[0]);
+        ASSERT_EQ(6, disk.getUsedBlocks());
+    }
+    std::remove(path.c_str());
+
+    // Блок, изменённый в обход HardDrive, не принимается за совпадение
+    HardDrive disk(4, 32);
+    disk.enableDedup();
+    disk.writeFile("x.bin", blocksOf("klm"));
+    const size_t block = disk.getFileBlocks("x.bin")[0];
+    const uint8_t junk = 'j';
+    disk.getStorage().write(block * 32, &junk, 1);
+    disk.invalidateCache(block, 1);
+    disk.writeFile("k.bin", blocksOf("k"));
+    ASSERT_TRUE(disk.getFileBlocks("k.bin")[0] != block);
+
+    // Нехватка места не оставляет лишних ссылок
+    ASSERT_THROWS(disk.writeFile("y.bin", blocksOf("lnop")), std::runtime_error);
+    disk.deleteFile("x.bin");
+    disk.deleteFile("k.bin");
+    ASSERT_EQ(4, disk.getFreeBlocks());
+
+    // Места на копии обоих общих блоков нет: запись отклоняется до изменения
+    // файла, а не после копирования первого блока
+    HardDrive full(5, 32);
+    full.enableDedup();
+    full.writeFile("s1.bin", blocksOf("st"));
+    full.writeFile("s2.bin", blocksOf("st"));
+    full.writeFile("fill.bin", blocksOf("uv"));
+    ASSERT_EQ(1, full.getFreeBlocks());
+    ASSERT_THROWS(full.writeAt("s2.bin", 16, std::vector<uint8_t>(32, 'w')), std::runtime_error);
+    ASSERT_THROWS(full.writeAt("s2.bin", 40, std::vector<uint8_t>(40, 'w')), std::runtime_error);
+    ASSERT_TRUE(full.readFile("s2.bin") == blocksOf("st"));
+    ASSERT_TRUE(full.getFileBlocks("s2.bin") == full.getFileBlocks("s1.bin"));
+    ASSERT_EQ(1, full.getFreeBlocks());
+    ASSERT_EQ(0, full.getDedupStats().cow_copies);
+    full.writeAt("s2.bin", 40, std::vector<uint8_t>(8, 'w'));
+    ASSERT_EQ('w', full.readAt("s2.bin", 40, 1)[0]);
+    ASSERT_EQ('t', full.readAt("s1.bin", 40, 1)[0]);
+    ASSERT_EQ(0, full.getFreeBlocks());
+}
+
+static void copyFile(const std::string& from, const std::string& to) {
+    std::ifstream in(from, std::ios::binary);
+    std::ofstream out(to, std::ios::binary | std::ios::trunc);
+    out << in.rdbuf();
+}
+
+void test_disk_journal_replay() {
+    const std::string path = "test_disk_journal.svmdisk";
+    const std::string crash = "test_disk_journal_crash.svmdisk";
+    std::remove(path.c_str());
+    {
+        HardDrive disk(path, 128, 64);
+        disk.enableCache(16, CacheMode::WriteBack);
+        disk.writeFile("a.txt", std::vector<uint8_t>(100, 'a'));
+        disk.append("log.txt", std::vector<uint8_t>(10, 'l'));
+        disk.append("log.txt", std::vector<uint8_t>(70, 'm'));
+        disk.writeFile("gone.txt", std::vector<uint8_t>(5, 'g'));
+        disk.deleteFile("gone.txt");
+        disk.commit();
+        ASSERT_EQ(1, disk.getJournalStats().commits);
+        ASSERT_EQ(5, disk.getJournalStats().records);
+        // Сброшены только записанные блоки (и блок удалённого gone.txt),
+        // а не весь образ; повторная фиксация ничего не сбрасывает
+        ASSERT_EQ(5, disk.getJournalStats().synced_blocks);
+        disk.commit();
+        ASSERT_EQ(5, disk.getJournalStats().synced_blocks);
+
+        // Незафиксированное изменение не переживает «сбой» (копия образа сейчас)
+        disk.writeFile("late.txt", std::vector<uint8_t>(3, 'x'));
+        copyFile(path, crash);
+    }
+    {
+        HardDrive disk(crash, 128, 64);
+        ASSERT_EQ(1, disk.getJournalStats().replayed);
+        ASSERT_TRUE(disk.fileExists("a.txt"));
+        ASSERT_FALSE(disk.fileExists("gone.txt"));
+        ASSERT_FALSE(disk.fileExists("late.txt"));
+        ASSERT_EQ(80, disk.getFileSize("log.txt"));
+        ASSERT_EQ('l', disk.readAt("log.txt", 9, 1)[0]);
+        ASSERT_EQ('m', disk.readAt("log.txt", 79, 1)[0]);
+        ASSERT_EQ(128 - 2 - 2, disk.getFreeBlocks());
+        ASSERT_TRUE(disk.getFreeSpace().verify());
+    }
+    {
+        // Корректное закрытие сохранило всё контрольной записью
+        HardDrive disk(path, 128, 64);
+        ASSERT_EQ(0, disk.getJournalStats().replayed);
+        ASSERT_TRUE(disk.fileExists("late.txt"));
+
+        // Переполнение кольца журнала приводит к контрольной записи
+        const std::string name(150, 'n');
+        for (int i = 0; i < 250; ++i) {
+            disk.writeFile(name, std::vector<uint8_t>{static_cast<uint8_t>(i)});
+            disk.commit();
+            disk.deleteFile(name);
+            disk.commit();
+        }
+        disk.writeFile(name, std::vector<uint8_t>{0x5A});
+        disk.commit();
+        ASSERT_TRUE(disk.getJournalStats().checkpoints > 0);
+        copyFile(path, crash);
+    }
+    {
+        HardDrive disk(crash, 128, 64);
+        ASSERT_EQ(0x5A, disk.readFile(std::string(150, 'n'))[0]);
+        ASSERT_TRUE(disk.fileExists("late.txt"));
+        ASSERT_TRUE(disk.getFreeSpace().verify());
+    }
+    std::remove(path.c_str());
+
+    // Блоки удалённого файла не занимаются до фиксации удаления: сбой
+    // между выделением блоков и commit() оставляет прежний файл целым
+    const std::vector<uint8_t> old_data(8 * 64, 'o');
+    const std::vector<uint8_t> new_data(8 * 64, 'n');
+    {
+        HardDrive disk(path, 16, 64);
+        disk.writeFile("old.bin", old_data);
+        disk.commit();
+        disk.deleteFile("old.bin");
+        ASSERT_EQ(8, disk.getFreeBlocks());
+        disk.writeFile("new.bin", new_data);
+        copyFile(path, crash);
+        disk.commit();
+        ASSERT_EQ(8, disk.getFreeBlocks());
+    }
+    {
+        HardDrive disk(crash, 16, 64);
+        ASSERT_TRUE(disk.readFile("old.bin") == old_data);
+        ASSERT_FALSE(disk.fileExists("new.bin"));
+        ASSERT_TRUE(disk.getChecksumErrors().empty());
+    }
+    {
+        // Без свободного места удаление фиксируется досрочно, перезапись
+        // файла — через пустой файл: после сбоя он пуст, но не испорчен
+        HardDrive disk(path, 16, 64);
+        disk.deleteFile("new.bin");
+        disk.writeFile("big.bin", std::vector<uint8_t>(12 * 64, 'b'));
+        disk.commit();
+        disk.writeFile("big.bin", std::vector<uint8_t>(12 * 64, 'c'));
+        copyFile(path, crash);
+    }
+    {
+        HardDrive disk(crash, 16, 64);
+        ASSERT_FALSE(disk.fileExists("new.bin"));
+        ASSERT_TRUE(disk.fileExists("big.bin"));
+        ASSERT_EQ(0, disk.getFileSize("big.bin"));
+        ASSERT_TRUE(disk.getFreeSpace().verify());
+    }
+    const std::vector<uint8_t> big_data(12 * 64, 'c');
+    {
+        HardDrive disk(path, 16, 64);
+        ASSERT_TRUE(disk.readFile("big.bin") == big_data);
+
+        // Прерванная контрольная запись не трогает действующий слот
+        // метаданных: порча свободного слота не мешает открытию, порча
+        // действующего обнаруживается
+        disk.flush();
+    }
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    uint64_t slots[2];  // начала слотов 0 и 1
+    uint64_t active = 0;
+    file.seekg(32);
+    file.read(reinterpret_cast<char*>(slots), sizeof(slots));
+    file.seekg(64);
+    file.read(reinterpret_cast<char*>(&active), sizeof(active));
+    file.seekp(static_cast<std::streamoff>(slots[1 - active] + 40));
+    file.put('\x7F');
+    file.flush();
+    {
+        HardDrive disk(path, 16, 64);
+        ASSERT_TRUE(disk.readFile("big.bin") == big_data);
+    }
+    file.seekg(64);
+    file.read(reinterpret_cast<char*>(&active), sizeof(active));
+    file.seekp(static_cast<std::streamoff>(slots[active] + 40));
+    file.put('\x7F');
+    file.close();
+    ASSERT_THROWS(HardDrive(path, 16, 64), std::runtime_error);
+    std::remove(path.c_str());
+    std::remove(crash.c_str());
+}
+
+void test_disk_compression() {
+    // Текстовые данные, как журнал гостя: сжимаются в разы
+    std::string text;
+    for (int i = 0; text.size() < 3000; ++i) {
+        text += "2026-01-01 12:00:00 INFO request id=" + std::to_string(i % 50) + " status=ok\n";
+    }
+    const std::vector<uint8_t> log(text.begin(), text.end());
+    std::vector<uint8_t> noise(700);
+    uint32_t seed = 12345;
+    for (uint8_t& b : noise) {
+        seed = seed * 1103515245u + 12345u;
+        b = static_cast<uint8_t>(seed >> 16);
+    }
+
+    const std::string path = "test_disk_compression.svmdisk";
+    const std::string crash = "test_disk_compression_crash.svmdisk";
+    std::remove(path.c_str());
+    std::vector<uint8_t> expected = log;
+    {
+        HardDrive disk(path, 256, 64);
+        disk.enableCompression();
+        disk.writeFile("app.log", log);
+        ASSERT_TRUE(disk.isCompressed("app.log"));
+        ASSERT_TRUE(disk.readFile("app.log") == log);
+        ASSERT_TRUE(disk.getFileBlocks("app.log").size() * 3 <= (log.size() + 63) / 64);
+        CompressionStats stats = disk.getCompressionStats();
+        ASSERT_EQ(1, stats.files);
+        ASSERT_EQ((log.size() + 1023) / 1024, stats.chunks);
+        ASSERT_TRUE(stats.getRatio() >= 3.0);
+
+        // Произвольный доступ распаковывает только нужные участки
+        ASSERT_TRUE(disk.readAt("app.log", 1000, 100) ==
+                    std::vector<uint8_t>(log.begin() + 1000, log.begin() + 1100));
+
+        // Запись через границу участков, дозапись и запись за концом файла
+        disk.writeAt("app.log", 1000, std::vector<uint8_t>(50, '#'));
+        std::fill(expected.begin() + 1000, expected.begin() + 1050, '#');
+        ASSERT_EQ(log.size(), disk.append("app.log", log));
+        expected.insert(expected.end(), log.begin(), log.end());
+        disk.writeAt("app.log", expected.size() + 100, std::vector<uint8_t>{'!'});
+        expected.resize(expected.size() + 100, 0);
+        expected.push_back('!');
+        ASSERT_TRUE(disk.readFile("app.log") == expected);
+        ASSERT_EQ(expected.size(), disk.getFileSize("app.log"));
+
+        std::vector<uint8_t> streamed;
+        HardDrive::ChunkReader reader = disk.openReader("app.log");
+        for (BlockView chunk = reader.next(); !chunk.empty(); chunk = reader.next()) {
+            streamed.insert(streamed.end(), chunk.begin(), chunk.end());
+        }
+        ASSERT_TRUE(streamed == expected);
+
+        // Несжимаемый участок хранится как есть; небольшой файл можно исключить
+        disk.writeFile("noise.bin", noise);
+        ASSERT_EQ(1, disk.getCompressionStats().raw_chunks);
+        ASSERT_TRUE(disk.readFile("noise.bin") == noise);
+        disk.writeFile("hot.txt", std::vector<uint8_t>(40, 'h'));
+        disk.setCompressed("hot.txt", false);
+        ASSERT_FALSE(disk.isCompressed("hot.txt"));
+        disk.writeAt("hot.txt", 0, std::vector<uint8_t>{'H'});
+        ASSERT_EQ(1, disk.getFileBlocks("hot.txt").size());
+        disk.disableCompression();
+        disk.writeFile("plain.txt", log);
+        ASSERT_FALSE(disk.isCompressed("plain.txt"));
+        disk.setCompressed("plain.txt", true);
+        ASSERT_TRUE(disk.readFile("plain.txt") == log);
+        disk.commit();
+        copyFile(path, crash);
+    }
+    for (const std::string& image : {crash, path}) {
+        // Индекс участков восстанавливается из журнала и из таблицы файлов
+        HardDrive disk(image, 256, 64);
+        ASSERT_TRUE(disk.isCompressed("app.log"));
+        ASSERT_TRUE(disk.isCompressed("plain.txt"));
+        ASSERT_FALSE(disk.isCompressed("hot.txt"));
+        ASSERT_TRUE(disk.readFile("app.log") == expected);
+        ASSERT_TRUE(disk.readFile("noise.bin") == noise);
+        ASSERT_EQ('H', disk.readAt("hot.txt", 0, 1)[0]);
+        ASSERT_TRUE(disk.getFreeSpace().verify());
+    }
+    std::remove(path.c_str());
+    std::remove(crash.c_str());
+
+    // Место под все перезаписываемые участки проверяется до записи: на
+    // полном диске не остаётся ни одного участка, записанного наполовину
+    HardDrive full(64, 64);
+    full.enableCompression();
+    const std::vector<uint8_t> head(log.begin(), log.begin() + 2048);
+    full.writeFile("app.log", head);
+    const std::vector<size_t> packed = full.getFileBlocks("app.log");
+    full.disableCompression();
+    full.writeFile("fill.bin", std::vector<uint8_t>((64 - packed.size() - 16) * 64, 'f'));
+    ASSERT_EQ(16, full.getFreeBlocks());
+    std::vector<uint8_t> wide(2048);
+    for (size_t i = 0; i < wide.size(); ++i) wide[i] = noise[i % noise.size()] ^ static_cast<uint8_t>(i / 7);
+    ASSERT_THROWS(full.writeAt("app.log", 0, wide), std::runtime_error);
+    ASSERT_TRUE(full.getFileBlocks("app.log") == packed);
+    ASSERT_TRUE(full.readFile("app.log") == head);
+    ASSERT_EQ(16, full.getFreeBlocks());
+    full.writeAt("app.log", 0, std::vector<uint8_t>(wide.begin(), wide.begin() + 1024));
+    ASSERT_TRUE(full.readAt("app.log", 0, 1024) == std::vector<uint8_t>(wide.begin(), wide.begin() + 1024));
+    ASSERT_TRUE(full.getFreeSpace().verify());
+
+    // Запись через два участка на полном диске: первый растёт с 1 блока до
+    // 16, второй сжимается с 16 до 1. Рост покрывается местом сжавшегося
+    const std::vector<uint8_t> raw(wide.begin(), wide.begin() + 1024);
+    std::vector<uint8_t> before(1024, 0);
+    before.insert(before.end(), raw.begin(), raw.end());
+    std::vector<uint8_t> after = raw;
+    after.resize(2048, 0);
+    HardDrive swap(64, 64);
+    swap.enableCompression();
+    swap.writeFile("swap.bin", before);
+    ASSERT_EQ(17, swap.getFileBlocks("swap.bin").size());
+    swap.disableCompression();
+    swap.writeFile("fill.bin", std::vector<uint8_t>(47 * 64, 'f'));
+    ASSERT_EQ(0, swap.getFreeBlocks());
+    swap.writeAt("swap.bin", 0, after);
+    ASSERT_TRUE(swap.readFile("swap.bin") == after);
+    ASSERT_EQ(17, swap.getFileBlocks("swap.bin").size());
+    ASSERT_EQ(0, swap.getFreeBlocks());
+    ASSERT_TRUE(swap.getFreeSpace().verify());
+}
+
 int main() {
     TestFramework framework;
     
@@ -100,6 +1184,23 @@ int main() {
     framework.addTest("Disk delete file", test_disk_delete_file);
     framework.addTest("Disk overwrite file", test_disk_overwrite_file);
     framework.addTest("Disk insufficient blocks", test_disk_insufficient_blocks);
+    framework.addTest("Disk free space allocation", test_disk_free_space_allocation);
+    framework.addTest("Disk fragmentation metrics", test_disk_fragmentation_metrics);
+    framework.addTest("Disk preallocated blocks are tracked", test_disk_preallocated_blocks_are_tracked);
+    framework.addTest("Disk persistent image", test_disk_persistent_image);
+    framework.addTest("Disk partial I/O", test_disk_partial_io);
+    framework.addTest("Disk chunk reader", test_disk_chunk_reader);
+    framework.addTest("Disk inode handles", test_disk_inode_handles);
+    framework.addTest("Disk block cache (ARC)", test_disk_block_cache);
+    framework.addTest("Disk cached file I/O", test_disk_cached_file_io);
+    framework.addTest("Disk write-back cache", test_disk_write_back_cache);
+    framework.addTest("Disk journal replay", test_disk_journal_replay);
+    framework.addTest("Disk async I/O ring", test_disk_io_ring);
+    framework.addTest("Disk I/O scheduler", test_disk_io_scheduler);
+    framework.addTest("Disk timing model", test_disk_timing_model);
+    framework.addTest("Disk block checksums and scrubbing", test_disk_checksums);
+    framework.addTest("Disk block deduplication", test_disk_dedup);
+    framework.addTest("Disk per-file compression", test_disk_compression);
     
     framework.runAll();
     return framework.getFailedCount() > 0 ? 1 : 0;
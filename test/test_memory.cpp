@@ -1,5 +1,12 @@
 #include "test_framework.hpp"
 #include "../lib/Memory/MemoryBlock.hpp"
+#include "../lib/Memory/GuestAllocator.hpp"
+#include "../lib/Memory/MemoryCompactor.hpp"
+#include "../lib/Memory/VirtualMemory.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <vector>
 #include <cstdint>
 
@@ -68,6 +75,595 @@ void test_memory_zero_initialization() {
     }
 }
 
+void test_memory_view_block() {
+    MemoryBlock mem(4, 16);
+    std::vector<uint8_t> data(16, 0x5A);
+    mem.writeBlock(2, data);
+
+    BlockView view = mem.viewBlock(2);
+    ASSERT_EQ(16, view.size());
+    for (size_t i = 0; i < view.size(); ++i) {
+        ASSERT_EQ(0x5A, view[i]);
+    }
+    ASSERT_THROWS(mem.viewBlock(4), std::out_of_range);
+}
+
+void test_memory_mutable_block() {
+    MemoryBlock mem(4, 16);
+    MutableBlockView block = mem.mutableBlock(1);
+    block[0] = 0x11;
+    block[15] = 0x22;
+
+    std::vector<uint8_t> read_data = mem.readBlock(1);
+    ASSERT_EQ(0x11, read_data[0]);
+    ASSERT_EQ(0x22, read_data[15]);
+    ASSERT_THROWS(mem.mutableBlock(4), std::out_of_range);
+}
+
+void test_memory_contiguous_aligned_storage() {
+    MemoryBlock mem(8, 64);
+    const uint8_t* first = mem.viewBlock(0).data();
+    ASSERT_EQ(0, reinterpret_cast<uintptr_t>(first) % MemoryBlock::kAlignment);
+    for (size_t i = 1; i < 8; ++i) {
+        ASSERT_TRUE(mem.viewBlock(i).data() == first + i * 64);
+    }
+}
+
+void test_memory_byte_read_write_across_blocks() {
+    MemoryBlock mem(4, 16);
+    std::vector<uint8_t> data(20);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<uint8_t>(i + 1);
+
+    // Диапазон [10, 30) пересекает границу блоков 0 и 1
+    mem.write(10, data.data(), data.size());
+    std::vector<uint8_t> block0 = mem.readBlock(0);
+    std::vector<uint8_t> block1 = mem.readBlock(1);
+    ASSERT_EQ(1, block0[10]);
+    ASSERT_EQ(6, block0[15]);
+    ASSERT_EQ(7, block1[0]);
+    ASSERT_EQ(20, block1[13]);
+    ASSERT_EQ(0, block1[14]);
+
+    std::vector<uint8_t> back(20, 0);
+    mem.read(10, back.data(), back.size());
+    for (size_t i = 0; i < back.size(); ++i) {
+        ASSERT_EQ(data[i], back[i]);
+    }
+}
+
+void test_memory_fill_and_copy() {
+    MemoryBlock mem(4, 16);
+    mem.fill(8, 0xCC, 32);
+    ASSERT_EQ(0, mem.load<uint8_t>(7));
+    ASSERT_EQ(0xCC, mem.load<uint8_t>(8));
+    ASSERT_EQ(0xCC, mem.load<uint8_t>(39));
+    ASSERT_EQ(0, mem.load<uint8_t>(40));
+
+    // Перекрывающееся копирование ведёт себя как memmove
+    mem.store<uint32_t>(0, 0x04030201u);
+    mem.copy(2, 0, 4);
+    ASSERT_EQ(0x01, mem.load<uint8_t>(2));
+    ASSERT_EQ(0x04, mem.load<uint8_t>(5));
+}
+
+void test_memory_byte_out_of_range() {
+    MemoryBlock mem(4, 16);
+    uint8_t buf[8] = {0};
+    ASSERT_THROWS(mem.read(60, buf, 8), std::out_of_range);
+    ASSERT_THROWS(mem.write(64, buf, 1), std::out_of_range);
+    ASSERT_THROWS(mem.fill(0, 0, 65), std::out_of_range);
+    ASSERT_THROWS(mem.copy(0, 1, 64), std::out_of_range);
+    ASSERT_THROWS(mem.read(SIZE_MAX, buf, 2), std::out_of_range);
+}
+
+void test_memory_sparse_lazy_materialization() {
+    MemoryBlock mem(1000, 64, MemoryBlock::Mode::Sparse);
+    ASSERT_EQ(0, mem.getResidentBlocks());
+
+    // Нетронутые блоки читаются как нули и не материализуются
+    std::vector<uint8_t> zeros = mem.readBlock(500);
+    for (uint8_t b : zeros) ASSERT_EQ(0, b);
+    ASSERT_EQ(0, mem.viewBlock(999)[63]);
+    mem.fill(0, 0, 64 * 10);
+    ASSERT_EQ(0, mem.getResidentBlocks());
+
+    mem.writeBlock(3, std::vector<uint8_t>(64, 0x42));
+    mem.store<uint16_t>(64 * 7 + 63, 0xBEEF); // запись через границу блоков 7 и 8
+    ASSERT_EQ(3, mem.getResidentBlocks());
+    ASSERT_TRUE(mem.isResident(3));
+    ASSERT_TRUE(mem.isResident(8));
+    ASSERT_FALSE(mem.isResident(9));
+    ASSERT_EQ(0x42, mem.readBlock(3)[10]);
+    ASSERT_EQ(0xBEEF, mem.load<uint16_t>(64 * 7 + 63));
+}
+
+void test_memory_sparse_copy_overlapping() {
+    MemoryBlock mem(8, 16, MemoryBlock::Mode::Sparse);
+    for (size_t i = 0; i < 40; ++i) mem.store<uint8_t>(i, static_cast<uint8_t>(i + 1));
+
+    // Перекрывающийся сдвиг вправо через несколько блоков
+    mem.copy(5, 0, 40);
+    for (size_t i = 0; i < 40; ++i) {
+        ASSERT_EQ(i + 1, mem.load<uint8_t>(i + 5));
+    }
+    // И сдвиг влево
+    mem.copy(0, 5, 40);
+    for (size_t i = 0; i < 40; ++i) {
+        ASSERT_EQ(i + 1, mem.load<uint8_t>(i));
+    }
+}
+
+void test_memory_sparse_copy_constructor() {
+    MemoryBlock mem(16, 32, MemoryBlock::Mode::Sparse);
+    mem.store<uint32_t>(32 * 5, 0xDEADBEEF);
+
+    MemoryBlock copy(mem);
+    ASSERT_EQ(1, copy.getResidentBlocks());
+    ASSERT_EQ(0xDEADBEEF, copy.load<uint32_t>(32 * 5));
+    mem.store<uint32_t>(32 * 5, 0);
+    ASSERT_EQ(0xDEADBEEF, copy.load<uint32_t>(32 * 5));
+}
+
+void test_memory_mmap_backing() {
+    MemoryBlock mem(256, 64, MemoryBlock::Mode::Dense, MemoryBlock::Backing::Mmap);
+    ASSERT_TRUE(mem.selfTest());
+    ASSERT_TRUE(mem.getPageSize() >= 4096);
+    ASSERT_EQ(0, mem.getPageSize() & (mem.getPageSize() - 1));
+    ASSERT_EQ(0, mem.load<uint64_t>(64 * 100));
+    mem.store<uint64_t>(64 * 100 + 60, 0x0102030405060708ULL);
+    ASSERT_EQ(0x0102030405060708ULL, mem.load<uint64_t>(64 * 100 + 60));
+
+    MemoryBlock copy(mem);
+    ASSERT_TRUE(copy.getBacking() == mem.getBacking());
+    ASSERT_EQ(0x0102030405060708ULL, copy.load<uint64_t>(64 * 100 + 60));
+}
+
+void test_memory_huge_page_backing() {
+    MemoryBlock mem(1024, 4096, MemoryBlock::Mode::Dense, MemoryBlock::Backing::HugePages);
+    ASSERT_TRUE(mem.selfTest());
+    // Большие страницы не гарантированы: при отказе получаем обычный mmap или кучу
+    if (mem.getBacking() == MemoryBlock::Backing::HugePages) {
+        ASSERT_TRUE(mem.getPageSize() > 4096);
+    }
+    mem.fill(0, 0x7F, mem.getCapacity());
+    ASSERT_EQ(0x7F, mem.load<uint8_t>(mem.getCapacity() - 1));
+}
+
+void test_memory_sparse_rejects_mmap() {
+    ASSERT_THROWS(MemoryBlock(16, 64, MemoryBlock::Mode::Sparse, MemoryBlock::Backing::Mmap),
+                  std::invalid_argument);
+}
+
+void test_memory_snapshot_copy_on_write() {
+    MemoryBlock mem(8, 32);
+    mem.writeBlock(1, std::vector<uint8_t>(32, 0x11));
+    mem.writeBlock(2, std::vector<uint8_t>(32, 0x22));
+
+    MemoryBlock clone = mem.snapshot();
+    ASSERT_EQ(8, mem.getSharedBlocks());
+    ASSERT_EQ(8, clone.getSharedBlocks());
+    ASSERT_EQ(0, clone.getPrivateBlocks());
+    // Снимок не копирует данные: представления указывают на те же кадры
+    ASSERT_TRUE(clone.viewBlock(1).data() == mem.viewBlock(1).data());
+
+    // Запись в клон копирует только изменённый блок
+    clone.store<uint8_t>(32 * 1 + 5, 0xAB);
+    ASSERT_EQ(1, clone.getCowCopies());
+    ASSERT_EQ(1, clone.getPrivateBlocks());
+    ASSERT_EQ(7, clone.getSharedBlocks());
+    ASSERT_EQ(0xAB, clone.load<uint8_t>(32 * 1 + 5));
+    ASSERT_EQ(0x11, mem.load<uint8_t>(32 * 1 + 5));
+
+    // После копии в клоне родитель владеет блоком единолично и пишет на месте
+    mem.writeBlock(1, std::vector<uint8_t>(32, 0x33));
+    ASSERT_EQ(0, mem.getCowCopies());
+    ASSERT_EQ(0xAB, clone.load<uint8_t>(32 * 1 + 5));
+    ASSERT_EQ(0x22, clone.readBlock(2)[0]);
+}
+
+void test_memory_snapshot_lifetime() {
+    MemoryBlock clone(1, 1);
+    {
+        MemoryBlock mem(16, 64, MemoryBlock::Mode::Sparse);
+        mem.store<uint32_t>(64 * 3, 0xCAFEBABE);
+        clone = mem.snapshot();
+        ASSERT_EQ(1, clone.getSharedBlocks());
+    }
+    // Исходная память уничтожена — кадр остаётся у снимка
+    ASSERT_EQ(0xCAFEBABE, clone.load<uint32_t>(64 * 3));
+    ASSERT_EQ(0, clone.getSharedBlocks());
+    ASSERT_EQ(1, clone.getPrivateBlocks());
+    clone.store<uint32_t>(64 * 3, 1);
+    ASSERT_EQ(0, clone.getCowCopies());
+}
+
+void test_memory_dirty_tracking() {
+    MemoryBlock mem(200, 16);
+    ASSERT_EQ(0, mem.getDirtyCount());
+
+    mem.writeBlock(3, std::vector<uint8_t>(16, 1));
+    mem.write(16 * 70 + 10, "abcdefgh", 8);   // блоки 70 и 71
+    mem.fill(16 * 130, 0xFF, 16 * 3);        // блоки 130..132
+    mem.mutableBlock(199)[0] = 7;
+    ASSERT_EQ(7, mem.getDirtyCount());
+    ASSERT_TRUE(mem.isDirty(71));
+    ASSERT_FALSE(mem.isDirty(72));
+
+    std::vector<size_t> expected = {3, 70, 71, 130, 131, 132, 199};
+    std::vector<size_t> dirty = mem.getDirtyBlocks();
+    ASSERT_EQ(expected.size(), dirty.size());
+    for (size_t i = 0; i < expected.size(); ++i) ASSERT_EQ(expected[i], dirty[i]);
+
+    mem.clearDirty(130, 3);
+    ASSERT_EQ(4, mem.getDirtyCount());
+
+    // drain забирает и сбрасывает отметки
+    size_t drained = 0;
+    mem.drainDirtyBlocks([&](size_t) { ++drained; });
+    ASSERT_EQ(4, drained);
+    ASSERT_EQ(0, mem.getDirtyCount());
+
+    // Чтение не делает блок изменённым
+    mem.readBlock(3);
+    mem.load<uint32_t>(16 * 70);
+    ASSERT_EQ(0, mem.getDirtyCount());
+}
+
+void test_memory_dirty_tracking_snapshot() {
+    MemoryBlock mem(64, 32, MemoryBlock::Mode::Sparse);
+    mem.store<uint32_t>(0, 1);
+    MemoryBlock clone = mem.snapshot();
+    ASSERT_EQ(0, clone.getDirtyCount());
+    ASSERT_EQ(1, mem.getDirtyCount());
+
+    clone.store<uint32_t>(32 * 10, 2);
+    clone.copy(32 * 20, 0, 32);
+    ASSERT_EQ(2, clone.getDirtyCount());
+    ASSERT_TRUE(clone.isDirty(10));
+    ASSERT_TRUE(clone.isDirty(20));
+    mem.clearDirty();
+    ASSERT_EQ(0, mem.getDirtyCount());
+}
+
+void test_memory_thread_safe_no_torn_blocks() {
+    MemoryBlock mem(16, 256);
+    mem.enableThreadSafety(4);
+    ASSERT_TRUE(mem.isThreadSafe());
+    ASSERT_EQ(4, mem.getStripeCount());
+
+    // Писатели заполняют блок целиком одним байтом, читатели проверяют,
+    // что не видят смеси двух записей.
+    std::atomic<bool> torn{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 2; ++t) {
+        threads.emplace_back([&mem, t] {
+            std::vector<uint8_t> data(256);
+            for (int i = 0; i < 2000; ++i) {
+                std::fill(data.begin(), data.end(), static_cast<uint8_t>(t * 100 + i % 100));
+                mem.write((i % 16) * 256, data.data(), data.size());
+            }
+        });
+    }
+    for (int t = 0; t < 2; ++t) {
+        threads.emplace_back([&mem, &torn] {
+            std::vector<uint8_t> data(256);
+            for (int i = 0; i < 2000; ++i) {
+                mem.read((i % 16) * 256, data.data(), data.size());
+                if (std::count(data.begin(), data.end(), data[0]) != 256) torn = true;
+                mem.withBlockRead(i % 16, [&](BlockView view) {
+                    if (std::count(view.begin(), view.end(), view[0]) != 256) torn = true;
+                });
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    ASSERT_FALSE(torn.load());
+    ASSERT_EQ(16, mem.getDirtyCount());
+}
+
+void test_memory_thread_safe_contention_counter() {
+    MemoryBlock mem(8, 64, MemoryBlock::Mode::Sparse);
+    mem.enableThreadSafety();
+    ASSERT_EQ(0, mem.getLockContentions());
+
+    std::atomic<bool> locked{false};
+    std::thread writer([&] {
+        mem.withBlockWrite(0, [&](MutableBlockView view) {
+            locked = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            view[0] = 42;
+        });
+    });
+    while (!locked) std::this_thread::yield();
+    ASSERT_EQ(42, mem.load<uint8_t>(0));  // ждёт освобождения полосы
+    writer.join();
+    ASSERT_TRUE(mem.getLockContentions() >= 1);
+    ASSERT_TRUE(mem.isDirty(0));
+
+    // Снимок и копия наследуют режим
+    MemoryBlock clone = mem.snapshot();
+    ASSERT_TRUE(clone.isThreadSafe());
+    clone.copy(64, 0, 64);
+    ASSERT_EQ(42, clone.load<uint8_t>(64));
+    ASSERT_EQ(0, mem.load<uint8_t>(64));
+    ASSERT_THROWS(mem.enableThreadSafety(0), std::invalid_argument);
+}
+
+void test_lz_codec_round_trip() {
+    std::vector<uint8_t> repetitive(4096);
+    for (size_t i = 0; i < repetitive.size(); ++i) repetitive[i] = static_cast<uint8_t>("ABCDEFG"[i % 7]);
+    std::vector<uint8_t> packed = lz::compress(repetitive);
+    ASSERT_TRUE(packed.size() < repetitive.size() / 10);
+    ASSERT_TRUE(lz::decompress(packed, repetitive.size()) == repetitive);
+
+    // Несжимаемые данные, короткие и пустые входы
+    std::vector<uint8_t> noise(1000);
+    uint32_t x = 12345;
+    for (uint8_t& b : noise) {
+        x = x * 1103515245u + 12345u;
+        b = static_cast<uint8_t>(x >> 24);
+    }
+    ASSERT_TRUE(lz::decompress(lz::compress(noise), noise.size()) == noise);
+    std::vector<uint8_t> tiny = {1, 2, 3};
+    ASSERT_TRUE(lz::decompress(lz::compress(tiny), tiny.size()) == tiny);
+    ASSERT_EQ(0, lz::decompress(lz::compress(std::vector<uint8_t>()), 0).size());
+
+    ASSERT_THROWS(lz::decompress(packed, repetitive.size() + 1), std::runtime_error);
+    packed.resize(packed.size() / 2);
+    ASSERT_THROWS(lz::decompress(packed, repetitive.size()), std::runtime_error);
+}
+
+void test_memory_compaction_of_cold_blocks() {
+    const size_t bs = 256;
+    MemoryBlock mem(8, bs, MemoryBlock::Mode::Sparse);
+    std::vector<uint8_t> text(bs);
+    for (size_t i = 0; i < bs; ++i) text[i] = static_cast<uint8_t>('a' + i % 4);
+    std::vector<uint8_t> noise(bs);
+    for (size_t i = 0; i < bs; ++i) noise[i] = static_cast<uint8_t>((i * 7919) ^ (i >> 3));
+
+    MemoryCompactor compactor(mem);
+    mem.writeBlock(0, std::vector<uint8_t>(bs, 0));   // материализованный нулевой блок
+    mem.writeBlock(1, text);
+    mem.writeBlock(2, text);                           // дубликат блока 1
+    mem.writeBlock(3, noise);
+    mem.writeBlock(4, noise);                          // несжимаемый дубликат
+    ASSERT_EQ(5, mem.getResidentBlocks());
+
+    // Первый обход: все блоки недавно использовались — второй шанс
+    compactor.runPass();
+    ASSERT_EQ(5, mem.getResidentBlocks());
+
+    compactor.runPass();
+    CompactorStats stats = compactor.getStats();
+    ASSERT_EQ(2, stats.passes);
+    ASSERT_EQ(1, stats.zero_blocks);
+    ASSERT_EQ(2, stats.duplicate_blocks);
+    ASSERT_EQ(1, stats.compressed_blocks);
+    ASSERT_TRUE(stats.bytes_saved > 3 * bs);
+    ASSERT_FALSE(mem.isResident(0));
+    ASSERT_TRUE(mem.isCompressed(1));
+    ASSERT_TRUE(mem.isCompressed(2));
+    ASSERT_EQ(1, mem.getSharedBlocks() / 2);           // блоки 3 и 4 делят кадр
+
+    // Прозрачная распаковка при чтении и copy-on-write при записи
+    ASSERT_TRUE(mem.readBlock(2) == text);
+    ASSERT_FALSE(mem.isCompressed(2));
+    ASSERT_TRUE(mem.isCompressed(1));
+    mem.store<uint8_t>(4 * bs, 0xEE);
+    ASSERT_EQ(noise[0], mem.load<uint8_t>(3 * bs));
+    ASSERT_EQ(0xEE, mem.load<uint8_t>(4 * bs));
+    ASSERT_EQ(0, mem.load<uint8_t>(10));
+
+    // Снимок разделяет сжатые данные
+    MemoryBlock clone = mem.snapshot();
+    ASSERT_TRUE(clone.isCompressed(1));
+    ASSERT_TRUE(clone.readBlock(1) == text);
+    ASSERT_TRUE(mem.isCompressed(1));
+    MemoryBlock copy(mem);
+    ASSERT_TRUE(copy.readBlock(1) == text);
+    ASSERT_TRUE(mem.readBlock(1) == text);
+}
+
+void test_memory_background_compactor() {
+    MemoryBlock mem(64, 128, MemoryBlock::Mode::Sparse);
+    mem.enableThreadSafety();
+    for (size_t i = 0; i < 64; ++i) mem.fill(i * 128, static_cast<uint8_t>(i % 3), 128);
+
+    MemoryCompactor compactor(mem);
+    compactor.start(std::chrono::milliseconds(1), std::chrono::microseconds(200));
+    ASSERT_TRUE(compactor.isRunning());
+    // Интерпретатор продолжает работать с памятью
+    for (int round = 0; round < 200; ++round) {
+        const size_t block = round % 64;
+        ASSERT_EQ(block % 3, mem.load<uint8_t>(block * 128 + 127));
+    }
+    while (compactor.getStats().passes < 3) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    compactor.stop();
+    ASSERT_FALSE(compactor.isRunning());
+
+    ASSERT_TRUE(compactor.getStats().bytes_saved > 0);
+    for (size_t i = 0; i < 64; ++i) {
+        ASSERT_EQ(i % 3, mem.load<uint8_t>(i * 128));
+    }
+
+    MemoryBlock unsafe(4, 64);
+    MemoryCompactor idle(unsafe);
+    ASSERT_THROWS(idle.start(std::chrono::milliseconds(1), std::chrono::microseconds(100)),
+                  std::runtime_error);
+}
+
+void test_buddy_split_and_coalesce() {
+    BuddyAllocator buddy(0, 16);
+    ASSERT_EQ(16, buddy.getLargestFreeRun());
+
+    size_t a = buddy.allocate(1);
+    size_t b = buddy.allocate(3);   // округляется до 4 блоков
+    size_t c = buddy.allocate(8);
+    ASSERT_EQ(4, buddy.allocationSize(b));
+    ASSERT_EQ(0, b % 4);
+    ASSERT_EQ(0, c % 8);
+    ASSERT_EQ(3, buddy.getFreeBlocks());
+    ASSERT_THROWS(buddy.allocate(4), std::runtime_error);
+
+    buddy.free(b);
+    buddy.free(a);
+    buddy.free(c);
+    ASSERT_EQ(16, buddy.getFreeBlocks());
+    ASSERT_EQ(1, buddy.getFreeChunks());
+    ASSERT_EQ(16, buddy.getLargestFreeRun());
+    ASSERT_THROWS(buddy.free(c), std::invalid_argument);
+}
+
+void test_buddy_non_power_of_two_range() {
+    BuddyAllocator buddy(10, 13);   // блоки 10..22: куски 8 + 4 + 1
+    ASSERT_EQ(13, buddy.getFreeBlocks());
+    ASSERT_EQ(3, buddy.getFreeChunks());
+    ASSERT_EQ(8, buddy.getLargestFreeRun());
+
+    size_t big = buddy.allocate(8);
+    ASSERT_EQ(10, big);
+    size_t one = buddy.allocate(1);
+    ASSERT_TRUE(one >= 18 && one < 23);
+    ASSERT_THROWS(buddy.allocate(8), std::runtime_error);
+    ASSERT_THROWS(buddy.free(5), std::out_of_range);
+}
+
+void test_guest_allocator_slab_and_buddy() {
+    MemoryBlock mem(64, 64);
+    GuestAllocator alloc(mem, 4);
+
+    std::vector<size_t> small;
+    for (int i = 0; i < 20; ++i) small.push_back(alloc.allocate(10));  // класс 16 байт
+    for (size_t i = 0; i < small.size(); ++i) {
+        ASSERT_TRUE(small[i] >= 4 * 64);
+        ASSERT_EQ(0, small[i] % 16);
+        mem.store<uint32_t>(small[i], static_cast<uint32_t>(i));
+    }
+    for (size_t i = 0; i < small.size(); ++i) {
+        ASSERT_EQ(i, mem.load<uint32_t>(small[i]));
+    }
+
+    size_t big = alloc.allocate(200);  // 4 блока через buddy
+    ASSERT_EQ(0, big % 64);
+    GuestAllocatorStats stats = alloc.getStats();
+    ASSERT_EQ(21, stats.live_allocations);
+    ASSERT_EQ(20 * 10 + 200, stats.requested_bytes);
+    ASSERT_EQ(20 * 16 + 256, stats.granted_bytes);
+    ASSERT_TRUE(stats.internal_fragmentation > 0.0);
+
+    for (size_t addr : small) alloc.free(addr);
+    alloc.free(big);
+    stats = alloc.getStats();
+    ASSERT_EQ(0, stats.live_allocations);
+    // Один пустой слаб (2 блока для класса 16 байт) остаётся в кэше
+    ASSERT_EQ(58, stats.free_blocks);
+    ASSERT_THROWS(alloc.free(big), std::invalid_argument);
+}
+
+void test_guest_allocator_odd_block_sizes() {
+    // Блок 100 байт: кэши 16 и 32, объект 40 байт (до половины блока) — в buddy
+    MemoryBlock mem(64, 100);
+    GuestAllocator alloc(mem);
+    const size_t mid = alloc.allocate(40);
+    ASSERT_EQ(0, mid % 100);
+    const size_t small = alloc.allocate(20);
+    ASSERT_EQ(100 + 32, alloc.getStats().granted_bytes);
+    alloc.free(mid);
+    alloc.free(small);
+    ASSERT_EQ(0, alloc.getStats().granted_bytes);
+
+    // Блок 16 байт: слаб-кэшей нет, любой объект занимает целый блок
+    MemoryBlock tiny(8, 16);
+    GuestAllocator tiny_alloc(tiny);
+    const size_t one = tiny_alloc.allocate(5);
+    ASSERT_EQ(0, one % 16);
+    ASSERT_EQ(16, tiny_alloc.getStats().granted_bytes);
+    tiny_alloc.free(one);
+    ASSERT_EQ(8, tiny_alloc.getStats().free_blocks);
+}
+
+void test_guest_allocator_fragmentation() {
+    MemoryBlock mem(16, 32);
+    GuestAllocator alloc(mem);
+    std::vector<size_t> blocks;
+    for (int i = 0; i < 16; ++i) blocks.push_back(alloc.allocateBlocks(1));
+    ASSERT_THROWS(alloc.allocateBlocks(1), std::runtime_error);
+    // Освобождаем каждый второй блок: 8 свободных, но нет двух подряд
+    for (size_t i = 0; i < blocks.size(); i += 2) alloc.freeBlocks(blocks[i]);
+    GuestAllocatorStats stats = alloc.getStats();
+    ASSERT_EQ(8, stats.free_blocks);
+    ASSERT_EQ(1, stats.largest_free_run);
+    ASSERT_TRUE(stats.external_fragmentation > 0.8);
+    ASSERT_THROWS(alloc.allocateBlocks(2), std::runtime_error);
+}
+
+void test_vm_translate_and_tlb() {
+    MemoryBlock mem(16, 64);
+    AddressSpace space(1, 1024);
+    space.map(100, 5);
+    space.map(101, 9);
+    space.map(102, 11, false);
+    Mmu mmu(mem, 8);
+
+    ASSERT_EQ(5 * 64 + 3, mmu.translate(space, 100 * 64 + 3, Access::Read));
+    ASSERT_EQ(1, mmu.getTlb().getMisses());
+    ASSERT_EQ(5 * 64 + 10, mmu.translate(space, 100 * 64 + 10, Access::Write));
+    ASSERT_EQ(1, mmu.getTlb().getHits());
+
+    // Запись через границу страниц попадает в два разных кадра
+    mmu.store<uint32_t>(space, 100 * 64 + 62, 0xA1B2C3D4);
+    ASSERT_EQ(0xC3D4, mem.load<uint16_t>(5 * 64 + 62));
+    ASSERT_EQ(0xA1B2, mem.load<uint16_t>(9 * 64));
+    ASSERT_EQ(0, mmu.load<uint8_t>(space, 102 * 64));
+    ASSERT_THROWS(mmu.store<uint8_t>(space, 102 * 64, 1), PageFault);
+    ASSERT_TRUE(space.lookup(100)->dirty);
+    ASSERT_TRUE(space.lookup(102)->accessed);
+    ASSERT_FALSE(space.lookup(102)->dirty);
+    ASSERT_THROWS(mmu.load<uint8_t>(space, 500 * 64), PageFault);
+}
+
+void test_vm_isolated_address_spaces() {
+    MemoryBlock mem(8, 32);
+    AddressSpace a(1, 16);
+    AddressSpace b(2, 16);
+    a.map(0, 2);
+    b.map(0, 3);
+    Mmu mmu(mem, 4);
+
+    mmu.store<uint32_t>(a, 4, 111);
+    mmu.store<uint32_t>(b, 4, 222);
+    ASSERT_EQ(111, mmu.load<uint32_t>(a, 4));
+    ASSERT_EQ(222, mmu.load<uint32_t>(b, 4));
+
+    // Отмена отображения делает запись TLB недействительной
+    a.unmap(0);
+    ASSERT_THROWS(mmu.load<uint32_t>(a, 4), PageFault);
+    ASSERT_EQ(222, mmu.load<uint32_t>(b, 4));
+}
+
+void test_vm_fault_handler() {
+    MemoryBlock mem(8, 32);
+    GuestAllocator frames(mem);
+    AddressSpace space(7, 64);
+    Mmu mmu(mem);
+    std::vector<size_t> faulted;
+    mmu.setFaultHandler([&](AddressSpace& as, size_t vpn, Access) {
+        if (vpn >= 10) return false;
+        size_t frame = frames.allocateBlocks(1);
+        mem.fill(frame * 32, static_cast<uint8_t>(vpn), 32);
+        as.map(vpn, frame);
+        faulted.push_back(vpn);
+        return true;
+    });
+
+    ASSERT_EQ(3, mmu.load<uint8_t>(space, 3 * 32 + 1));
+    ASSERT_EQ(3, mmu.load<uint8_t>(space, 3 * 32 + 31));
+    ASSERT_EQ(1, faulted.size());
+    ASSERT_EQ(1, mmu.getPageFaults());
+    ASSERT_THROWS(mmu.load<uint8_t>(space, 20 * 32), PageFault);
+    ASSERT_EQ(2, mmu.getPageFaults());
+}
+
 int main() {
     TestFramework framework;
     
@@ -78,6 +674,35 @@ int main() {
     framework.addTest("Memory out of range write", test_memory_out_of_range_write);
     framework.addTest("Memory invalid data size", test_memory_invalid_data_size);
     framework.addTest("Memory zero initialization", test_memory_zero_initialization);
+    framework.addTest("Memory view block", test_memory_view_block);
+    framework.addTest("Memory mutable block", test_memory_mutable_block);
+    framework.addTest("Memory contiguous aligned storage", test_memory_contiguous_aligned_storage);
+    framework.addTest("Memory byte read/write across blocks", test_memory_byte_read_write_across_blocks);
+    framework.addTest("Memory fill and copy", test_memory_fill_and_copy);
+    framework.addTest("Memory byte out of range", test_memory_byte_out_of_range);
+    framework.addTest("Memory sparse lazy materialization", test_memory_sparse_lazy_materialization);
+    framework.addTest("Memory sparse overlapping copy", test_memory_sparse_copy_overlapping);
+    framework.addTest("Memory sparse copy constructor", test_memory_sparse_copy_constructor);
+    framework.addTest("Memory mmap backing", test_memory_mmap_backing);
+    framework.addTest("Memory huge page backing", test_memory_huge_page_backing);
+    framework.addTest("Memory sparse rejects mmap", test_memory_sparse_rejects_mmap);
+    framework.addTest("Memory snapshot copy-on-write", test_memory_snapshot_copy_on_write);
+    framework.addTest("Memory snapshot lifetime", test_memory_snapshot_lifetime);
+    framework.addTest("Memory dirty tracking", test_memory_dirty_tracking);
+    framework.addTest("Memory dirty tracking with snapshot", test_memory_dirty_tracking_snapshot);
+    framework.addTest("Memory thread-safe mode: no torn blocks", test_memory_thread_safe_no_torn_blocks);
+    framework.addTest("Memory thread-safe mode: contention counter", test_memory_thread_safe_contention_counter);
+    framework.addTest("LZ codec round trip", test_lz_codec_round_trip);
+    framework.addTest("Memory compaction of cold blocks", test_memory_compaction_of_cold_blocks);
+    framework.addTest("Memory background compactor", test_memory_background_compactor);
+    framework.addTest("Buddy split and coalesce", test_buddy_split_and_coalesce);
+    framework.addTest("Buddy non power of two range", test_buddy_non_power_of_two_range);
+    framework.addTest("Guest allocator slab and buddy", test_guest_allocator_slab_and_buddy);
+    framework.addTest("Guest allocator odd block sizes", test_guest_allocator_odd_block_sizes);
+    framework.addTest("Guest allocator fragmentation", test_guest_allocator_fragmentation);
+    framework.addTest("VM translate and TLB", test_vm_translate_and_tlb);
+    framework.addTest("VM isolated address spaces", test_vm_isolated_address_spaces);
+    framework.addTest("VM fault handler", test_vm_fault_handler);
     
     framework.runAll();
     return framework.getFailedCount() > 0 ? 1 : 0;